@@ -44,6 +44,29 @@ flexic_SeekMap50(const flexi_cursor_s *cursor)
 
 /******************************************************************************/
 
+static const char *
+flexic_SeekMap50Indexed(const flexi_cursor_s *cursor,
+    const flexi_map_index_s *rootIndex, const flexi_map_index_s *mapIndex)
+{
+    flexi_cursor_s cursorTwo, cursorThree;
+
+    flexi_result_e res;
+    res = flexi_cursor_seek_map_key_indexed(cursor, rootIndex, "map-50",
+        &cursorTwo);
+    assert(res == FLEXI_OK);
+    res = flexi_cursor_seek_map_key_indexed(&cursorTwo, mapIndex, "key-50",
+        &cursorThree);
+    assert(res == FLEXI_OK);
+
+    const char *value = nullptr;
+    flexi_ssize_t len = -1;
+    flexi_cursor_string(&cursorThree, &value, &len);
+    assert(!strcmp(value, "v-50-50"));
+    return value;
+}
+
+/******************************************************************************/
+
 static flexbuffers::String
 flatbuffers_SeekMap50(const flexbuffers::Reference &rootRef)
 {
@@ -99,6 +122,30 @@ bench_BenchSeekKey(const char *flexbuf, const char *json, const char *title)
         });
     }
 
+    {
+        flexi_cursor_s cursor = flexi_StringToRoot(flexbuf_doc);
+        flexi_cursor_s mapCursor;
+        flexi_cursor_seek_map_key(&cursor, "map-50", &mapCursor);
+
+        std::vector<uint32_t> rootBuffer(
+            flexi_map_index_size(flexi_cursor_length(&cursor)) /
+            sizeof(uint32_t));
+        std::vector<uint32_t> mapBuffer(
+            flexi_map_index_size(flexi_cursor_length(&mapCursor)) /
+            sizeof(uint32_t));
+
+        flexi_map_index_s rootIndex, mapIndex;
+        flexi_build_map_index(&cursor, rootBuffer.data(),
+            rootBuffer.size() * sizeof(uint32_t), &rootIndex);
+        flexi_build_map_index(&mapCursor, mapBuffer.data(),
+            mapBuffer.size() * sizeof(uint32_t), &mapIndex);
+
+        bench.run("leximayfield/flexic (indexed)", [&] {
+            ankerl::nanobench::doNotOptimizeAway(
+                flexic_SeekMap50Indexed(&cursor, &rootIndex, &mapIndex));
+        });
+    }
+
     {
         flexbuffers::Reference rootRef = flatbuffers_StringToRoot(flexbuf_doc);
 
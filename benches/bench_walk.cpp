@@ -70,6 +70,29 @@ flexic_Parser()
     return parser;
 }
 
+/**
+ * @brief Handler for flexi::parse with the same callbacks as flexic_Parser.
+ */
+struct flexic_Handler {
+    bool string(const char *key, const char *str, flexi_ssize_t len)
+    {
+        return flexic_EmitString(key, str, len, nullptr);
+    }
+
+    bool map_begin(const char *key, flexi_ssize_t len)
+    {
+        return flexic_EmitBeginMap(key, len, nullptr);
+    }
+
+    bool map_end() { return flexic_EmitEndMap(nullptr); }
+
+    bool typed_vector(const char *key, const void *ptr, flexi_type_e type,
+        int width, flexi_ssize_t count)
+    {
+        return flexic_EmitTypedVector(key, ptr, type, width, count, nullptr);
+    }
+};
+
 /******************************************************************************/
 
 static void
@@ -371,6 +394,17 @@ bench_BenchWalk(const char *flexbuf, const char *json, const char *title)
         });
     }
 
+    {
+        flexic_Handler handler;
+        flexi_cursor_s cursor = flexi_StringToRoot(flexbuf_doc);
+
+        bench.run("leximayfield/flexic (C++)", [&] {
+            flexi_result_e res = flexi::parse(&cursor, handler);
+            assert(FLEXI_SUCCESS(res));
+            ankerl::nanobench::doNotOptimizeAway(res);
+        });
+    }
+
     {
         flexbuffers::Reference rootRef = flatbuffers_StringToRoot(flexbuf_doc);
 
@@ -0,0 +1,153 @@
+//
+// FlexiC - A standalone FlexBuffer reader/writer in C
+//
+// (C) 2025 Lexi Mayfield
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include "flexic_bench.hpp"
+
+#include <cstdlib>
+#include <vector>
+
+/******************************************************************************/
+
+struct flexic_VectorStack {
+    std::vector<flexi_value_s> values;
+
+    static flexi_value_s *At(flexi_ssize_t offset, void *user)
+    {
+        auto stack = static_cast<flexic_VectorStack *>(user);
+        if (offset < 0 || offset >= flexi_ssize_t(stack->values.size())) {
+            return nullptr;
+        }
+        return &stack->values[offset];
+    }
+
+    static flexi_ssize_t Count(void *user)
+    {
+        auto stack = static_cast<flexic_VectorStack *>(user);
+        return flexi_ssize_t(stack->values.size());
+    }
+
+    static flexi_value_s *Push(void *user)
+    {
+        auto stack = static_cast<flexic_VectorStack *>(user);
+        stack->values.emplace_back();
+        return &stack->values.back();
+    }
+
+    static flexi_ssize_t Pop(flexi_ssize_t count, void *user)
+    {
+        auto stack = static_cast<flexic_VectorStack *>(user);
+        count = std::min(count, flexi_ssize_t(stack->values.size()));
+        stack->values.resize(stack->values.size() - size_t(count));
+        return count;
+    }
+};
+
+/******************************************************************************/
+
+struct flexic_VectorStream {
+    std::vector<char> data;
+
+    static bool Write(const void *ptr, flexi_ssize_t len, void *user)
+    {
+        auto stream = static_cast<flexic_VectorStream *>(user);
+        auto bytes = static_cast<const char *>(ptr);
+        stream->data.insert(stream->data.end(), bytes, bytes + len);
+        return true;
+    }
+
+    static const void *DataAt(flexi_ssize_t index, void *user)
+    {
+        auto stream = static_cast<flexic_VectorStream *>(user);
+        return &stream->data[index];
+    }
+
+    static bool Tell(flexi_ssize_t *offset, void *user)
+    {
+        auto stream = static_cast<flexic_VectorStream *>(user);
+        *offset = flexi_ssize_t(stream->data.size());
+        return true;
+    }
+};
+
+/******************************************************************************/
+
+static void
+flexic_WriteDoc(flexi_writer_s *writer)
+{
+    char keybuf[16], valuebuf[16];
+    for (int i = 0; i < 100; i++) {
+        for (int j = 0; j < 100; j++) {
+            snprintf(keybuf, sizeof(keybuf), "key-%d", j);
+            snprintf(valuebuf, sizeof(valuebuf), "v-%d-%d", i, j);
+            flexi_write_strlen(writer, keybuf, valuebuf);
+        }
+
+        snprintf(keybuf, sizeof(keybuf), "map-%d", i);
+        flexi_write_map(writer, keybuf, 100, FLEXI_WIDTH_1B);
+    }
+
+    flexi_write_map(writer, nullptr, 100, FLEXI_WIDTH_1B);
+    flexi_result_e res = flexi_write_finalize(writer);
+    assert(res == FLEXI_OK);
+    (void)res;
+}
+
+/******************************************************************************/
+
+void
+bench_BenchWrite(const char *title)
+{
+    auto bench = ankerl::nanobench::Bench()
+                     .minEpochTime(std::chrono::milliseconds{100})
+                     .title(title);
+
+    bench.run("leximayfield/flexic (callbacks)", [&] {
+        flexic_VectorStack stack;
+        flexic_VectorStream stream;
+        flexi_stack_s fstack = flexi_make_stack(flexic_VectorStack::At,
+            flexic_VectorStack::Count, flexic_VectorStack::Push,
+            flexic_VectorStack::Pop, &stack);
+        flexi_ostream_s fstream = flexi_make_ostream(flexic_VectorStream::Write,
+            flexic_VectorStream::DataAt, flexic_VectorStream::Tell, &stream);
+        flexi_writer_s writer =
+            flexi_make_writer(&fstack, &fstream, strdup, free);
+
+        flexic_WriteDoc(&writer);
+        ankerl::nanobench::doNotOptimizeAway(stream.data.data());
+        flexi_destroy_writer(&writer);
+    });
+
+    bench.run("leximayfield/flexic (built-in)", [&] {
+        flexi_array_stack_s array = flexi_make_growable_stack(realloc, free);
+        flexi_mem_ostream_s mem = flexi_make_mem_ostream(4096, realloc, free);
+        flexi_stack_s fstack = flexi_array_stack(&array);
+        flexi_ostream_s fstream = flexi_mem_ostream(&mem);
+        flexi_writer_s writer =
+            flexi_make_writer(&fstack, &fstream, strdup, free);
+
+        flexic_WriteDoc(&writer);
+        ankerl::nanobench::doNotOptimizeAway(mem.len);
+        flexi_destroy_writer(&writer);
+        flexi_destroy_mem_ostream(&mem);
+        flexi_destroy_array_stack(&array);
+    });
+}
@@ -53,5 +53,6 @@ main(const int, const char *[])
         "Walk entire document (vec3)");
     bench_BenchParseWalk("large_doc2.flexbuf", "large_doc2.json",
         "Parse and Walk entire document (vec3)");
+    bench_BenchWrite("Write document (strings)");
     return 0;
 }
@@ -101,3 +101,6 @@ bench_BenchWalk(const char *flexbuf, const char *json, const char *title);
 
 void
 bench_BenchParseWalk(const char *flexbuf, const char *json, const char *title);
+
+void
+bench_BenchWrite(const char *title);
@@ -34,5 +34,11 @@ LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
     };
 
     (void)flexi_parse_cursor(&parser, &cursor, NULL);
+
+    // Anything that passes validation must be safe to read unchecked.
+    flexi_cursor_s trusted;
+    if (flexi_validate_span(&span, &trusted) == FLEXI_OK) {
+        (void)flexi_parse_cursor(&parser, &trusted, NULL);
+    }
     return 0; // non-zero reserved for future use
 }
@@ -39,6 +39,41 @@
 #define FLEXI_FEATURE_JSON 0
 #endif
 
+#ifndef FLEXI_CONFIG_MAX_DEPTH
+/**
+ * @brief The maximum number of nested vectors or maps before the parse fails.
+ *
+ * @details A maliciously-formed FlexBuffer could nest vectors inside vectors
+ *          and crash the validator with a stack overflow.  This limit prevents
+ *          excessive nesting which would result in such a crash.
+ *
+ *          flexi_parse_cursor keeps one frame per level of nesting on the
+ *          stack, so this limit also sizes that array.  Use
+ *          flexi_parse_cursor_ex to parse with as many frames as you like.
+ */
+#define FLEXI_CONFIG_MAX_DEPTH (32)
+#endif
+
+#ifndef FLEXI_CONFIG_MAX_ITERABLES
+/**
+ * @brief The maximum number of non-typed vectors and maps to parse before
+ *        failing.
+ *
+ * @details FlexBuffers allow for a single value to be referenced from multiple
+ *          places in the message.  However, this feature has the potential
+ *          for misuse in maliciously-designed "FlexBuffer bomb" inputs where
+ *          iterable containers are shared and nested in ways that take a
+ *          long time to parse.
+ *
+ *          Note that this limit does not count typed vectors, as these do
+ *          not allow nesting other iterables inside them.
+ *
+ *          flexi_parse_cursor_ex and resumable parses only use this as the
+ *          default of the max_iterables parse option.
+ */
+#define FLEXI_CONFIG_MAX_ITERABLES (2048)
+#endif
+
 #if defined(__cplusplus)
 #if defined(_MSVC_LANG)
 #define FLEXI_IMPL_CPLUSPLUS _MSVC_LANG
@@ -102,6 +137,12 @@ typedef enum flexi_result_e {
      */
     FLEXI_OK = 1,
 
+    /**
+     * @brief Success, but the operation ran out of budget before it was
+     *        finished.  Call it again to continue where it left off.
+     */
+    FLEXI_INCOMPLETE = 2,
+
     /**
      * @brief The user passed an invalid parameter.
      */
@@ -419,8 +460,23 @@ typedef struct flexi_cursor_s {
     flexi_type_e type;
     int width;
     flexi_ssize_t length;
+    bool trusted;
+    const char *keys;
+    int keys_width;
 } flexi_cursor_s;
 
+/**
+ * @brief An iterator over the values of a map or untyped vector.
+ *
+ * @warning All members of this struct are considered implementation details
+ *          and should not be used directly.
+ */
+typedef struct flexi_iter_s {
+    flexi_cursor_s cursor;
+    flexi_cursor_s keys;
+    flexi_ssize_t index;
+} flexi_iter_s;
+
 /**
  * @brief Function called on every iteration of flexi_cursor_foreach.
  *
@@ -448,6 +504,30 @@ flexi_make_span(const void *data, flexi_ssize_t len);
 FLEXI_API flexi_result_e
 flexi_open_span(const flexi_span_s *msg, flexi_cursor_s *cursor);
 
+/**
+ * @brief "Open" a buffer like flexi_open_span, after checking every value
+ *        reachable from the root object.
+ *
+ * @details Every offset, width and type is checked, as well as the order of
+ *          map keys, the termination of strings and keys, and the limits on
+ *          nesting depth and number of maps and vectors.  The returned cursor
+ *          and every cursor obtained through it are marked as trusted and
+ *          skip the bounds checks that are otherwise done on every access.
+ *
+ *          This moves the cost of checking a message out of each lookup into
+ *          a single pass, which pays off when a message is read many times.
+ *
+ * @warning The message must not be modified while trusted cursors into it
+ *          are still in use.
+ *
+ * @param[in] msg Span pointing to FlexBuffer message to validate.
+ * @param[out] cursor Trusted cursor pointing to root object, or failsafe
+ *                    cursor on error.
+ * @return FLEXI_OK || FLEXI_ERR_BADREAD || FLEXI_ERR_PARSELIMIT.
+ */
+FLEXI_API flexi_result_e
+flexi_validate_span(const flexi_span_s *msg, flexi_cursor_s *cursor);
+
 /**
  * @brief Obtain the type of the value pointed to by the cursor.
  *
@@ -578,6 +658,140 @@ FLEXI_API flexi_result_e
 flexi_cursor_seek_map_key(const flexi_cursor_s *cursor, const char *key,
     flexi_cursor_s *dest);
 
+/**
+ * @brief Remembers where a key was found by a previous lookup, so lookups of
+ *        the same key in maps of the same shape can skip the search.
+ *
+ * @details Messages that share a schema usually place a given key at the
+ *          same index of every map.  A cache is meant to be kept alongside
+ *          a single lookup site, and to be used for one key only.
+ *
+ *          hits and misses can be read to check how effective the cache
+ *          is.  All other members are implementation details.
+ */
+typedef struct flexi_seek_cache_s {
+    flexi_ssize_t index;
+    flexi_ssize_t length;
+    uint64_t hits;
+    uint64_t misses;
+} flexi_seek_cache_s;
+
+/**
+ * @brief Create an empty seek cache.
+ */
+FLEXI_API flexi_seek_cache_s
+flexi_make_seek_cache(void);
+
+/**
+ * @brief Given a cursor pointing at a map, create a new cursor pointing
+ *        at a value found at the passed key, checking the index remembered
+ *        by the cache before searching the map.
+ *
+ * @details If the map has the same length as the map the cache last found
+ *          the key in, the key at the remembered index is compared first.
+ *          Otherwise, or if that key doesn't match, the key is searched for
+ *          as usual and the cache is updated with the result.
+ *
+ * @param[in] cursor Cursor pointing to map to examine.
+ * @param[in] key Key to look up.
+ * @param[in,out] cache Cache for this lookup site.
+ * @param[out] dest Cursor pointing at value for the given key, or pointer
+ *                  to failsafe cursor.
+ * @return FLEXI_OK || FLEXI_ERR_NOTFOUND || FLEXI_ERR_BADTYPE ||
+ *         FLEXI_ERR_BADREAD.
+ */
+FLEXI_API flexi_result_e
+flexi_cursor_seek_map_key_cached(const flexi_cursor_s *cursor,
+    const char *key, flexi_seek_cache_s *cache, flexi_cursor_s *dest);
+
+/**
+ * @brief Given a cursor pointing at a map, create a cursor for each of the
+ *        passed keys in a single pass over the keys of the map.
+ *
+ * @details Keys in the map are sorted in strcmp order, so wanted keys are
+ *          found by merging them against the keys of the map.  Passing
+ *          wanted keys in strcmp order makes the merge a single linear
+ *          pass, otherwise the merge is restarted with a binary search
+ *          every time the order of the wanted keys goes backwards.
+ *
+ * @param[in] cursor Cursor pointing to map to examine.
+ * @param[in] keys Array of keys to look up.
+ * @param[in] count Number of keys to look up.
+ * @param[out] dests Array of count cursors.  Each cursor points at the value
+ *                   for the key with the same index, or to failsafe cursor
+ *                   if that key was not found.
+ * @return FLEXI_OK if every key was found || FLEXI_ERR_NOTFOUND if any key
+ *         was not found || FLEXI_ERR_FAILSAFE || FLEXI_ERR_BADTYPE ||
+ *         FLEXI_ERR_BADREAD.
+ */
+FLEXI_API flexi_result_e
+flexi_cursor_seek_map_keys(const flexi_cursor_s *cursor,
+    const char *const *keys, flexi_ssize_t count, flexi_cursor_s *dests);
+
+/**
+ * @brief A hash index over the keys of a single map, stored in memory
+ *        supplied by the caller.
+ *
+ * @details Looking up a key in a map is a binary search, which costs a
+ *          handful of string comparisons per lookup.  For maps that are
+ *          queried over and over again, an index can be built once which
+ *          turns most lookups into a single hash and string comparison.
+ *
+ * @warning All members of this struct are considered implementation details
+ *          and should not be used directly.
+ */
+typedef struct flexi_map_index_s {
+    const char *map;
+    flexi_cursor_s keys;
+    uint32_t *slots;
+    flexi_ssize_t capacity;
+} flexi_map_index_s;
+
+/**
+ * @brief Return the size of a buffer in bytes that is large enough to
+ *        index a map of the given length, at a load factor of 50%.
+ *
+ * @param[in] len Length of map to index.
+ * @return Size of buffer in bytes, or 0 if len is negative or so large
+ *         that the size would overflow.
+ */
+FLEXI_API flexi_ssize_t
+flexi_map_index_size(flexi_ssize_t len);
+
+/**
+ * @brief Build a hash index for the map pointed to by the cursor.
+ *
+ * @note The index holds pointers into both the message and the passed
+ *       buffer, and is only valid for as long as both of them are.
+ *
+ * @param[in] cursor Cursor pointing to map to index.
+ * @param[in] buffer Buffer to store the index in.  Must be aligned for
+ *                   uint32_t.
+ * @param[in] len Length of buffer in bytes, see flexi_map_index_size.
+ * @param[out] index Index to build.
+ * @return FLEXI_OK || FLEXI_ERR_FAILSAFE || FLEXI_ERR_BADTYPE ||
+ *         FLEXI_ERR_PARAM || FLEXI_ERR_BADREAD.
+ */
+FLEXI_API flexi_result_e
+flexi_build_map_index(const flexi_cursor_s *cursor, void *buffer,
+    flexi_ssize_t len, flexi_map_index_s *index);
+
+/**
+ * @brief Given a cursor pointing at a map and an index built for that map,
+ *        create a new cursor pointing at a value found at the passed key.
+ *
+ * @param[in] cursor Cursor pointing to map to examine.
+ * @param[in] index Index previously built for the map at the cursor.
+ * @param[in] key Key to look up.
+ * @param[out] dest Cursor pointing at value for the given key, or pointer
+ *                  to failsafe cursor.
+ * @return FLEXI_OK || FLEXI_ERR_NOTFOUND || FLEXI_ERR_BADTYPE ||
+ *         FLEXI_ERR_PARAM || FLEXI_ERR_BADREAD.
+ */
+FLEXI_API flexi_result_e
+flexi_cursor_seek_map_key_indexed(const flexi_cursor_s *cursor,
+    const flexi_map_index_s *index, const char *key, flexi_cursor_s *dest);
+
 /**
  * @brief Given a cursor pointing at an untyped vector or map, return a pointer
  *        to the packed type value for index 0.  The pointer is to a tightly
@@ -611,6 +825,76 @@ FLEXI_API flexi_result_e
 flexi_cursor_seek_vector_index(const flexi_cursor_s *cursor,
     flexi_ssize_t index, flexi_cursor_s *dest);
 
+/**
+ * @brief A single step of a compiled path.
+ *
+ * @warning All members of this struct are considered implementation details
+ *          and should not be used directly.
+ */
+typedef struct flexi_path_step_s {
+    const char *key;
+    flexi_ssize_t key_len;
+    flexi_ssize_t index;
+    flexi_ssize_t first;
+    flexi_ssize_t last;
+} flexi_path_step_s;
+
+/**
+ * @brief A path compiled into steps, which can be used to seek into many
+ *        messages without parsing the path again.
+ *
+ * @warning All members of this struct are considered implementation details
+ *          and should not be used directly.
+ */
+typedef struct flexi_path_s {
+    const flexi_path_step_s *steps;
+    flexi_ssize_t count;
+} flexi_path_s;
+
+/**
+ * @brief Compile a path string into steps.
+ *
+ * @details A path is a sequence of segments, each one prefixed by a slash,
+ *          for example "/map-50/key-50/3".  Each segment is a map key, or
+ *          an index if the value being seeked into is a vector.  The empty
+ *          string is a path to the cursor itself.
+ *
+ *          When used as a parse filter, a segment of "*" matches every key
+ *          or index, and a segment of "N..M" matches vector indexes N
+ *          through M inclusive.
+ *
+ * @note The compiled path points into the passed string, so the string must
+ *       outlive the compiled path.
+ *
+ * @param[in] str Path string to compile.
+ * @param[in] steps Array of steps to compile path into.
+ * @param[in] steps_len Number of steps in array.
+ * @param[out] path Compiled path.
+ * @return FLEXI_OK || FLEXI_ERR_PARAM if the path is malformed or has more
+ *         segments than steps_len.
+ */
+FLEXI_API flexi_result_e
+flexi_compile_path(const char *str, flexi_path_step_s *steps,
+    flexi_ssize_t steps_len, flexi_path_s *path);
+
+/**
+ * @brief Given a cursor and a compiled path, return a second cursor pointing
+ *        to the value found at the end of the path.
+ *
+ * @details Steps into maps behave like flexi_cursor_seek_map_key, and steps
+ *          into vectors behave like flexi_cursor_seek_vector_index.
+ *
+ * @param[in] cursor Cursor to seek from.
+ * @param[in] path Compiled path to follow.
+ * @param[out] dest Cursor pointing at value at the end of the path, or
+ *                  pointer to failsafe cursor on error.
+ * @return FLEXI_OK || FLEXI_ERR_NOTFOUND || FLEXI_ERR_BADTYPE ||
+ *         FLEXI_ERR_FAILSAFE || FLEXI_ERR_BADREAD.
+ */
+FLEXI_API flexi_result_e
+flexi_cursor_seek_path(const flexi_cursor_s *cursor, const flexi_path_s *path,
+    flexi_cursor_s *dest);
+
 /**
  * @brief Given a cursor pointing at a typed vector, obtain a pointer to
  *        its initial value, as well as the type and stride of the vector.
@@ -639,18 +923,123 @@ FLEXI_API flexi_result_e
 flexi_cursor_typed_vector_data(const flexi_cursor_s *cursor, const void **data,
     flexi_type_e *type, int *stride, flexi_ssize_t *count);
 
+/**
+ * @brief Given a cursor pointing at a typed vector, convert every value in
+ *        the vector to int64_t and store it in a native array.
+ *
+ * @details Signed, unsigned, float and boolean typed vectors are supported,
+ *          including the fixed length variants.  Values which cannot be
+ *          represented are saturated, NaN is converted to 0, and the
+ *          conversion continues to the end of the vector.
+ *
+ * @param[in] cursor Cursor pointing to typed vector.
+ * @param[out] dst Destination array.
+ * @param[in] dst_len Length of destination array, must be at least the
+ *                    length of the vector.
+ * @return FLEXI_OK || FLEXI_ERR_FAILSAFE || FLEXI_ERR_BADTYPE ||
+ *         FLEXI_ERR_PARAM || FLEXI_ERR_BADREAD || FLEXI_ERR_RANGE if any
+ *         value was saturated.
+ */
+FLEXI_API flexi_result_e
+flexi_cursor_typed_vector_to_i64(const flexi_cursor_s *cursor, int64_t *dst,
+    flexi_ssize_t dst_len);
+
+/**
+ * @brief Given a cursor pointing at a typed vector, convert every value in
+ *        the vector to uint64_t and store it in a native array.
+ *
+ * @details Negative values are saturated to 0.  Otherwise behaves the same
+ *          as flexi_cursor_typed_vector_to_i64.
+ *
+ * @param[in] cursor Cursor pointing to typed vector.
+ * @param[out] dst Destination array.
+ * @param[in] dst_len Length of destination array, must be at least the
+ *                    length of the vector.
+ * @return FLEXI_OK || FLEXI_ERR_FAILSAFE || FLEXI_ERR_BADTYPE ||
+ *         FLEXI_ERR_PARAM || FLEXI_ERR_BADREAD || FLEXI_ERR_RANGE if any
+ *         value was saturated.
+ */
+FLEXI_API flexi_result_e
+flexi_cursor_typed_vector_to_u64(const flexi_cursor_s *cursor, uint64_t *dst,
+    flexi_ssize_t dst_len);
+
+/**
+ * @brief Given a cursor pointing at a typed vector, convert every value in
+ *        the vector to float and store it in a native array.
+ *
+ * @details Integers which cannot be represented exactly are rounded.
+ *          Finite doubles beyond the range of float are saturated to
+ *          +/-FLT_MAX, and the conversion continues to the end of the
+ *          vector.  Infinities and NaN are kept as they are.
+ *
+ * @param[in] cursor Cursor pointing to typed vector.
+ * @param[out] dst Destination array.
+ * @param[in] dst_len Length of destination array, must be at least the
+ *                    length of the vector.
+ * @return FLEXI_OK || FLEXI_ERR_FAILSAFE || FLEXI_ERR_BADTYPE ||
+ *         FLEXI_ERR_PARAM || FLEXI_ERR_BADREAD || FLEXI_ERR_RANGE if any
+ *         value was saturated.
+ */
+FLEXI_API flexi_result_e
+flexi_cursor_typed_vector_to_f32(const flexi_cursor_s *cursor, float *dst,
+    flexi_ssize_t dst_len);
+
+/**
+ * @brief Given a cursor pointing at a typed vector, convert every value in
+ *        the vector to double and store it in a native array.
+ *
+ * @param[in] cursor Cursor pointing to typed vector.
+ * @param[out] dst Destination array.
+ * @param[in] dst_len Length of destination array, must be at least the
+ *                    length of the vector.
+ * @return FLEXI_OK || FLEXI_ERR_FAILSAFE || FLEXI_ERR_BADTYPE ||
+ *         FLEXI_ERR_PARAM || FLEXI_ERR_BADREAD.
+ */
+FLEXI_API flexi_result_e
+flexi_cursor_typed_vector_to_f64(const flexi_cursor_s *cursor, double *dst,
+    flexi_ssize_t dst_len);
+
 /**
  * @brief Iterate over a map or vector type.
  *
  * @param[in] cursor Cursor pointing to map or vector.
  * @param[in] foreach Function which will be called per iteration.
  * @param[in] user User pointer which will be passed to foreach function.
- * @return FLEXI_OK || FLEXI_BADREAD.
+ * @return FLEXI_OK || FLEXI_ERR_BADTYPE || FLEXI_BADREAD.
  */
 FLEXI_API flexi_result_e
 flexi_cursor_foreach(flexi_cursor_s *cursor, flexi_foreach_fn foreach,
     void *user);
 
+/**
+ * @brief Start iterating over a map or vector type.
+ *
+ * @details Unlike flexi_cursor_foreach, iteration is driven by the caller
+ *          with flexi_iter_next, so it can be stopped, interleaved with
+ *          other iterators or resumed later.  The iterator holds no
+ *          resources and can be discarded at any time.
+ *
+ * @param[in] cursor Cursor pointing to map or vector.
+ * @param[out] iter Iterator to initialize.
+ * @return FLEXI_OK || FLEXI_ERR_FAILSAFE || FLEXI_ERR_BADTYPE ||
+ *         FLEXI_ERR_BADREAD.
+ */
+FLEXI_API flexi_result_e
+flexi_cursor_iter_begin(const flexi_cursor_s *cursor, flexi_iter_s *iter);
+
+/**
+ * @brief Advance an iterator to the next value of the map or vector.
+ *
+ * @param[in,out] iter Iterator to advance.
+ * @param[out] key Key assigned to the value, or NULL if iterable is not a
+ *                 map.  Can be set to NULL.
+ * @param[out] value Next value.  Set to failsafe cursor on error.
+ * @return FLEXI_OK || FLEXI_ERR_NOTFOUND if there are no more values ||
+ *         FLEXI_ERR_FAILSAFE || FLEXI_ERR_BADREAD.
+ */
+FLEXI_API flexi_result_e
+flexi_iter_next(flexi_iter_s *iter, const char **key, flexi_cursor_s *value);
+
 /**
  * @brief Obtain byte blob from cursor.
  *
@@ -784,6 +1173,102 @@ typedef struct flexi_ostream_s {
 
 typedef char *(*flexi_strdup_fn)(const char *str);
 typedef void (*flexi_free_fn)(void *ptr);
+typedef void *(*flexi_realloc_fn)(void *ptr, size_t size);
+
+/**
+ * @brief A stack stored in a single array of values, which is either fixed
+ *        in size or grown with a realloc function.
+ *
+ * @details The writer recognizes stacks created with flexi_array_stack and
+ *          accesses the array directly instead of calling through the
+ *          stack interface.
+ *
+ * @warning All members of this struct are considered implementation details
+ *          and should not be used directly.
+ */
+typedef struct flexi_array_stack_s {
+    flexi_value_s *values;
+    flexi_ssize_t count;
+    flexi_ssize_t capacity;
+    flexi_realloc_fn realloc_fn;
+    flexi_free_fn free_fn;
+} flexi_array_stack_s;
+
+/**
+ * @brief An output stream stored in a single fixed buffer supplied by the
+ *        caller.  Writing past the end of the buffer fails.
+ *
+ * @warning All members of this struct are considered implementation details
+ *          and should not be used directly.
+ */
+typedef struct flexi_fixed_ostream_s {
+    char *data;
+    flexi_ssize_t len;
+    flexi_ssize_t capacity;
+} flexi_fixed_ostream_s;
+
+/**
+ * @brief A chunk of memory owned by flexi_mem_ostream_s.
+ */
+typedef struct flexi_mem_chunk_s flexi_mem_chunk_s;
+
+/**
+ * @brief An output stream stored in a list of memory chunks which grow
+ *        geometrically.  Chunks are never moved once allocated, so pointers
+ *        returned by data_at stay valid until the stream is destroyed.
+ *
+ * @warning All members of this struct are considered implementation details
+ *          and should not be used directly.
+ */
+typedef struct flexi_mem_ostream_s {
+    flexi_mem_chunk_s *head;
+    flexi_mem_chunk_s *tail;
+    flexi_ssize_t len;
+    flexi_ssize_t next_size;
+    flexi_realloc_fn realloc_fn;
+    flexi_free_fn free_fn;
+} flexi_mem_ostream_s;
+
+/**
+ * @brief A hash table stored in memory supplied by the caller, which maps
+ *        data already written to the stream to its offset.
+ *
+ * @warning All members of this struct are considered implementation details
+ *          and should not be used directly.
+ */
+typedef struct flexi_writer_pool_s {
+    flexi_ssize_t *slots;
+    flexi_ssize_t capacity;
+    flexi_ssize_t count;
+} flexi_writer_pool_s;
+
+/**
+ * @brief A buffer stored in memory supplied by the caller, which collects
+ *        small writes before passing them to the stream.
+ *
+ * @warning All members of this struct are considered implementation details
+ *          and should not be used directly.
+ */
+typedef struct flexi_writer_buffer_s {
+    char *data;
+    flexi_ssize_t capacity;
+    flexi_ssize_t len;
+    flexi_ssize_t base;
+} flexi_writer_buffer_s;
+
+/**
+ * @brief Memory supplied by the caller, which keeps copies of data written
+ *        during a dry run that the writer needs to read back.
+ *
+ * @warning All members of this struct are considered implementation details
+ *          and should not be used directly.
+ */
+typedef struct flexi_writer_scratch_s {
+    char *data;
+    flexi_ssize_t capacity;
+    flexi_ssize_t len;
+    flexi_ssize_t count;
+} flexi_writer_scratch_s;
 
 /**
  * @brief A writing interface for writing a FlexBuffer.
@@ -793,6 +1278,15 @@ typedef struct flexi_writer_s {
     flexi_ostream_s ostream;
     flexi_strdup_fn opt_strdup;
     flexi_free_fn opt_free;
+    flexi_writer_pool_s key_pool;
+    flexi_writer_pool_s keyset_pool;
+    flexi_writer_pool_s string_pool;
+    flexi_ssize_t string_pool_max;
+    bool typed_vectors;
+    flexi_writer_buffer_s buffer;
+    bool dry_run;
+    flexi_ssize_t dry_run_len;
+    flexi_writer_scratch_s scratch;
     flexi_result_e err;
 } flexi_writer_s;
 
@@ -826,6 +1320,261 @@ FLEXI_API flexi_writer_s
 flexi_make_writer(const flexi_stack_s *stack, const flexi_ostream_s *ostream,
     flexi_strdup_fn opt_strdup, flexi_free_fn opt_free);
 
+/**
+ * @brief Create an array stack over a fixed array of values supplied by the
+ *        caller.  Pushing onto a full stack fails.
+ *
+ * @param[in] values Array of values.
+ * @param[in] capacity Number of values in array.
+ * @return Array stack struct.
+ */
+FLEXI_API flexi_array_stack_s
+flexi_make_fixed_stack(flexi_value_s *values, flexi_ssize_t capacity);
+
+/**
+ * @brief Create an array stack which doubles its array with realloc_fn
+ *        whenever it is full.
+ *
+ * @param[in] realloc_fn Function used to grow the array.
+ * @param[in] free_fn Function used to free the array.
+ * @return Array stack struct.
+ */
+FLEXI_API flexi_array_stack_s
+flexi_make_growable_stack(flexi_realloc_fn realloc_fn, flexi_free_fn free_fn);
+
+/**
+ * @brief Free the array of a growable array stack.  Does nothing for fixed
+ *        array stacks.
+ *
+ * @param[in,out] array Array stack to destroy.
+ */
+FLEXI_API void
+flexi_destroy_array_stack(flexi_array_stack_s *array);
+
+/**
+ * @brief Create a stack interface for an array stack.
+ *
+ * @param[in] array Array stack, which must outlive the stack interface.
+ * @return Stack struct.
+ */
+FLEXI_API flexi_stack_s
+flexi_array_stack(flexi_array_stack_s *array);
+
+/**
+ * @brief Create a memory output stream.
+ *
+ * @param[in] initial_size Size of the first chunk in bytes.  If the whole
+ *                         message fits in it, the message is contiguous.
+ * @param[in] realloc_fn Function used to allocate chunks, called with a
+ *                       NULL pointer.
+ * @param[in] free_fn Function used to free chunks.
+ * @return Memory output stream struct.
+ */
+FLEXI_API flexi_mem_ostream_s
+flexi_make_mem_ostream(flexi_ssize_t initial_size, flexi_realloc_fn realloc_fn,
+    flexi_free_fn free_fn);
+
+/**
+ * @brief Free all chunks of a memory output stream.
+ *
+ * @param[in,out] mem Memory output stream to destroy.
+ */
+FLEXI_API void
+flexi_destroy_mem_ostream(flexi_mem_ostream_s *mem);
+
+/**
+ * @brief Rewind a memory output stream to empty.
+ *
+ * @details A stream that fits in one chunk keeps it.  A stream spread
+ *          across chunks frees them, so that the next write allocates one
+ *          chunk large enough to hold all of the previous message.
+ *
+ * @param[in,out] mem Memory output stream to rewind.
+ */
+FLEXI_API void
+flexi_mem_ostream_reset(flexi_mem_ostream_s *mem);
+
+/**
+ * @brief Create an ostream interface for a memory output stream.
+ *
+ * @param[in] mem Memory output stream, which must outlive the ostream
+ *                interface.
+ * @return Ostream struct.
+ */
+FLEXI_API flexi_ostream_s
+flexi_mem_ostream(flexi_mem_ostream_s *mem);
+
+/**
+ * @brief Return the data of a memory output stream if it is stored in a
+ *        single chunk.
+ *
+ * @param[in] mem Memory output stream to examine.
+ * @param[out] len Length of data in bytes.
+ * @return Pointer to data, or NULL if nothing was written or the data is
+ *         spread across chunks, in which case use flexi_mem_ostream_copy.
+ */
+FLEXI_API const void *
+flexi_mem_ostream_data(const flexi_mem_ostream_s *mem, flexi_ssize_t *len);
+
+/**
+ * @brief Copy the data of a memory output stream into a single buffer.
+ *
+ * @param[in] mem Memory output stream to copy from.
+ * @param[out] dst Buffer to copy into.
+ * @param[in] len Length of buffer in bytes.
+ * @return FLEXI_OK || FLEXI_ERR_PARAM if the buffer is too small.
+ */
+FLEXI_API flexi_result_e
+flexi_mem_ostream_copy(const flexi_mem_ostream_s *mem, void *dst,
+    flexi_ssize_t len);
+
+/**
+ * @brief Create a fixed output stream over a buffer supplied by the caller.
+ *
+ * @param[in] buffer Buffer to write to.
+ * @param[in] len Length of buffer in bytes.
+ * @return Fixed output stream struct.
+ */
+FLEXI_API flexi_fixed_ostream_s
+flexi_make_fixed_ostream(void *buffer, flexi_ssize_t len);
+
+/**
+ * @brief Create an ostream interface for a fixed output stream.
+ *
+ * @note The fixed output stream can be replaced with a new one, for example
+ *       once flexi_writer_end_dry_run knows the size of the message, without
+ *       creating a new ostream interface.
+ *
+ * @param[in] fixed Fixed output stream, which must outlive the ostream
+ *                  interface.
+ * @return Ostream struct.
+ */
+FLEXI_API flexi_ostream_s
+flexi_fixed_ostream(flexi_fixed_ostream_s *fixed);
+
+/**
+ * @brief Return the size of a buffer in bytes that is large enough to pool
+ *        the given number of distinct values.
+ *
+ * @param[in] count Number of distinct values to pool.
+ * @return Size of buffer in bytes.
+ */
+FLEXI_API flexi_ssize_t
+flexi_writer_pool_size(flexi_ssize_t count);
+
+/**
+ * @brief Write every distinct key to the stream only once, and point later
+ *        uses of the same key at the bytes that were already written.
+ *
+ * @details Keys are compared by reading them back from the stream.  Once
+ *          the pool is full, keys which are not already in the pool are
+ *          written every time, as if there was no pool.
+ *
+ * @note The pool holds offsets into the stream, and must be set again if
+ *       the stream is rewound or replaced.
+ *
+ * @param[in,out] writer Writer to operate on.
+ * @param[in] buffer Buffer to store the pool in, or NULL to stop pooling
+ *                   keys.  Must be aligned for flexi_ssize_t.
+ * @param[in] len Length of buffer in bytes, see flexi_writer_pool_size.
+ * @return FLEXI_OK || FLEXI_ERR_PARAM.
+ */
+FLEXI_API flexi_result_e
+flexi_writer_set_key_pool(flexi_writer_s *writer, void *buffer,
+    flexi_ssize_t len);
+
+/**
+ * @brief Write every distinct set of map keys to the stream only once, and
+ *        point later maps with the same set of keys at the keys vector that
+ *        was already written.
+ *
+ * @details Sets of keys are looked up by a fingerprint that does not depend
+ *          on key order, so a hit skips both sorting and writing the keys.
+ *          This applies to flexi_write_map and flexi_write_map_keys.
+ *
+ * @note The pool holds offsets into the stream, and must be set again if
+ *       the stream is rewound or replaced.
+ *
+ * @param[in,out] writer Writer to operate on.
+ * @param[in] buffer Buffer to store the pool in, or NULL to stop pooling
+ *                   key vectors.  Must be aligned for flexi_ssize_t.
+ * @param[in] len Length of buffer in bytes, see flexi_writer_pool_size.
+ * @return FLEXI_OK || FLEXI_ERR_PARAM.
+ */
+FLEXI_API flexi_result_e
+flexi_writer_set_keyset_pool(flexi_writer_s *writer, void *buffer,
+    flexi_ssize_t len);
+
+/**
+ * @brief Write every distinct short string value to the stream only once,
+ *        and point later uses of the same string at the bytes that were
+ *        already written.
+ *
+ * @details Useful for documents that repeat a small vocabulary of strings.
+ *          Strings longer than max_len are always written, which keeps
+ *          the cost of comparing strings bounded.  Once the pool is full,
+ *          strings which are not already in the pool are written every
+ *          time, as if there was no pool.
+ *
+ * @note The pool holds offsets into the stream, and must be set again if
+ *       the stream is rewound or replaced.
+ *
+ * @param[in,out] writer Writer to operate on.
+ * @param[in] buffer Buffer to store the pool in, or NULL to stop pooling
+ *                   strings.  Must be aligned for flexi_ssize_t.
+ * @param[in] len Length of buffer in bytes, see flexi_writer_pool_size.
+ * @param[in] max_len Length of the longest string to pool.
+ * @return FLEXI_OK || FLEXI_ERR_PARAM.
+ */
+FLEXI_API flexi_result_e
+flexi_writer_set_string_pool(flexi_writer_s *writer, void *buffer,
+    flexi_ssize_t len, flexi_ssize_t max_len);
+
+/**
+ * @brief Write vectors whose values all share one type as typed vectors.
+ *
+ * @details When enabled, flexi_write_vector checks if all of its values
+ *          are signed ints, unsigned ints, floats, bools or keys.  If so,
+ *          the vector is written as a typed vector without trailing types,
+ *          and ints and floats with 2 to 4 values are written as
+ *          fixed-length typed vectors without a length.  Readers can then
+ *          use flexi_cursor_typed_vector_data on the vector.
+ *
+ * @param[in,out] writer Writer to operate on.
+ * @param[in] enable True to write typed vectors, false to always write
+ *                   untyped vectors.
+ */
+FLEXI_API void
+flexi_writer_set_typed_vectors(flexi_writer_s *writer, bool enable);
+
+/**
+ * @brief Collect writes in a buffer, and pass them to the stream in chunks
+ *        instead of one call per value, padding or type byte.
+ *
+ * @details The buffer is flushed when it fills up, by flexi_write_finalize
+ *          and by flexi_writer_flush.  Writes larger than the buffer are
+ *          passed to the stream directly.  Until the buffer is flushed, the
+ *          stream's own tell function will not count buffered data.
+ *
+ * @param[in,out] writer Writer to operate on.
+ * @param[in] buffer Buffer to collect writes in, or NULL to stop buffering.
+ *                   Any previous buffer is flushed first.
+ * @param[in] len Length of buffer in bytes.
+ * @return FLEXI_OK || FLEXI_ERR_BADWRITE || FLEXI_ERR_PARAM.
+ */
+FLEXI_API flexi_result_e
+flexi_writer_set_buffer(flexi_writer_s *writer, void *buffer,
+    flexi_ssize_t len);
+
+/**
+ * @brief Pass any buffered writes to the stream.
+ *
+ * @param[in,out] writer Writer to operate on.
+ * @return FLEXI_OK || FLEXI_ERR_BADWRITE.
+ */
+FLEXI_API flexi_result_e
+flexi_writer_flush(flexi_writer_s *writer);
+
 /**
  * @brief Destroy the writer by popping all values from the stack.
  *
@@ -835,6 +1584,78 @@ flexi_make_writer(const flexi_stack_s *stack, const flexi_ostream_s *ostream,
 FLEXI_API flexi_result_e
 flexi_destroy_writer(flexi_writer_s *writer);
 
+/**
+ * @brief Reset the writer so it can write a new message, keeping the memory
+ *        of its stack, stream, pools and write buffer.
+ *
+ * @details Pops all values from the stack, discards any buffered writes,
+ *          empties every pool and clears any previous error.  Pools hold
+ *          offsets into the old message, so their entries cannot be kept,
+ *          but their tables stay set up.
+ *
+ * @note A stream created with flexi_mem_ostream is rewound by this call.
+ *       Any other stream must be rewound by the caller beforehand.
+ *
+ * @param[in,out] writer Writer to reset.
+ * @return FLEXI_OK || FLEXI_ERR_BADSTACK || FLEXI_ERR_BADWRITE.
+ */
+FLEXI_API flexi_result_e
+flexi_writer_reset(flexi_writer_s *writer);
+
+/**
+ * @brief Reset the writer and start measuring a message instead of writing
+ *        it.  Nothing is passed to the stream until the dry run ends.
+ *
+ * @details The dry run sorts maps and pools values exactly like the real
+ *          write, so writing the same message again after the dry run
+ *          produces exactly the measured number of bytes, and fails where
+ *          the real write would fail.
+ *
+ * @note Comparing pooled values and sorting the keys passed to
+ *       flexi_write_map_keys needs the bytes of keys, pooled strings and
+ *       keys vectors, which the dry run keeps in the memory passed to
+ *       flexi_writer_set_dry_run_scratch.  If those bytes are needed but
+ *       were not kept, the write fails with FLEXI_ERR_BADWRITE, like a real
+ *       write into a stream that is too small.
+ *
+ * @param[in,out] writer Writer to operate on.
+ * @return FLEXI_OK || FLEXI_ERR_BADSTACK || FLEXI_ERR_BADWRITE.
+ */
+FLEXI_API flexi_result_e
+flexi_writer_begin_dry_run(flexi_writer_s *writer);
+
+/**
+ * @brief Set the memory that a dry run keeps copies of data in, so pooled
+ *        values can be compared and keys sorted without a stream.
+ *
+ * @details Every key is kept, as are strings no longer than the string
+ *          pool's max_len when a string pool is set, and keys vectors when
+ *          a keyset pool is set.  Each run of consecutive kept bytes also
+ *          needs 3 * sizeof(flexi_ssize_t) bytes of bookkeeping.  Data that
+ *          does not fit is not kept, and the dry run only fails if it needs
+ *          that data later.
+ *
+ * @param[in,out] writer Writer to operate on.
+ * @param[in] buffer Buffer to keep copies in, or NULL to keep nothing.
+ *                   Must be aligned for flexi_ssize_t.
+ * @param[in] len Length of buffer in bytes.
+ * @return FLEXI_OK || FLEXI_ERR_PARAM.
+ */
+FLEXI_API flexi_result_e
+flexi_writer_set_dry_run_scratch(flexi_writer_s *writer, void *buffer,
+    flexi_ssize_t len);
+
+/**
+ * @brief Finish measuring a message, then reset the writer so the message
+ *        can be written for real.
+ *
+ * @param[in,out] writer Writer to operate on.
+ * @param[out] size Size of the measured message in bytes.
+ * @return FLEXI_OK || FLEXI_ERR_BADSTACK || FLEXI_ERR_BADWRITE.
+ */
+FLEXI_API flexi_result_e
+flexi_writer_end_dry_run(flexi_writer_s *writer, flexi_ssize_t *size);
+
 /**
  * @brief Push a null value to the stack.
  *
@@ -1112,6 +1933,9 @@ flexi_write_map(flexi_writer_s *writer, const char *key, flexi_ssize_t len,
  * @brief Write a vector to the stream.  Pops `len` values from the stack
  *        and pushes a single vector to the stack.
  *
+ * @note The vector might be written as a typed vector instead, see
+ *       flexi_writer_set_typed_vectors.
+ *
  * @param[in,out] writer Writer to operate on.
  * @param[in] key Key for use in a map.  NULL if there is no key.
  * @param[in] len Number of values on the stack to use for vector.
@@ -1217,6 +2041,8 @@ flexi_write_typed_vector_bool(flexi_writer_s *writer, const char *key,
  *        as the root of the message.  The message is considered "done" at
  *        this point.
  *
+ * @note Any buffered writes are flushed to the stream.
+ *
  * @param[in,out] writer Writer to operate on.
  * @return FLEXI_OK || FLEXI_ERR_BADSTACK || FLEXI_ERR_BADWRITE.
  */
@@ -1276,6 +2102,150 @@ typedef struct flexi_parser_s {
     bool (*boolean)(const char *key, bool val, void *user);
 } flexi_parser_s;
 
+/**
+ * @brief A single level of nesting in an in-progress parse.
+ *
+ * @warning All members of this struct are considered implementation details
+ *          and should not be used directly.
+ */
+typedef struct flexi_parse_frame_s {
+    flexi_iter_s iter;
+    uint32_t live;
+} flexi_parse_frame_s;
+
+/**
+ * @brief Maximum number of filters that can be passed to a single parse.
+ */
+#define FLEXI_PARSE_MAX_FILTERS (32)
+
+/**
+ * @brief Result of a callback which is called when a map or vector begins.
+ */
+typedef enum flexi_visit_e {
+    /**
+     * @brief Stop the parse with FLEXI_ERR_CALLBACK.
+     */
+    FLEXI_VISIT_ABORT,
+
+    /**
+     * @brief Parse the values of the map or vector.
+     */
+    FLEXI_VISIT_CONTINUE,
+
+    /**
+     * @brief Skip over the values of the map or vector without reading them.
+     *        The matching end callback is still called.
+     */
+    FLEXI_VISIT_SKIP,
+} flexi_visit_e;
+
+/**
+ * @brief Function called when a map or vector begins, which can choose to
+ *        skip its values.
+ */
+typedef flexi_visit_e (*flexi_visit_fn)(const char *key, flexi_ssize_t len,
+    void *user);
+
+/**
+ * @brief Options which control how flexi_parse_cursor_ex walks a FlexBuffer.
+ *
+ * @details Always create this struct with flexi_make_parse_options, so any
+ *          options you don't set are given their defaults.
+ */
+typedef struct flexi_parse_options_s {
+    /**
+     * @brief Array of frames, one per level of nested map or vector.
+     */
+    flexi_parse_frame_s *frames;
+    flexi_ssize_t frames_len;
+
+    /**
+     * @brief Compiled paths to values which should be parsed.  Only
+     *        matching values, their children and the maps and vectors
+     *        leading to them are passed to callbacks, everything else is
+     *        skipped without being read.  If there are no filters, every
+     *        value is parsed.
+     */
+    const flexi_path_s *filters;
+    int filters_len;
+
+    /**
+     * @brief If set, called instead of the parser's map_begin callback.
+     */
+    flexi_visit_fn map_begin;
+
+    /**
+     * @brief If set, called instead of the parser's vector_begin callback.
+     */
+    flexi_visit_fn vector_begin;
+
+    /**
+     * @brief Buffer of batch_len 8-byte values, which runs of direct scalars
+     *        of the same type inside untyped vectors are decoded into and
+     *        passed to the batch callbacks below.  Must be suitably aligned
+     *        for int64_t, uint64_t and double.
+     */
+    void *batch;
+    flexi_ssize_t batch_len;
+
+    /**
+     * @brief If set, called with runs of signed integers instead of calling
+     *        the parser's sint callback once per value.
+     */
+    bool (*sint_batch)(const int64_t *values, flexi_ssize_t count, void *user);
+
+    /**
+     * @brief If set, called with runs of unsigned integers instead of
+     *        calling the parser's uint callback once per value.
+     */
+    bool (*uint_batch)(const uint64_t *values, flexi_ssize_t count,
+        void *user);
+
+    /**
+     * @brief If set, called with runs of floats of either width instead of
+     *        calling the parser's f32 or f64 callback once per value.
+     */
+    bool (*f64_batch)(const double *values, flexi_ssize_t count, void *user);
+
+    /**
+     * @brief Buffer of visited_size bytes, used as a hash set of maps and
+     *        untyped vectors which have already been parsed.  If set, a map
+     *        or vector referenced from more than one place is only parsed
+     *        the first time, and later references are passed to the shared
+     *        callback instead, without counting against max_iterables.
+     *        References only match if they have the same type and width as
+     *        well as the same address.  Must be aligned for uint32_t, see
+     *        flexi_parse_visited_size.
+     */
+    void *visited;
+    flexi_ssize_t visited_size;
+
+    /**
+     * @brief Called instead of parsing a map or vector again.  id is the
+     *        number of maps and untyped vectors which were begun before it
+     *        was first parsed.  Must be set if visited is set.
+     */
+    bool (*shared)(const char *key, flexi_type_e type, flexi_ssize_t id,
+        void *user);
+
+    /**
+     * @brief Maximum number of maps and untyped vectors to parse in this
+     *        message before failing with FLEXI_ERR_PARSELIMIT.  Defaults to
+     *        FLEXI_CONFIG_MAX_ITERABLES, and can be raised or lowered per
+     *        message.
+     */
+    flexi_ssize_t max_iterables;
+
+    /**
+     * @brief Maximum number of values to parse in this message before
+     *        failing with FLEXI_ERR_PARSELIMIT, or 0 for no limit.  Values
+     *        are counted the same way as the budget of flexi_parse_step,
+     *        and the count carries across steps, so this bounds the total
+     *        work spent on a message.
+     */
+    flexi_ssize_t max_values;
+} flexi_parse_options_s;
+
 /**
  * @brief Starting from the value at the cursor, parse the FlexBuffer while
  *        calling the appropriate callbacks.
@@ -1283,12 +2253,138 @@ typedef struct flexi_parser_s {
  * @param[in] parser Parser to operate on.
  * @param[in] cursor Cursor to start parse at.
  * @param[in] user User pointer - passed to all callbacks.
- * @return FLEXI_OK || FLEXI_ERR_CALLBACK || FLEXI_ERR_BADREAD.
+ * @return FLEXI_OK || FLEXI_ERR_CALLBACK || FLEXI_ERR_BADREAD ||
+ *         FLEXI_ERR_PARSELIMIT.
  */
 FLEXI_API flexi_result_e
 flexi_parse_cursor(const flexi_parser_s *parser, const flexi_cursor_s *cursor,
     void *user);
 
+/**
+ * @brief Return the size of a buffer in bytes that is large enough to track
+ *        the given number of parsed maps and vectors.
+ *
+ * @details Once the buffer is full, maps and vectors are parsed every time
+ *          they are referenced, as if there was no buffer.
+ *
+ * @param[in] count Number of maps and vectors to track.
+ * @return Size of buffer in bytes.
+ */
+FLEXI_API flexi_ssize_t
+flexi_parse_visited_size(flexi_ssize_t count);
+
+/**
+ * @brief Create parse options with every option set to its default.
+ *
+ * @param[in] frames Array of frames, one of which is used for every level
+ *                   of nested map or vector.
+ * @param[in] frames_len Number of frames in the array.  Maps and vectors
+ *                       nested deeper than this fail the parse.
+ * @return Parse options.
+ */
+FLEXI_API flexi_parse_options_s
+flexi_make_parse_options(flexi_parse_frame_s *frames, flexi_ssize_t frames_len);
+
+/**
+ * @brief Starting from the value at the cursor, parse the FlexBuffer while
+ *        calling the appropriate callbacks.
+ *
+ * @details Nested maps and vectors are tracked in the caller-provided
+ *          frames instead of on the call stack, so nesting is limited only
+ *          by the number of frames.
+ *
+ * @param[in] parser Parser to operate on.
+ * @param[in] cursor Cursor to start parse at.
+ * @param[in] user User pointer - passed to all callbacks.
+ * @param[in] options Parse options.
+ * @return FLEXI_OK || FLEXI_ERR_PARAM if there are more than
+ *         FLEXI_PARSE_MAX_FILTERS filters, the batch buffer is missing or
+ *         the visited buffer is too small or has no shared callback ||
+ *         FLEXI_ERR_CALLBACK ||
+ *         FLEXI_ERR_BADREAD || FLEXI_ERR_PARSELIMIT.
+ */
+FLEXI_API flexi_result_e
+flexi_parse_cursor_ex(const flexi_parser_s *parser,
+    const flexi_cursor_s *cursor, void *user,
+    const flexi_parse_options_s *options);
+
+/**
+ * @brief State of a parse which can be run a few values at a time.
+ *
+ * @warning All members of this struct are considered implementation details
+ *          and should not be used directly.
+ */
+typedef struct flexi_parse_ctx_s {
+    const flexi_parser_s *parser;
+    void *user;
+    flexi_parse_frame_s *frames;
+    flexi_ssize_t frames_len;
+    const flexi_path_s *filters;
+    int filters_len;
+    flexi_visit_fn map_begin;
+    flexi_visit_fn vector_begin;
+    void *batch;
+    flexi_ssize_t batch_len;
+    bool (*sint_batch)(const int64_t *values, flexi_ssize_t count, void *user);
+    bool (*uint_batch)(const uint64_t *values, flexi_ssize_t count,
+        void *user);
+    bool (*f64_batch)(const double *values, flexi_ssize_t count, void *user);
+    uint32_t *visited;
+    flexi_ssize_t visited_capacity;
+    flexi_ssize_t visited_count;
+    bool (*shared)(const char *key, flexi_type_e type, flexi_ssize_t id,
+        void *user);
+    flexi_ssize_t begun;
+    flexi_ssize_t depth;
+    flexi_ssize_t iterables;
+    flexi_ssize_t max_iterables;
+    flexi_ssize_t values;
+    flexi_ssize_t max_values;
+    flexi_cursor_s root;
+    bool started;
+    flexi_result_e result;
+} flexi_parse_ctx_s;
+
+/**
+ * @brief Prepare to parse the FlexBuffer starting from the value at the
+ *        cursor, a few values at a time.
+ *
+ * @details No callbacks are called until flexi_parse_step.  The frames and
+ *          filters in the options, as well as the parser and the message
+ *          itself, must outlive the parse.
+ *
+ * @param[out] ctx Parse context to initialize.
+ * @param[in] parser Parser to operate on.
+ * @param[in] cursor Cursor to start parse at.
+ * @param[in] user User pointer - passed to all callbacks.
+ * @param[in] options Parse options.
+ * @return FLEXI_OK || FLEXI_ERR_PARAM.
+ */
+FLEXI_API flexi_result_e
+flexi_parse_begin(flexi_parse_ctx_s *ctx, const flexi_parser_s *parser,
+    const flexi_cursor_s *cursor, void *user,
+    const flexi_parse_options_s *options);
+
+/**
+ * @brief Continue a parse, calling the appropriate callbacks for at most
+ *        the given number of values.
+ *
+ * @details Every value counts against the budget, including maps, vectors
+ *          and values which are skipped by filters, as does the end of
+ *          every map and vector.  A batch of scalars counts as a single
+ *          value.  Once the parse has finished, calling this again returns
+ *          the same result.  The max_values and max_iterables parse options
+ *          limit the whole message across all steps.
+ *
+ * @param[in,out] ctx Parse context.
+ * @param[in] budget Maximum number of values to parse.
+ * @return FLEXI_OK if the parse has finished || FLEXI_INCOMPLETE if the
+ *         budget ran out first || FLEXI_ERR_PARAM || FLEXI_ERR_CALLBACK ||
+ *         FLEXI_ERR_BADREAD || FLEXI_ERR_PARSELIMIT.
+ */
+FLEXI_API flexi_result_e
+flexi_parse_step(flexi_parse_ctx_s *ctx, flexi_ssize_t budget);
+
 #endif // #if FLEXI_FEATURE_PARSER
 
 /******************************************************************************/
@@ -1439,6 +2535,352 @@ flexi_write_typed_vector<double>(flexi_writer_s *writer, const char *key,
 
 #endif // #if FLEXI_IMPL_CPLUSPLUS
 
+#if FLEXI_FEATURE_PARSER
+
+#if FLEXI_IMPL_CPLUSPLUS >= 201703L
+
+#include <type_traits>
+#include <utility>
+
+namespace flexi {
+
+namespace detail {
+
+// Members are detected by calling them with the arguments the parser
+// passes, so overloaded and template members are found as well.
+#define FLEXI_IMPL_HAS_MEMBER(name, sig)                                       \
+    template<typename H, typename Sig, typename = void>                        \
+    struct has_##name##_call : std::false_type {};                             \
+    template<typename H, typename... Args>                                     \
+    struct has_##name##_call<H, void(Args...),                                 \
+        std::void_t<decltype(std::declval<H &>().name(                         \
+            std::declval<Args>()...))>> : std::true_type {};                   \
+    template<typename H> using has_##name = has_##name##_call<H, sig>;
+
+FLEXI_IMPL_HAS_MEMBER(null, void(const char *))
+FLEXI_IMPL_HAS_MEMBER(sint, void(const char *, int64_t))
+FLEXI_IMPL_HAS_MEMBER(uint, void(const char *, uint64_t))
+FLEXI_IMPL_HAS_MEMBER(f32, void(const char *, float))
+FLEXI_IMPL_HAS_MEMBER(f64, void(const char *, double))
+FLEXI_IMPL_HAS_MEMBER(key, void(const char *, const char *))
+FLEXI_IMPL_HAS_MEMBER(string, void(const char *, const char *, flexi_ssize_t))
+FLEXI_IMPL_HAS_MEMBER(map_begin, void(const char *, flexi_ssize_t))
+FLEXI_IMPL_HAS_MEMBER(map_end, void())
+FLEXI_IMPL_HAS_MEMBER(vector_begin, void(const char *, flexi_ssize_t))
+FLEXI_IMPL_HAS_MEMBER(vector_end, void())
+FLEXI_IMPL_HAS_MEMBER(typed_vector,
+    void(const char *, const void *, flexi_type_e, int, flexi_ssize_t))
+FLEXI_IMPL_HAS_MEMBER(blob, void(const char *, const uint8_t *, flexi_ssize_t))
+FLEXI_IMPL_HAS_MEMBER(boolean, void(const char *, bool))
+
+#undef FLEXI_IMPL_HAS_MEMBER
+
+/**
+ * @brief State of an in-progress parse with a statically-known handler.
+ */
+template<typename Handler> class parse_ctx {
+    struct frame_s {
+        flexi_iter_s iter;
+        flexi_type_e type;
+    };
+
+    Handler &m_handler;
+    frame_s m_frames[FLEXI_CONFIG_MAX_DEPTH - 1];
+    flexi_ssize_t m_depth = 0;
+    int m_iterables = 0;
+
+    flexi_result_e begin(const char *key, const flexi_cursor_s *cursor,
+        flexi_type_e type)
+    {
+        flexi_ssize_t len = flexi_cursor_length(cursor);
+        bool ok = true;
+        if (type == FLEXI_TYPE_MAP) {
+            if constexpr (has_map_begin<Handler>::value) {
+                ok = m_handler.map_begin(key, len);
+            }
+        } else {
+            if constexpr (has_vector_begin<Handler>::value) {
+                ok = m_handler.vector_begin(key, len);
+            }
+        }
+        return ok ? FLEXI_OK : FLEXI_ERR_CALLBACK;
+    }
+
+    flexi_result_e end(flexi_type_e type)
+    {
+        bool ok = true;
+        if (type == FLEXI_TYPE_MAP) {
+            if constexpr (has_map_end<Handler>::value) {
+                ok = m_handler.map_end();
+            }
+        } else {
+            if constexpr (has_vector_end<Handler>::value) {
+                ok = m_handler.vector_end();
+            }
+        }
+        return ok ? FLEXI_OK : FLEXI_ERR_CALLBACK;
+    }
+
+    flexi_result_e push(const char *key, const flexi_cursor_s *cursor,
+        flexi_type_e type)
+    {
+        m_iterables += 1;
+        if (m_iterables >= FLEXI_CONFIG_MAX_ITERABLES) {
+            // Defuse FlexBuffer "bomb" inputs.
+            return FLEXI_ERR_PARSELIMIT;
+        }
+
+        if (m_depth >= FLEXI_CONFIG_MAX_DEPTH - 1) {
+            // Out of frames to nest into.
+            return FLEXI_ERR_PARSELIMIT;
+        }
+
+        flexi_result_e res = begin(key, cursor, type);
+        if (FLEXI_ERROR(res)) {
+            return res;
+        }
+
+        frame_s *frame = &m_frames[m_depth];
+        res = flexi_cursor_iter_begin(cursor, &frame->iter);
+        if (FLEXI_ERROR(res)) {
+            return res;
+        }
+
+        frame->type = type;
+        m_depth += 1;
+        return FLEXI_OK;
+    }
+
+    flexi_result_e vector_keys(const char *key, const flexi_cursor_s *cursor)
+    {
+        flexi_ssize_t len = flexi_cursor_length(cursor);
+        if constexpr (has_vector_begin<Handler>::value) {
+            m_handler.vector_begin(key, len);
+        }
+
+        if constexpr (has_key<Handler>::value) {
+            for (flexi_ssize_t i = 0; i < len; i++) {
+                flexi_cursor_s each;
+                const char *str;
+                if (FLEXI_ERROR(flexi_cursor_seek_vector_index(
+                        cursor, i, &each)) ||
+                    FLEXI_ERROR(flexi_cursor_key(&each, &str))) {
+                    return FLEXI_ERR_BADREAD;
+                }
+
+                m_handler.key(nullptr, str);
+            }
+        }
+
+        if constexpr (has_vector_end<Handler>::value) {
+            m_handler.vector_end();
+        }
+        return FLEXI_OK;
+    }
+
+    flexi_result_e typed_vector(const char *key, const flexi_cursor_s *cursor)
+    {
+        if constexpr (has_typed_vector<Handler>::value) {
+            const void *ptr;
+            flexi_type_e type;
+            int width;
+            flexi_ssize_t count;
+            flexi_result_e res = flexi_cursor_typed_vector_data(
+                cursor, &ptr, &type, &width, &count);
+            if (FLEXI_ERROR(res)) {
+                return res;
+            }
+
+            return m_handler.typed_vector(key, ptr, type, width, count)
+                       ? FLEXI_OK
+                       : FLEXI_ERR_CALLBACK;
+        }
+        return FLEXI_OK;
+    }
+
+    flexi_result_e value(const char *key, const flexi_cursor_s *cursor)
+    {
+        flexi_type_e type = flexi_cursor_type(cursor);
+        switch (type) {
+        case FLEXI_TYPE_NULL:
+            if constexpr (has_null<Handler>::value) {
+                return m_handler.null(key) ? FLEXI_OK : FLEXI_ERR_CALLBACK;
+            }
+            return FLEXI_OK;
+        case FLEXI_TYPE_SINT:
+        case FLEXI_TYPE_INDIRECT_SINT:
+            if constexpr (has_sint<Handler>::value) {
+                int64_t v;
+                flexi_result_e res = flexi_cursor_sint(cursor, &v);
+                if (FLEXI_ERROR(res)) {
+                    return res;
+                }
+                return m_handler.sint(key, v) ? FLEXI_OK : FLEXI_ERR_CALLBACK;
+            }
+            return FLEXI_OK;
+        case FLEXI_TYPE_UINT:
+        case FLEXI_TYPE_INDIRECT_UINT:
+            if constexpr (has_uint<Handler>::value) {
+                uint64_t v;
+                flexi_result_e res = flexi_cursor_uint(cursor, &v);
+                if (FLEXI_ERROR(res)) {
+                    return res;
+                }
+                return m_handler.uint(key, v) ? FLEXI_OK : FLEXI_ERR_CALLBACK;
+            }
+            return FLEXI_OK;
+        case FLEXI_TYPE_FLOAT:
+        case FLEXI_TYPE_INDIRECT_FLOAT:
+            if (flexi_cursor_width(cursor) == 4) {
+                if constexpr (has_f32<Handler>::value) {
+                    float v;
+                    flexi_result_e res = flexi_cursor_f32(cursor, &v);
+                    if (FLEXI_ERROR(res)) {
+                        return res;
+                    }
+                    return m_handler.f32(key, v) ? FLEXI_OK
+                                                 : FLEXI_ERR_CALLBACK;
+                }
+            } else {
+                if constexpr (has_f64<Handler>::value) {
+                    double v;
+                    flexi_result_e res = flexi_cursor_f64(cursor, &v);
+                    if (FLEXI_ERROR(res)) {
+                        return res;
+                    }
+                    return m_handler.f64(key, v) ? FLEXI_OK
+                                                 : FLEXI_ERR_CALLBACK;
+                }
+            }
+            return FLEXI_OK;
+        case FLEXI_TYPE_KEY:
+            if constexpr (has_key<Handler>::value) {
+                const char *str;
+                flexi_result_e res = flexi_cursor_key(cursor, &str);
+                if (FLEXI_ERROR(res)) {
+                    return res;
+                }
+                return m_handler.key(key, str) ? FLEXI_OK : FLEXI_ERR_CALLBACK;
+            }
+            return FLEXI_OK;
+        case FLEXI_TYPE_STRING:
+            if constexpr (has_string<Handler>::value) {
+                const char *str;
+                flexi_ssize_t len;
+                flexi_result_e res = flexi_cursor_string(cursor, &str, &len);
+                if (FLEXI_ERROR(res)) {
+                    return res;
+                }
+                return m_handler.string(key, str, len) ? FLEXI_OK
+                                                       : FLEXI_ERR_CALLBACK;
+            }
+            return FLEXI_OK;
+        case FLEXI_TYPE_MAP:
+        case FLEXI_TYPE_VECTOR: return push(key, cursor, type);
+        case FLEXI_TYPE_VECTOR_KEY: return vector_keys(key, cursor);
+        case FLEXI_TYPE_VECTOR_SINT:
+        case FLEXI_TYPE_VECTOR_UINT:
+        case FLEXI_TYPE_VECTOR_FLOAT:
+        case FLEXI_TYPE_VECTOR_BOOL:
+        case FLEXI_TYPE_VECTOR_SINT2:
+        case FLEXI_TYPE_VECTOR_UINT2:
+        case FLEXI_TYPE_VECTOR_FLOAT2:
+        case FLEXI_TYPE_VECTOR_SINT3:
+        case FLEXI_TYPE_VECTOR_UINT3:
+        case FLEXI_TYPE_VECTOR_FLOAT3:
+        case FLEXI_TYPE_VECTOR_SINT4:
+        case FLEXI_TYPE_VECTOR_UINT4:
+        case FLEXI_TYPE_VECTOR_FLOAT4: return typed_vector(key, cursor);
+        case FLEXI_TYPE_BLOB:
+            if constexpr (has_blob<Handler>::value) {
+                const uint8_t *blob;
+                flexi_ssize_t len;
+                flexi_result_e res = flexi_cursor_blob(cursor, &blob, &len);
+                if (FLEXI_ERROR(res)) {
+                    return res;
+                }
+                return m_handler.blob(key, blob, len) ? FLEXI_OK
+                                                      : FLEXI_ERR_CALLBACK;
+            }
+            return FLEXI_OK;
+        case FLEXI_TYPE_BOOL:
+            if constexpr (has_boolean<Handler>::value) {
+                bool v;
+                flexi_result_e res = flexi_cursor_bool(cursor, &v);
+                if (FLEXI_ERROR(res)) {
+                    return res;
+                }
+                return m_handler.boolean(key, v) ? FLEXI_OK
+                                                 : FLEXI_ERR_CALLBACK;
+            }
+            return FLEXI_OK;
+        default: break;
+        }
+
+        return FLEXI_ERR_INTERNAL;
+    }
+
+    flexi_result_e next()
+    {
+        frame_s *frame = &m_frames[m_depth - 1];
+
+        const char *key;
+        flexi_cursor_s each;
+        flexi_result_e res = flexi_iter_next(&frame->iter, &key, &each);
+        if (res == FLEXI_ERR_NOTFOUND) {
+            m_depth -= 1;
+            return end(frame->type);
+        } else if (FLEXI_ERROR(res)) {
+            return res;
+        }
+
+        return value(key, &each);
+    }
+
+public:
+    explicit parse_ctx(Handler &handler) : m_handler(handler) {}
+
+    flexi_result_e run(const flexi_cursor_s *cursor)
+    {
+        flexi_result_e res = value(nullptr, cursor);
+        while (FLEXI_SUCCESS(res) && m_depth > 0) {
+            res = next();
+        }
+        return res;
+    }
+};
+
+} // namespace detail
+
+/**
+ * @brief Starting from the value at the cursor, parse the FlexBuffer while
+ *        calling the appropriate member functions of the handler.
+ *
+ * @details Handler member functions have the same names and parameters as
+ *          the callbacks in flexi_parser_s, minus the user pointer.  They
+ *          are called directly instead of through function pointers, so
+ *          they can be inlined, and values with no matching member are
+ *          skipped without being read.  Maps and vectors are still walked
+ *          if the handler has no begin or end member.
+ *
+ * @param[in] cursor Cursor to start parse at.
+ * @param[in] handler Handler to call.
+ * @return FLEXI_OK || FLEXI_ERR_CALLBACK || FLEXI_ERR_BADREAD ||
+ *         FLEXI_ERR_PARSELIMIT.
+ */
+template<typename Handler> inline flexi_result_e
+parse(const flexi_cursor_s *cursor, Handler &handler)
+{
+    detail::parse_ctx<Handler> ctx(handler);
+    return ctx.run(cursor);
+}
+
+} // namespace flexi
+
+#endif // #if FLEXI_IMPL_CPLUSPLUS >= 201703L
+
+#endif // #if FLEXI_FEATURE_PARSER
+
 #if FLEXI_FEATURE_JSON
 
 #if FLEXI_IMPL_CPLUSPLUS
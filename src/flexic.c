@@ -22,38 +22,11 @@
 
 #include "flexic.h"
 
+#include <float.h>
 #include <string.h>
 
 /******************************************************************************/
 
-#ifndef FLEXI_CONFIG_MAX_DEPTH
-/**
- * @brief The maximum number of nested vectors or maps before the parse fails.
- *
- * @details A maliciously-formed FlexBuffer could nest vectors inside vectors
- *          and crash the parser with a stack overflow.  This limit prevents
- *          excessive nesting which would result in such a crash.
- */
-#define FLEXI_CONFIG_MAX_DEPTH (32)
-#endif
-
-#ifndef FLEXI_CONFIG_MAX_ITERABLES
-/**
- * @brief The maximum number of non-typed vectors and maps to parse before
- *        failing.
- *
- * @details FlexBuffers allow for a single value to be referenced from multiple
- *          places in the message.  However, this feature has the potential
- *          for misuse in maliciously-designed "FlexBuffer bomb" inputs where
- *          iterable containers are shared and nested in ways that take a
- *          long time to parse.
- *
- *          Note that this limit does not count typed vectors, as these do
- *          not allow nesting other iterables inside them.
- */
-#define FLEXI_CONFIG_MAX_ITERABLES (2048)
-#endif
-
 #ifndef FLEXI_CONFIG_SEEK_MAP_KEY_LINEAR_MAX
 /**
  * @brief The maximum length of a map where keys are looked up linearly.
@@ -107,6 +80,19 @@
 
 #define OPT_STRDUP(w, k) ((w)->opt_strdup && k != NULL ? (w)->opt_strdup(k) : k)
 
+/**
+ * @brief Number of flexi_ssize_t in each slot of a writer pool: a hash, the
+ *        offset + 1 where 0 is empty, and one extra value.
+ */
+#define POOL_SLOT_LEN (3)
+
+/**
+ * @brief Number of flexi_ssize_t in each entry of dry run scratch memory:
+ *        the stream offset, the position in the scratch memory and the
+ *        length of a run of kept data.
+ */
+#define SCRATCH_ENTRY_LEN (3)
+
 typedef struct parse_limits_s {
     int depth;
     int iterables;
@@ -164,6 +150,40 @@ round_to_pow2_mul64(uint64_t x, uint64_t m)
     return (x + (m - 1)) & ~(m - 1);
 }
 
+/**
+ * @brief Hash a null-terminated string with 32-bit FNV-1a.
+ *
+ * @param[in] str String to hash.
+ * @return Hash of string.
+ */
+static uint32_t
+hash_str(const char *str)
+{
+    uint32_t hash = UINT32_C(2166136261);
+    for (; *str != '\0'; str++) {
+        hash = (hash ^ (uint8_t)*str) * UINT32_C(16777619);
+    }
+    return hash;
+}
+
+/**
+ * @brief Hash a buffer of bytes with 32-bit FNV-1a.
+ *
+ * @param[in] data Data to hash.
+ * @param[in] len Length of data in bytes.
+ * @return Hash of data.
+ */
+static uint32_t
+hash_mem(const void *data, flexi_ssize_t len)
+{
+    const uint8_t *bytes = (const uint8_t *)data;
+    uint32_t hash = UINT32_C(2166136261);
+    for (flexi_ssize_t i = 0; i < len; i++) {
+        hash = (hash ^ bytes[i]) * UINT32_C(16777619);
+    }
+    return hash;
+}
+
 /**
  * @brief Return true if the type is any signed integer type.
  */
@@ -267,6 +287,16 @@ type_is_typed_vector(flexi_type_e type)
     return false;
 }
 
+/**
+ * @brief Return true if the type is a fixed-length typed vector, which has
+ *        no length prefix.
+ */
+static bool
+type_is_fixed_typed_vector(flexi_type_e type)
+{
+    return type >= FLEXI_TYPE_VECTOR_SINT2 && type <= FLEXI_TYPE_VECTOR_FLOAT4;
+}
+
 /**
  * @brief Check to see if the type has a valid width.
  */
@@ -587,12 +617,83 @@ span_read_f64(const flexi_span_s *span, const char *src, int width, double *dst)
     }
 }
 
+/**
+ * @brief flexi_stack_at_fn for flexi_array_stack_s.
+ */
+static flexi_value_s *
+array_stack_at(flexi_ssize_t offset, void *user)
+{
+    flexi_array_stack_s *array = (flexi_array_stack_s *)user;
+    if (offset < 0 || offset >= array->count) {
+        return NULL;
+    }
+    return &array->values[offset];
+}
+
+/**
+ * @brief flexi_stack_count_fn for flexi_array_stack_s.
+ */
+static flexi_ssize_t
+array_stack_count(void *user)
+{
+    return ((flexi_array_stack_s *)user)->count;
+}
+
+/**
+ * @brief flexi_stack_push_fn for flexi_array_stack_s.
+ */
+static flexi_value_s *
+array_stack_push(void *user)
+{
+    flexi_array_stack_s *array = (flexi_array_stack_s *)user;
+    if (array->count >= array->capacity) {
+        if (array->realloc_fn == NULL) {
+            // Fixed stack is full.
+            return NULL;
+        }
+
+        flexi_ssize_t capacity = array->capacity > 0 ? array->capacity * 2 : 64;
+        void *values = array->realloc_fn(
+            array->values, (size_t)capacity * sizeof(flexi_value_s));
+        if (values == NULL) {
+            return NULL;
+        }
+
+        array->values = (flexi_value_s *)values;
+        array->capacity = capacity;
+    }
+
+    array->count += 1;
+    return &array->values[array->count - 1];
+}
+
+/**
+ * @brief flexi_stack_pop_fn for flexi_array_stack_s.
+ */
+static flexi_ssize_t
+array_stack_pop(flexi_ssize_t count, void *user)
+{
+    flexi_array_stack_s *array = (flexi_array_stack_s *)user;
+    count = MIN(count, array->count);
+    array->count -= count;
+    return count;
+}
+
 /**
  * @brief Wrapper for flexi_stack_s at function call.
  */
 static flexi_value_s *
 stack_at(const flexi_stack_s *stack, flexi_ssize_t offset)
 {
+    if (stack->at == array_stack_at) {
+        // Skip the call for the built-in array stack.
+        const flexi_array_stack_s *array =
+            (const flexi_array_stack_s *)stack->user;
+        if (offset < 0 || offset >= array->count) {
+            return NULL;
+        }
+        return &array->values[offset];
+    }
     return stack->at(offset, stack->user);
 }
 
@@ -602,6 +703,9 @@ stack_at(const flexi_stack_s *stack, flexi_ssize_t offset)
 static flexi_ssize_t
 stack_count(const flexi_stack_s *stack)
 {
+    if (stack->count == array_stack_count) {
+        return ((const flexi_array_stack_s *)stack->user)->count;
+    }
     return stack->count(stack->user);
 }
 
@@ -611,6 +715,13 @@ stack_count(const flexi_stack_s *stack)
 static flexi_value_s *
 stack_push(flexi_stack_s *stack)
 {
+    if (stack->push == array_stack_push) {
+        flexi_array_stack_s *array = (flexi_array_stack_s *)stack->user;
+        if (array->count < array->capacity) {
+            array->count += 1;
+            return &array->values[array->count - 1];
+        }
+    }
     return stack->push(stack->user);
 }
 
@@ -675,6 +786,129 @@ stack_roll_down(flexi_stack_s *stack, flexi_ssize_t dest)
     return true;
 }
 
+/**
+ * @brief A chunk of memory owned by flexi_mem_ostream_s, followed by its
+ *        data.
+ */
+struct flexi_mem_chunk_s {
+    flexi_mem_chunk_s *next;
+    flexi_ssize_t base;
+    flexi_ssize_t len;
+    flexi_ssize_t capacity;
+};
+
+#define MEM_CHUNK_DATA(c) ((char *)((c) + 1))
+
+/**
+ * @brief flexi_ostream_write_fn for flexi_mem_ostream_s.
+ */
+static bool
+mem_ostream_write(const void *ptr, flexi_ssize_t len, void *user)
+{
+    flexi_mem_ostream_s *mem = (flexi_mem_ostream_s *)user;
+    flexi_mem_chunk_s *tail = mem->tail;
+    if (tail == NULL || tail->capacity - tail->len < len) {
+        // Start a new chunk, so every write stays contiguous.
+        flexi_ssize_t capacity = MAX(mem->next_size, len);
+        flexi_mem_chunk_s *chunk = (flexi_mem_chunk_s *)mem->realloc_fn(
+            NULL, sizeof(flexi_mem_chunk_s) + (size_t)capacity);
+        if (chunk == NULL) {
+            return false;
+        }
+
+        chunk->next = NULL;
+        chunk->base = mem->len;
+        chunk->len = 0;
+        chunk->capacity = capacity;
+        if (tail != NULL) {
+            tail->next = chunk;
+        } else {
+            mem->head = chunk;
+        }
+
+        mem->tail = chunk;
+        mem->next_size = capacity * 2;
+        tail = chunk;
+    }
+
+    memcpy(MEM_CHUNK_DATA(tail) + tail->len, ptr, (size_t)len);
+    tail->len += len;
+    mem->len += len;
+    return true;
+}
+
+/**
+ * @brief flexi_ostream_data_at_fn for flexi_mem_ostream_s.
+ */
+static const void *
+mem_ostream_data_at(flexi_ssize_t index, void *user)
+{
+    flexi_mem_ostream_s *mem = (flexi_mem_ostream_s *)user;
+    if (index < 0 || index >= mem->len) {
+        return NULL;
+    }
+
+    // Most reads are of recently written data.
+    flexi_mem_chunk_s *chunk = mem->tail;
+    if (index < chunk->base) {
+        chunk = mem->head;
+        while (index >= chunk->base + chunk->len) {
+            chunk = chunk->next;
+        }
+    }
+
+    return MEM_CHUNK_DATA(chunk) + (index - chunk->base);
+}
+
+/**
+ * @brief flexi_ostream_tell_fn for flexi_mem_ostream_s.
+ */
+static bool
+mem_ostream_tell(flexi_ssize_t *offset, void *user)
+{
+    *offset = ((flexi_mem_ostream_s *)user)->len;
+    return true;
+}
+
+/**
+ * @brief flexi_ostream_write_fn for flexi_fixed_ostream_s.
+ */
+static bool
+fixed_ostream_write(const void *ptr, flexi_ssize_t len, void *user)
+{
+    flexi_fixed_ostream_s *fixed = (flexi_fixed_ostream_s *)user;
+    if (len > fixed->capacity - fixed->len) {
+        return false;
+    }
+
+    memcpy(fixed->data + fixed->len, ptr, (size_t)len);
+    fixed->len += len;
+    return true;
+}
+
+/**
+ * @brief flexi_ostream_data_at_fn for flexi_fixed_ostream_s.
+ */
+static const void *
+fixed_ostream_data_at(flexi_ssize_t index, void *user)
+{
+    flexi_fixed_ostream_s *fixed = (flexi_fixed_ostream_s *)user;
+    if (index < 0 || index >= fixed->len) {
+        return NULL;
+    }
+    return fixed->data + index;
+}
+
+/**
+ * @brief flexi_ostream_tell_fn for flexi_fixed_ostream_s.
+ */
+static bool
+fixed_ostream_tell(flexi_ssize_t *offset, void *user)
+{
+    *offset = ((flexi_fixed_ostream_s *)user)->len;
+    return true;
+}
+
 /**
  * @brief Wrapper for flexi_ostream_s write function call.
  */
@@ -702,6 +936,214 @@ ostream_tell(flexi_ostream_s *ostream, flexi_ssize_t *offset)
     return ostream->tell(offset, ostream->user);
 }
 
+/**
+ * @brief Flush the write buffer of a writer to its stream.
+ *
+ * @param[in,out] writer Writer to flush.
+ * @return True if the buffer was empty or written successfully.
+ */
+static bool
+writer_flush(flexi_writer_s *writer)
+{
+    flexi_writer_buffer_s *buffer = &writer->buffer;
+    if (buffer->len == 0) {
+        return true;
+    }
+
+    if (!ostream_write(&writer->ostream, buffer->data, buffer->len)) {
+        return false;
+    }
+
+    buffer->base += buffer->len;
+    buffer->len = 0;
+    return true;
+}
+
+/**
+ * @brief Write data through the write buffer of a writer.
+ *
+ * @details Every single write lands either entirely in the buffer or
+ *          entirely in the stream, so data read back with writer_data_at
+ *          is always contiguous.
+ */
+static bool
+writer_write(flexi_writer_s *writer, const void *ptr, flexi_ssize_t len)
+{
+    if (writer->dry_run) {
+        // Only measure the write.
+        writer->dry_run_len += len;
+        return true;
+    }
+
+    flexi_writer_buffer_s *buffer = &writer->buffer;
+    if (buffer->data == NULL) {
+        return ostream_write(&writer->ostream, ptr, len);
+    }
+
+    if (buffer->len + len > buffer->capacity) {
+        if (!writer_flush(writer)) {
+            return false;
+        }
+
+        if (len > buffer->capacity) {
+            // Too large to buffer, write it directly.
+            if (!ostream_write(&writer->ostream, ptr, len)) {
+                return false;
+            }
+            buffer->base += len;
+            return true;
+        }
+    }
+
+    memcpy(buffer->data + buffer->len, ptr, (size_t)len);
+    buffer->len += len;
+    return true;
+}
+
+/**
+ * @brief Return an entry of dry run scratch memory.  Entries are stored
+ *        backwards from the end of the memory, in order of stream offset.
+ */
+static flexi_ssize_t *
+scratch_entry(const flexi_writer_scratch_s *scratch, flexi_ssize_t index)
+{
+    flexi_ssize_t *end = (flexi_ssize_t *)(scratch->data + scratch->capacity);
+    return end - ((index + 1) * SCRATCH_ENTRY_LEN);
+}
+
+/**
+ * @brief Keep a copy of data written during a dry run, so it can be read
+ *        back with writer_data_at.  Data which does not fit is dropped.
+ *
+ * @details Like writer_write, each write is kept whole or not at all, so
+ *          data read back from a kept write is always complete.
+ *
+ * @param[in,out] writer Writer to operate on.
+ * @param[in] offset Offset of data in the stream.
+ * @param[in] ptr Data to keep.
+ * @param[in] len Length of data.
+ */
+static void
+writer_keep(flexi_writer_s *writer, flexi_ssize_t offset, const void *ptr,
+    flexi_ssize_t len)
+{
+    flexi_writer_scratch_s *scratch = &writer->scratch;
+    if (scratch->data == NULL) {
+        return;
+    }
+
+    // Data that directly follows the last run in both the stream and the
+    // scratch memory extends that run instead of needing a new entry.
+    flexi_ssize_t *last = NULL;
+    if (scratch->count > 0) {
+        last = scratch_entry(scratch, scratch->count - 1);
+        if (last[0] + last[2] != offset || last[1] + last[2] != scratch->len) {
+            last = NULL;
+        }
+    }
+
+    flexi_ssize_t entries = scratch->count + (last == NULL ? 1 : 0);
+    flexi_ssize_t index_len =
+        entries * SCRATCH_ENTRY_LEN * (flexi_ssize_t)sizeof(flexi_ssize_t);
+    if (scratch->len + len > scratch->capacity - index_len) {
+        return;
+    }
+
+    memcpy(scratch->data + scratch->len, ptr, (size_t)len);
+    if (last != NULL) {
+        last[2] += len;
+    } else {
+        flexi_ssize_t *entry = scratch_entry(scratch, scratch->count);
+        entry[0] = offset;
+        entry[1] = scratch->len;
+        entry[2] = len;
+        scratch->count += 1;
+    }
+    scratch->len += len;
+}
+
+/**
+ * @brief Write data, and keep a copy of it if this is a dry run.
+ */
+static bool
+writer_write_kept(flexi_writer_s *writer, const void *ptr, flexi_ssize_t len)
+{
+    if (writer->dry_run) {
+        writer_keep(writer, writer->dry_run_len, ptr, len);
+    }
+    return writer_write(writer, ptr, len);
+}
+
+/**
+ * @brief Return a pointer to data kept during a dry run.
+ *
+ * @return Pointer to data, or NULL if the data at offset was not kept.
+ */
+static const void *
+writer_kept_at(const flexi_writer_s *writer, flexi_ssize_t offset)
+{
+    // Find the last run starting at or before the offset.
+    const flexi_writer_scratch_s *scratch = &writer->scratch;
+    flexi_ssize_t lo = 0, hi = scratch->count;
+    while (lo < hi) {
+        flexi_ssize_t mid = lo + ((hi - lo) / 2);
+        if (scratch_entry(scratch, mid)[0] <= offset) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    if (lo == 0) {
+        return NULL;
+    }
+
+    const flexi_ssize_t *entry = scratch_entry(scratch, lo - 1);
+    if (offset >= entry[0] + entry[2]) {
+        return NULL;
+    }
+    return scratch->data + entry[1] + (offset - entry[0]);
+}
+
+/**
+ * @brief Return a pointer to written data, which might still be buffered.
+ *
+ * @note During a dry run, only data kept with writer_write_kept can be
+ *       read back, and NULL is returned for anything else.
+ */
+static const void *
+writer_data_at(flexi_writer_s *writer, flexi_ssize_t offset)
+{
+    if (writer->dry_run) {
+        return writer_kept_at(writer, offset);
+    }
+
+    flexi_writer_buffer_s *buffer = &writer->buffer;
+    if (buffer->data != NULL && offset >= buffer->base) {
+        return buffer->data + (offset - buffer->base);
+    }
+    return ostream_data_at(&writer->ostream, offset);
+}
+
+/**
+ * @brief Return the position of the stream, including buffered data.
+ */
+static bool
+writer_tell(flexi_writer_s *writer, flexi_ssize_t *offset)
+{
+    if (writer->dry_run) {
+        *offset = writer->dry_run_len;
+        return true;
+    }
+
+    flexi_writer_buffer_s *buffer = &writer->buffer;
+    if (buffer->data != NULL) {
+        *offset = buffer->base + buffer->len;
+        return true;
+    }
+    return ostream_tell(&writer->ostream, offset);
+}
+
 /**
  * @brief Align stream to nearest multiple of width.
  *
@@ -720,7 +1162,7 @@ write_padding(flexi_writer_s *writer, int prefix, int width,
     }
 
     flexi_ssize_t src_offset;
-    if (!ostream_tell(&writer->ostream, &src_offset)) {
+    if (!writer_tell(writer, &src_offset)) {
         return false;
     }
 
@@ -732,7 +1174,7 @@ write_padding(flexi_writer_s *writer, int prefix, int width,
     static const char s_padding[8] = {0};
     for (; padding_len > 0; padding_len -= 8) {
         flexi_ssize_t write_len = MIN(padding_len, 8);
-        if (!ostream_write(&writer->ostream, s_padding, write_len)) {
+        if (!writer_write(writer, s_padding, write_len)) {
             return false;
         }
     }
@@ -742,19 +1184,19 @@ write_padding(flexi_writer_s *writer, int prefix, int width,
 }
 
 /**
- * @brief Write a signed integer to the passed writer.
+ * @brief Encode a signed integer into the passed buffer.
  *
  * @note Values will first be converted to the equivalent integer of the
  *       passed width.  Values that are too large or small for the passed
  *       width will not be truncated, but will return a failure state.
  *
- * @param[in] writer Writer to operate on.
- * @param[in] v Value to write.
- * @param[in] width Number of bytes to write.
- * @return True if value was fully written to the writer.
+ * @param[out] dst Buffer to encode into, at least width bytes long.
+ * @param[in] v Value to encode.
+ * @param[in] width Number of bytes to encode.
+ * @return True if value was fully encoded.
  */
 static bool
-write_sint_by_width(flexi_writer_s *writer, int64_t v, int width)
+encode_sint_by_width(uint8_t *dst, int64_t v, int width)
 {
     switch (width) {
     case 1: {
@@ -763,7 +1205,8 @@ write_sint_by_width(flexi_writer_s *writer, int64_t v, int width)
         }
 
         int8_t vv = (int8_t)v;
-        return ostream_write(&writer->ostream, &vv, sizeof(int8_t));
+        memcpy(dst, &vv, sizeof(int8_t));
+        return true;
     }
     case 2: {
         if (v > INT16_MAX || v < INT16_MIN) {
@@ -771,7 +1214,8 @@ write_sint_by_width(flexi_writer_s *writer, int64_t v, int width)
         }
 
         int16_t vv = (int16_t)v;
-        return ostream_write(&writer->ostream, &vv, sizeof(int16_t));
+        memcpy(dst, &vv, sizeof(int16_t));
+        return true;
     }
     case 4: {
         if (v > INT32_MAX || v < INT32_MIN) {
@@ -779,27 +1223,30 @@ write_sint_by_width(flexi_writer_s *writer, int64_t v, int width)
         }
 
         int32_t vv = (int32_t)v;
-        return ostream_write(&writer->ostream, &vv, sizeof(int32_t));
+        memcpy(dst, &vv, sizeof(int32_t));
+        return true;
     }
-    case 8: return ostream_write(&writer->ostream, &v, sizeof(int64_t));
+    case 8:
+        memcpy(dst, &v, sizeof(int64_t));
+        return true;
     }
     return false;
 }
 
 /**
- * @brief Write an unsigned integer to the passed writer.
+ * @brief Encode an unsigned integer into the passed buffer.
  *
  * @note Values will first be converted to the equivalent integer of the
  *       passed width.  Values that are too large or small for the passed
  *       width will not be truncated, but will return a failure state.
  *
- * @param[in] writer Writer to operate on.
- * @param[in] v Value to write.
- * @param[in] width Number of bytes to write.
- * @return True if value was fully written to the writer.
+ * @param[out] dst Buffer to encode into, at least width bytes long.
+ * @param[in] v Value to encode.
+ * @param[in] width Number of bytes to encode.
+ * @return True if value was fully encoded.
  */
 static bool
-write_uint_by_width(flexi_writer_s *writer, uint64_t v, int width)
+encode_uint_by_width(uint8_t *dst, uint64_t v, int width)
 {
     switch (width) {
     case 1: {
@@ -808,7 +1255,8 @@ write_uint_by_width(flexi_writer_s *writer, uint64_t v, int width)
         }
 
         uint8_t vv = (uint8_t)v;
-        return ostream_write(&writer->ostream, &vv, sizeof(uint8_t));
+        memcpy(dst, &vv, sizeof(uint8_t));
+        return true;
     }
     case 2: {
         if (v > UINT16_MAX) {
@@ -816,7 +1264,8 @@ write_uint_by_width(flexi_writer_s *writer, uint64_t v, int width)
         }
 
         uint16_t vv = (uint16_t)v;
-        return ostream_write(&writer->ostream, &vv, sizeof(uint16_t));
+        memcpy(dst, &vv, sizeof(uint16_t));
+        return true;
     }
     case 4: {
         if (v > UINT32_MAX) {
@@ -824,59 +1273,260 @@ write_uint_by_width(flexi_writer_s *writer, uint64_t v, int width)
         }
 
         uint32_t vv = (uint32_t)v;
-        return ostream_write(&writer->ostream, &vv, sizeof(uint32_t));
+        memcpy(dst, &vv, sizeof(uint32_t));
+        return true;
     }
-    case 8: return ostream_write(&writer->ostream, &v, sizeof(uint64_t));
+    case 8:
+        memcpy(dst, &v, sizeof(uint64_t));
+        return true;
     }
     return false;
 }
 
 /**
- * @brief Write a 4-byte float to the passed writer.
+ * @brief Encode a 4-byte float into the passed buffer.
  *
  * @note Floats of width != 4 bytes will be converted.
  *
- * @param[in] writer Writer to operate on.
- * @param[in] v Value to write.
- * @param[in] width Number of bytes to write.
- * @return True if value was fully written to the writer.
+ * @param[out] dst Buffer to encode into, at least width bytes long.
+ * @param[in] v Value to encode.
+ * @param[in] width Number of bytes to encode.
+ * @return True if value was fully encoded.
  */
 static bool
-write_f32(flexi_writer_s *writer, float v, int width)
+encode_f32(uint8_t *dst, float v, int width)
 {
     switch (width) {
-    case 4: return ostream_write(&writer->ostream, &v, sizeof(float));
-    case 8: {
+    case 4:
+        memcpy(dst, &v, sizeof(float));
+        return true;
+    case 8: {
         double vv = v;
-        return ostream_write(&writer->ostream, &vv, sizeof(double));
+        memcpy(dst, &vv, sizeof(double));
+        return true;
     }
     }
     return false;
 }
 
 /**
- * @brief Write an 8-byte float to the passed writer.
+ * @brief Encode an 8-byte float into the passed buffer.
  *
  * @note Floats of width != 8 bytes will be converted.
  *
- * @param[in] writer Writer to operate on.
- * @param[in] v Value to write.
- * @param[in] width Number of bytes to write.
- * @return True if value was fully written to the writer.
+ * @param[out] dst Buffer to encode into, at least width bytes long.
+ * @param[in] v Value to encode.
+ * @param[in] width Number of bytes to encode.
+ * @return True if value was fully encoded.
  */
 static bool
-write_f64(flexi_writer_s *writer, double v, int width)
+encode_f64(uint8_t *dst, double v, int width)
 {
     switch (width) {
     case 4: {
         float vv = (float)v;
-        return ostream_write(&writer->ostream, &vv, sizeof(float));
+        memcpy(dst, &vv, sizeof(float));
+        return true;
     }
-    case 8: return ostream_write(&writer->ostream, &v, sizeof(double));
+    case 8:
+        memcpy(dst, &v, sizeof(double));
+        return true;
     }
     return false;
 }
 
+/**
+ * @brief Write a signed integer to the passed writer.
+ *
+ * @see encode_sint_by_width
+ */
+static bool
+write_sint_by_width(flexi_writer_s *writer, int64_t v, int width)
+{
+    uint8_t buf[sizeof(int64_t)];
+    if (!encode_sint_by_width(buf, v, width)) {
+        return false;
+    }
+    return writer_write(writer, buf, width);
+}
+
+/**
+ * @brief Write an unsigned integer to the passed writer.
+ *
+ * @see encode_uint_by_width
+ */
+static bool
+write_uint_by_width(flexi_writer_s *writer, uint64_t v, int width)
+{
+    uint8_t buf[sizeof(uint64_t)];
+    if (!encode_uint_by_width(buf, v, width)) {
+        return false;
+    }
+    return writer_write(writer, buf, width);
+}
+
+/**
+ * @brief Write a 4-byte float to the passed writer.
+ *
+ * @see encode_f32
+ */
+static bool
+write_f32(flexi_writer_s *writer, float v, int width)
+{
+    uint8_t buf[sizeof(double)];
+    if (!encode_f32(buf, v, width)) {
+        return false;
+    }
+    return writer_write(writer, buf, width);
+}
+
+/**
+ * @brief Write an 8-byte float to the passed writer.
+ *
+ * @see encode_f64
+ */
+static bool
+write_f64(flexi_writer_s *writer, double v, int width)
+{
+    uint8_t buf[sizeof(double)];
+    if (!encode_f64(buf, v, width)) {
+        return false;
+    }
+    return writer_write(writer, buf, width);
+}
+
+/**
+ * @brief Size of the block that vectors and maps are encoded into before
+ *        they are written.
+ */
+#define STAGE_LEN (256)
+
+/**
+ * @brief Local block that encoded data is gathered in, so a vector is
+ *        handed to the stream in as few writes as possible.
+ */
+typedef struct writer_stage_s {
+    flexi_writer_s *writer;
+    flexi_ssize_t len;
+    bool keep;
+    uint8_t data[STAGE_LEN];
+} writer_stage_s;
+
+/**
+ * @brief Initialize an empty stage for the passed writer.
+ */
+static void
+stage_init(writer_stage_s *stage, flexi_writer_s *writer)
+{
+    stage->writer = writer;
+    stage->len = 0;
+    stage->keep = false;
+}
+
+/**
+ * @brief Write everything gathered in the stage to the writer.
+ *
+ * @param[in,out] stage Stage to flush.
+ * @return True if the stage was empty or written successfully.
+ */
+static bool
+stage_flush(writer_stage_s *stage)
+{
+    if (stage->len == 0) {
+        return true;
+    }
+
+    bool ok = stage->keep
+                  ? writer_write_kept(stage->writer, stage->data, stage->len)
+                  : writer_write(stage->writer, stage->data, stage->len);
+    if (!ok) {
+        return false;
+    }
+
+    stage->len = 0;
+    return true;
+}
+
+/**
+ * @brief Make room for width bytes in the stage, flushing it if needed.
+ *
+ * @param[in,out] stage Stage to operate on.
+ * @param[in] width Number of bytes needed, no more than 8.
+ * @return Pointer to the reserved space, or NULL if the flush failed.
+ */
+static uint8_t *
+stage_reserve(writer_stage_s *stage, int width)
+{
+    if (stage->len + width > STAGE_LEN && !stage_flush(stage)) {
+        return NULL;
+    }
+    return stage->data + stage->len;
+}
+
+/**
+ * @brief Encode a signed integer into the stage.
+ *
+ * @see encode_sint_by_width
+ */
+static bool
+stage_sint_by_width(writer_stage_s *stage, int64_t v, int width)
+{
+    uint8_t *dst = stage_reserve(stage, width);
+    if (dst == NULL || !encode_sint_by_width(dst, v, width)) {
+        return false;
+    }
+    stage->len += width;
+    return true;
+}
+
+/**
+ * @brief Encode an unsigned integer into the stage.
+ *
+ * @see encode_uint_by_width
+ */
+static bool
+stage_uint_by_width(writer_stage_s *stage, uint64_t v, int width)
+{
+    uint8_t *dst = stage_reserve(stage, width);
+    if (dst == NULL || !encode_uint_by_width(dst, v, width)) {
+        return false;
+    }
+    stage->len += width;
+    return true;
+}
+
+/**
+ * @brief Encode a 4-byte float into the stage.
+ *
+ * @see encode_f32
+ */
+static bool
+stage_f32(writer_stage_s *stage, float v, int width)
+{
+    uint8_t *dst = stage_reserve(stage, width);
+    if (dst == NULL || !encode_f32(dst, v, width)) {
+        return false;
+    }
+    stage->len += width;
+    return true;
+}
+
+/**
+ * @brief Encode an 8-byte float into the stage.
+ *
+ * @see encode_f64
+ */
+static bool
+stage_f64(writer_stage_s *stage, double v, int width)
+{
+    uint8_t *dst = stage_reserve(stage, width);
+    if (dst == NULL || !encode_f64(dst, v, width)) {
+        return false;
+    }
+    stage->len += width;
+    return true;
+}
+
 /**
  * @brief Check if a cursor is in an error state.
  */
@@ -897,6 +1547,31 @@ cursor_set_error(flexi_cursor_s *cursor)
     cursor->cursor = NULL;
     cursor->type = FLEXI_TYPE_INVALID;
     cursor->width = 0;
+    cursor->trusted = false;
+    cursor->keys = NULL;
+    cursor->keys_width = 0;
+}
+
+/**
+ * @brief Seek backwards from a position inside the message the cursor is
+ *        pointing into.  Cursors into a validated message skip the checks.
+ *
+ * @param [in] cursor Cursor whose message constrains offset resolution.
+ * @param [in] src Starting point for offset.
+ * @param [in] offset Extent of offset in the negative direction.
+ * @param [out] dest Output destination value.
+ * @return True if offset was resolved.
+ */
+static bool
+cursor_seek_back(const flexi_cursor_s *cursor, const char *src,
+    flexi_ssize_t offset, const char **dest)
+{
+    if (cursor->trusted) {
+        *dest = src - offset;
+        return true;
+    }
+
+    return span_seek_back(&cursor->msg, src, offset, dest);
 }
 
 /**
@@ -915,6 +1590,62 @@ cursor_vector_types(const flexi_cursor_s *cursor)
                                     (cursor->length * cursor->width));
 }
 
+/**
+ * @brief Given the base of a map, locate the vector of keys of the map
+ *        and check that it has room for one key per value.
+ *
+ * @pre Map must have room for the header before its base.
+ *
+ * @param[in] msg Span pointing to message data.
+ * @param[in] pos Base of the map.
+ * @param[in] width Width of the map in bytes.
+ * @param[in] length Length of the map.
+ * @param[out] keys Base of the key vector.
+ * @param[out] keys_width Width of the key vector in bytes.
+ * @return True if the key vector was located.
+ */
+static bool
+span_map_keys(const flexi_span_s *msg, const char *pos, int width,
+    flexi_ssize_t length, const char **keys, int *keys_width)
+{
+    // [-3] contains key vector offset.
+    const char *offset_ptr = pos - (width * 3);
+    flexi_ssize_t keys_offset;
+    if (!read_size_unsafe(offset_ptr, width, &keys_offset)) {
+        return false;
+    }
+
+    // [-2] contains key vector width.
+    uint64_t keys_bytes = read_uint_unsafe(offset_ptr + width, width);
+    if (!WIDTH_IS_VALID(keys_bytes)) {
+        return false;
+    }
+
+    const char *base;
+    if (!span_seek_back(msg, offset_ptr, keys_offset, &base)) {
+        // Tried to seek keys base, went out of bounds.
+        return false;
+    }
+
+    flexi_ssize_t keys_length;
+    if (base - keys_bytes < span_begin(msg) ||
+        !read_size_unsafe(base - keys_bytes, (int)keys_bytes,
+            &keys_length) ||
+        keys_length != length) {
+        // Key vector must have the same length as the map.
+        return false;
+    }
+
+    if (base + (keys_length * (flexi_ssize_t)keys_bytes) >= span_end(msg)) {
+        // Not enough room for the entire key vector.
+        return false;
+    }
+
+    *keys = base;
+    *keys_width = (int)keys_bytes;
+    return true;
+}
+
 /**
  * @brief Set values on a cursor with no bounds-checking.
  *
@@ -923,24 +1654,84 @@ cursor_vector_types(const flexi_cursor_s *cursor)
  *          used to catch bugs in debug mode.
  *
  * @param[out] cursor Cursor to assign to.
- * @param[in] msg Span pointing to message data.
+ * @param[in] parent Cursor that the new cursor was found through.
  * @param[in] pos Anchor of the cursor.
  * @param[in] type Type of the cursor.
  * @param[in] width Width of the cursor in bytes.
  */
 static void
-cursor_set_direct(flexi_cursor_s *cursor, const flexi_span_s *msg,
+cursor_set_direct(flexi_cursor_s *cursor, const flexi_cursor_s *parent,
     const char *pos, flexi_type_e type, int width)
 {
     ASSERT(type_is_direct(type));
     ASSERT((type != FLEXI_TYPE_FLOAT && WIDTH_IS_VALID(width)) ||
            (type == FLEXI_TYPE_FLOAT && WIDTH_IS_VALID_FLOAT(width)));
 
-    cursor->msg = *msg;
+    cursor->msg = parent->msg;
+    cursor->trusted = parent->trusted;
     cursor->cursor = pos;
     cursor->type = type;
     cursor->width = width;
     cursor->length = 0;
+    cursor->keys = NULL;
+    cursor->keys_width = 0;
+}
+
+/**
+ * @brief Set values on a cursor pointing into a validated message, where
+ *        the only thing left to do is read the length.
+ *
+ * @param[out] cursor Cursor to assign to.
+ * @param[in] msg Span pointing to message data.
+ * @param[in] pos Anchor of the cursor.
+ * @param[in] type Type of the cursor.
+ * @param[in] width Width of the cursor in bytes.
+ */
+static void
+cursor_set_trusted(flexi_cursor_s *cursor, const flexi_span_s *msg,
+    const char *pos, flexi_type_e type, int width)
+{
+    cursor->keys = NULL;
+    cursor->keys_width = 0;
+
+    switch (type) {
+    case FLEXI_TYPE_MAP: {
+        cursor->length = (flexi_ssize_t)read_uint_unsafe(pos - width, width);
+
+        // [-3] contains key vector offset, [-2] contains key vector width.
+        const char *offset_ptr = pos - (width * 3);
+        uint64_t keys_offset = read_uint_unsafe(offset_ptr, width);
+        cursor->keys = offset_ptr - keys_offset;
+        cursor->keys_width = (int)read_uint_unsafe(offset_ptr + width, width);
+        break;
+    }
+    case FLEXI_TYPE_STRING:
+    case FLEXI_TYPE_VECTOR:
+    case FLEXI_TYPE_VECTOR_SINT:
+    case FLEXI_TYPE_VECTOR_UINT:
+    case FLEXI_TYPE_VECTOR_FLOAT:
+    case FLEXI_TYPE_VECTOR_KEY:
+    case FLEXI_TYPE_VECTOR_BOOL:
+    case FLEXI_TYPE_BLOB:
+        cursor->length = (flexi_ssize_t)read_uint_unsafe(pos - width, width);
+        break;
+    case FLEXI_TYPE_VECTOR_SINT2:
+    case FLEXI_TYPE_VECTOR_UINT2:
+    case FLEXI_TYPE_VECTOR_FLOAT2: cursor->length = 2; break;
+    case FLEXI_TYPE_VECTOR_SINT3:
+    case FLEXI_TYPE_VECTOR_UINT3:
+    case FLEXI_TYPE_VECTOR_FLOAT3: cursor->length = 3; break;
+    case FLEXI_TYPE_VECTOR_SINT4:
+    case FLEXI_TYPE_VECTOR_UINT4:
+    case FLEXI_TYPE_VECTOR_FLOAT4: cursor->length = 4; break;
+    default: cursor->length = 0; break;
+    }
+
+    cursor->msg = *msg;
+    cursor->trusted = true;
+    cursor->cursor = pos;
+    cursor->type = type;
+    cursor->width = width;
 }
 
 /**
@@ -953,16 +1744,27 @@ cursor_set_direct(flexi_cursor_s *cursor, const flexi_span_s *msg,
  *          about to create a cursor for is valid.
  *
  * @param[out] cursor Cursor to assign to.
- * @param[in] msg Span pointing to message data.
+ * @param[in] parent Cursor that the new cursor was found through.  May be
+ *                   the same as the cursor being assigned to.
  * @param[in] pos Anchor of the cursor.
  * @param[in] type Type of the cursor.
  * @param[in] width Width of the cursor in bytes.
  * @return True if resulting cursor is valid.
  */
 static bool
-cursor_set_checked(flexi_cursor_s *cursor, const flexi_span_s *msg,
+cursor_set_checked(flexi_cursor_s *cursor, const flexi_cursor_s *parent,
     const char *pos, flexi_type_e type, int width)
 {
+    const flexi_span_s *msg = &parent->msg;
+    if (parent->trusted) {
+        // Message was already validated, skip the checks.
+        cursor_set_trusted(cursor, msg, pos, type, width);
+        return true;
+    }
+
+    const char *keys = NULL;
+    int keys_width = 0;
+
     switch (type) {
     case FLEXI_TYPE_NULL:
     case FLEXI_TYPE_SINT:
@@ -1029,6 +1831,11 @@ cursor_set_checked(flexi_cursor_s *cursor, const flexi_span_s *msg,
             // Not enough room for the entire map with the given length.
             return false;
         }
+        if (!span_map_keys(msg, pos, width, cursor->length, &keys,
+                &keys_width)) {
+            // Keys must exist and match the values one to one.
+            return false;
+        }
         break;
     case FLEXI_TYPE_VECTOR:
         if (!WIDTH_IS_VALID(width)) {
@@ -1151,9 +1958,12 @@ cursor_set_checked(flexi_cursor_s *cursor, const flexi_span_s *msg,
     }
 
     cursor->msg = *msg;
+    cursor->trusted = false;
     cursor->cursor = pos;
     cursor->type = type;
     cursor->width = width;
+    cursor->keys = keys;
+    cursor->keys_width = keys_width;
     return true;
 }
 
@@ -1181,7 +1991,7 @@ cursor_seek_untyped_vector_index(const flexi_cursor_s *cursor,
     flexi_type_e type = FLEXI_UNPACK_TYPE(types[index]);
     if (type_is_direct(type)) {
         // No need to resolve an offset, we're pretty much done.
-        cursor_set_direct(dest, &cursor->msg,
+        cursor_set_direct(dest, cursor,
             cursor->cursor + (index * cursor->width), type, cursor->width);
         return true;
     }
@@ -1192,11 +2002,11 @@ cursor_seek_untyped_vector_index(const flexi_cursor_s *cursor,
         return false;
     }
 
-    if (!span_seek_back(&cursor->msg, offset_ptr, offset, &dest->cursor)) {
+    if (!cursor_seek_back(cursor, offset_ptr, offset, &dest->cursor)) {
         return false;
     }
 
-    return cursor_set_checked(dest, &cursor->msg, dest->cursor, type,
+    return cursor_set_checked(dest, cursor, dest->cursor, type,
         UNPACK_WIDTH_TO_BYTES(types[index]));
 }
 
@@ -1220,7 +2030,7 @@ cursor_seek_typed_vector_index(const flexi_cursor_s *cursor,
     case FLEXI_TYPE_VECTOR_SINT2:
     case FLEXI_TYPE_VECTOR_SINT3:
     case FLEXI_TYPE_VECTOR_SINT4:
-        cursor_set_direct(dest, &cursor->msg,
+        cursor_set_direct(dest, cursor,
             cursor->cursor + (index * cursor->width), FLEXI_TYPE_SINT,
             cursor->width);
         return true;
@@ -1228,7 +2038,7 @@ cursor_seek_typed_vector_index(const flexi_cursor_s *cursor,
     case FLEXI_TYPE_VECTOR_UINT2:
     case FLEXI_TYPE_VECTOR_UINT3:
     case FLEXI_TYPE_VECTOR_UINT4:
-        cursor_set_direct(dest, &cursor->msg,
+        cursor_set_direct(dest, cursor,
             cursor->cursor + (index * cursor->width), FLEXI_TYPE_UINT,
             cursor->width);
         return true;
@@ -1236,12 +2046,12 @@ cursor_seek_typed_vector_index(const flexi_cursor_s *cursor,
     case FLEXI_TYPE_VECTOR_FLOAT2:
     case FLEXI_TYPE_VECTOR_FLOAT3:
     case FLEXI_TYPE_VECTOR_FLOAT4:
-        cursor_set_direct(dest, &cursor->msg,
+        cursor_set_direct(dest, cursor,
             cursor->cursor + (index * cursor->width), FLEXI_TYPE_FLOAT,
             cursor->width);
         return true;
     case FLEXI_TYPE_VECTOR_BOOL:
-        cursor_set_direct(dest, &cursor->msg, cursor->cursor + index,
+        cursor_set_direct(dest, cursor, cursor->cursor + index,
             FLEXI_TYPE_BOOL, 1);
         return true;
     case FLEXI_TYPE_VECTOR_KEY: {
@@ -1251,11 +2061,11 @@ cursor_seek_typed_vector_index(const flexi_cursor_s *cursor,
             return false;
         }
 
-        if (!span_seek_back(&cursor->msg, cur, offset, &cur)) {
+        if (!cursor_seek_back(cursor, cur, offset, &cur)) {
             return false;
         }
 
-        return cursor_set_checked(dest, &cursor->msg, cur, FLEXI_TYPE_KEY, 1);
+        return cursor_set_checked(dest, cursor, cur, FLEXI_TYPE_KEY, 1);
     }
     default: ASSERT(false); return false;
     }
@@ -1265,43 +2075,26 @@ cursor_seek_typed_vector_index(const flexi_cursor_s *cursor,
  * @brief Given a cursor pointing at the base of a map, return a cursor
  *        pointing at the keys vector of the map.
  *
+ * @details The key vector was located when the map cursor was created, so
+ *          this is just a copy.
+ *
  * @param[in] cursor Cursor to examine.
  * @param[out] dest Cursor which will be pointing at vector of keys.
- * @return True if seek was successful.
  */
-static bool
+static void
 cursor_map_keys(const flexi_cursor_s *cursor, flexi_cursor_s *dest)
 {
     // Calling this with a non-map is a contract violation.
     ASSERT(cursor->type == FLEXI_TYPE_MAP);
 
-    const char *cur;
-    if (!span_seek_back(&cursor->msg, cursor->cursor, cursor->width * 3,
-            &cur)) {
-        // Not enough room for the header.
-        return false;
-    }
-
-    // [-3] contains key vector offset.
-    flexi_ssize_t keys_offset;
-    if (!read_size_unsafe(cur, cursor->width, &keys_offset)) {
-        return false;
-    }
-
-    // [-2] contains key vector width.
-    uint64_t keys_width = read_uint_unsafe(cur + cursor->width, cursor->width);
-    if (keys_width != 1 && keys_width != 2 && keys_width != 4 &&
-        keys_width != 8) {
-        return false;
-    }
-
-    if (!span_seek_back(&cursor->msg, cur, keys_offset, &cur)) {
-        // Tried to seek keys base, went out of bounds.
-        return false;
-    }
-
-    return cursor_set_checked(dest, &cursor->msg, cur, FLEXI_TYPE_VECTOR_KEY,
-        (int)keys_width);
+    dest->msg = cursor->msg;
+    dest->trusted = cursor->trusted;
+    dest->cursor = cursor->keys;
+    dest->type = FLEXI_TYPE_VECTOR_KEY;
+    dest->width = cursor->keys_width;
+    dest->length = cursor->length;
+    dest->keys = NULL;
+    dest->keys_width = 0;
 }
 
 /**
@@ -1330,43 +2123,53 @@ cursor_map_key_at_index(const flexi_cursor_s *cursor,
         return false;
     }
 
-    return span_seek_back(&cursor->msg, offset_ptr, offset, str);
+    return cursor_seek_back(cursor, offset_ptr, offset, str);
+}
+
+/**
+ * @brief Compare a null-terminated map key to a key of known length, in
+ *        strcmp order.
+ *
+ * @param[in] map_key Null-terminated key found in the map.
+ * @param[in] key Key to compare against, which need not be null-terminated.
+ * @param[in] key_len Length of key to compare against.
+ * @return Result of comparison, like strcmp.
+ */
+static int
+key_cmp(const char *map_key, const char *key, flexi_ssize_t key_len)
+{
+    int res = strncmp(map_key, key, (size_t)key_len);
+    if (res != 0) {
+        return res;
+    }
+    return map_key[key_len] == '\0' ? 0 : 1;
 }
 
 /**
- * @brief Seek a map key via linear search.
+ * @brief Find the index of a map key via linear search.
  *
  * @param[in] cursor Cursor of map to use as base.
- * @param[in] len Length of map at cursor.
+ * @param[in] keys Cursor to previously sought-out keys.
  * @param[in] key Key to check for.
- * @param[out] dest Destination cursor.
+ * @param[in] key_len Length of key to check for.
+ * @param[out] index Index of found key.
  * @return FLEXI_OK || FLEXI_ERR_NOTFOUND || FLEXI_ERR_BADREAD.
  */
 static flexi_result_e
-cursor_seek_map_key_linear(const flexi_cursor_s *cursor, flexi_ssize_t len,
-    const char *key, flexi_cursor_s *dest)
+cursor_find_map_key_linear(const flexi_cursor_s *cursor,
+    const flexi_cursor_s *keys, const char *key, flexi_ssize_t key_len,
+    flexi_ssize_t *index)
 {
-    if (cursor->type != FLEXI_TYPE_MAP) {
-        return FLEXI_ERR_INTERNAL;
-    }
-
-    flexi_cursor_s keys;
-    if (!cursor_map_keys(cursor, &keys)) {
-        // Could not locate keys.
-        return FLEXI_ERR_BADREAD;
-    }
-
     // Linear search.
-    for (flexi_ssize_t i = 0; i < len; i++) {
+    for (flexi_ssize_t i = 0; i < cursor->length; i++) {
         const char *cmp = NULL;
-        if (!cursor_map_key_at_index(cursor, &keys, i, &cmp)) {
+        if (!cursor_map_key_at_index(cursor, keys, i, &cmp)) {
             return FLEXI_ERR_BADREAD;
         }
 
-        if (!strcmp(cmp, key)) {
-            return cursor_seek_untyped_vector_index(cursor, i, dest)
-                       ? FLEXI_OK
-                       : FLEXI_ERR_BADREAD;
+        if (!key_cmp(cmp, key, key_len)) {
+            *index = i;
+            return FLEXI_OK;
         }
     }
 
@@ -1374,42 +2177,33 @@ cursor_seek_map_key_linear(const flexi_cursor_s *cursor, flexi_ssize_t len,
 }
 
 /**
- * @brief Seek a map key via binary search.
+ * @brief Find the index of a map key via binary search.
  *
  * @param[in] cursor Cursor of map to use as base.
- * @param[in] len Length of map at cursor.
+ * @param[in] keys Cursor to previously sought-out keys.
  * @param[in] key Key to check for.
- * @param[out] dest Destination cursor.
+ * @param[in] key_len Length of key to check for.
+ * @param[out] index Index of found key.
  * @return FLEXI_OK || FLEXI_ERR_NOTFOUND || FLEXI_ERR_BADREAD.
  */
 static flexi_result_e
-cursor_seek_map_key_bsearch(const flexi_cursor_s *cursor, flexi_ssize_t len,
-    const char *key, flexi_cursor_s *dest)
+cursor_find_map_key_bsearch(const flexi_cursor_s *cursor,
+    const flexi_cursor_s *keys, const char *key, flexi_ssize_t key_len,
+    flexi_ssize_t *index)
 {
-    if (cursor->type != FLEXI_TYPE_MAP) {
-        return FLEXI_ERR_INTERNAL;
-    }
-
-    flexi_cursor_s keys;
-    if (!cursor_map_keys(cursor, &keys)) {
-        // Could not locate keys.
-        return FLEXI_ERR_BADREAD;
-    }
-
     flexi_ssize_t left = 0;
-    flexi_ssize_t right = len - 1;
+    flexi_ssize_t right = cursor->length - 1;
     while (left <= right) {
         flexi_ssize_t i = left + ((right - left) / 2);
         const char *cmp = NULL;
-        if (!cursor_map_key_at_index(cursor, &keys, i, &cmp)) {
+        if (!cursor_map_key_at_index(cursor, keys, i, &cmp)) {
             return FLEXI_ERR_BADREAD;
         }
 
-        int res = strcmp(cmp, key);
+        int res = key_cmp(cmp, key, key_len);
         if (res == 0) {
-            return cursor_seek_untyped_vector_index(cursor, i, dest)
-                       ? FLEXI_OK
-                       : FLEXI_ERR_BADREAD;
+            *index = i;
+            return FLEXI_OK;
         }
 
         if (res < 0) {
@@ -1422,1333 +2216,3451 @@ cursor_seek_map_key_bsearch(const flexi_cursor_s *cursor, flexi_ssize_t len,
     return FLEXI_ERR_NOTFOUND;
 }
 
-/******************************************************************************/
-
+/**
+ * @brief Find the index of a map key, picking the search strategy by the
+ *        length of the map.
+ *
+ * @param[in] cursor Cursor of map to use as base.
+ * @param[in] keys Cursor to previously sought-out keys.
+ * @param[in] key Key to check for.
+ * @param[in] key_len Length of key to check for.
+ * @param[out] index Index of found key.
+ * @return FLEXI_OK || FLEXI_ERR_NOTFOUND || FLEXI_ERR_BADREAD.
+ */
 static flexi_result_e
-cursor_foreach_map(const flexi_cursor_s *cursor, flexi_foreach_fn foreach,
-    void *user)
+cursor_find_map_key(const flexi_cursor_s *cursor, const flexi_cursor_s *keys,
+    const char *key, flexi_ssize_t key_len, flexi_ssize_t *index)
 {
-    flexi_cursor_s each, keys;
-    if (!cursor_map_keys(cursor, &keys)) {
-        // Could not locate keys.
-        return FLEXI_ERR_BADREAD;
+    if (cursor->length <= FLEXI_CONFIG_SEEK_MAP_KEY_LINEAR_MAX) {
+        return cursor_find_map_key_linear(cursor, keys, key, key_len, index);
+    } else {
+        return cursor_find_map_key_bsearch(cursor, keys, key, key_len, index);
     }
+}
 
-    const flexi_packed_t *types = cursor_vector_types(cursor);
-    for (flexi_ssize_t i = 0; i < cursor->length; i++) {
-        const char *key;
-        if (!cursor_map_key_at_index(cursor, &keys, i, &key)) {
-            // Couldn't find the map key.
-            return FLEXI_ERR_BADREAD;
-        }
-
-        flexi_type_e type = FLEXI_UNPACK_TYPE(types[i]);
-        if (type_is_direct(type)) {
-            cursor_set_direct(&each, &cursor->msg,
-                cursor->cursor + (i * cursor->width), type, cursor->width);
-        } else {
-            flexi_ssize_t offset = 0;
-            const char *offset_ptr = cursor->cursor + (i * cursor->width);
-            if (!read_size_unsafe(offset_ptr, cursor->width, &offset)) {
-                return FLEXI_ERR_BADREAD;
-            }
-
-            if (!span_seek_back(&cursor->msg, offset_ptr, offset,
-                    &each.cursor)) {
-                return FLEXI_ERR_BADREAD;
-            }
+/**
+ * @brief Seek a map key of known length.
+ *
+ * @param[in] cursor Cursor of map to use as base.
+ * @param[in] key Key to check for.
+ * @param[in] key_len Length of key to check for.
+ * @param[out] dest Destination cursor.
+ * @return FLEXI_OK || FLEXI_ERR_NOTFOUND || FLEXI_ERR_BADREAD.
+ */
+static flexi_result_e
+cursor_seek_map_key(const flexi_cursor_s *cursor, const char *key,
+    flexi_ssize_t key_len, flexi_cursor_s *dest)
+{
+    if (cursor->type != FLEXI_TYPE_MAP) {
+        return FLEXI_ERR_INTERNAL;
+    }
 
-            if (!cursor_set_checked(&each, &cursor->msg, each.cursor, type,
-                    UNPACK_WIDTH_TO_BYTES(types[i]))) {
-                return FLEXI_ERR_BADREAD;
-            }
-        }
+    flexi_cursor_s keys;
+    cursor_map_keys(cursor, &keys);
 
-        if (!foreach (key, &each, user)) {
-            return FLEXI_OK;
-        }
+    flexi_ssize_t index = 0;
+    flexi_result_e res = cursor_find_map_key(cursor, &keys, key, key_len,
+        &index);
+    if (res != FLEXI_OK) {
+        return res;
     }
 
-    return FLEXI_OK;
+    return cursor_seek_untyped_vector_index(cursor, index, dest)
+               ? FLEXI_OK
+               : FLEXI_ERR_BADREAD;
 }
 
 /******************************************************************************/
 
-static flexi_result_e
-cursor_foreach_untyped_vector(const flexi_cursor_s *cursor,
-    flexi_foreach_fn foreach, void *user)
+/**
+ * @brief Parse a non-negative decimal index out of a path segment.
+ *
+ * @param[in] begin Start of digits.
+ * @param[in] end One past the end of digits.
+ * @param[out] index Parsed index.
+ * @return True if the range was entirely digits and did not overflow.
+ */
+static bool
+parse_path_index(const char *begin, const char *end, flexi_ssize_t *index)
 {
-    flexi_cursor_s each;
-
-    const flexi_packed_t *types = cursor_vector_types(cursor);
-    for (flexi_ssize_t i = 0; i < cursor->length; i++) {
-        flexi_type_e type = FLEXI_UNPACK_TYPE(types[i]);
-        if (type_is_direct(type)) {
-            cursor_set_direct(&each, &cursor->msg,
-                cursor->cursor + (i * cursor->width), type, cursor->width);
-        } else {
-            flexi_ssize_t offset = 0;
-            const char *offset_ptr = cursor->cursor + (i * cursor->width);
-            if (!read_size_unsafe(offset_ptr, cursor->width, &offset)) {
-                return FLEXI_ERR_BADREAD;
-            }
-
-            if (!span_seek_back(&cursor->msg, offset_ptr, offset,
-                    &each.cursor)) {
-                return FLEXI_ERR_BADREAD;
-            }
-
-            if (!cursor_set_checked(&each, &cursor->msg, each.cursor, type,
-                    UNPACK_WIDTH_TO_BYTES(types[i]))) {
-                return FLEXI_ERR_BADREAD;
-            }
-        }
+    if (begin == end) {
+        return false;
+    }
 
-        if (!foreach (NULL, &each, user)) {
-            return FLEXI_OK;
+    *index = 0;
+    for (const char *ch = begin; ch < end; ch++) {
+        if (*ch < '0' || *ch > '9' ||
+            *index > (FLEXI_SSIZE_MAX - (*ch - '0')) / 10) {
+            return false;
         }
+        *index = (*index * 10) + (*ch - '0');
     }
 
-    return FLEXI_OK;
+    return true;
 }
 
 /**
- * @brief Peek at the n-th value from the current tail of the stack.  0 is
- *        the tail of the stack and returns a value if the stack contains
- *        any values.
+ * @brief Parse an inclusive index range of the form "N..M" out of a path
+ *        segment.
  *
- * @param[in] writer Offset to use.
- * @param[in] offset Offset from the tail.
- * @return Value at stack position, or NULL if offset out of range.
+ * @param[in] begin Start of segment.
+ * @param[in] end One past the end of segment.
+ * @param[out] first First index of range.
+ * @param[out] last Last index of range.
+ * @return True if the segment was a valid range.
  */
-static flexi_value_s *
-writer_peek_tail(flexi_writer_s *writer, flexi_ssize_t offset)
+static bool
+parse_path_range(const char *begin, const char *end, flexi_ssize_t *first,
+    flexi_ssize_t *last)
 {
-    return stack_at(&writer->stack, offset);
+    for (const char *dots = begin; dots + 1 < end; dots++) {
+        if (dots[0] == '.' && dots[1] == '.') {
+            return parse_path_index(begin, dots, first) &&
+                   parse_path_index(dots + 2, end, last);
+        }
+    }
+
+    return false;
 }
 
 /**
- * @brief Peek at the value in the stack, starting with the n-th value in
- * the stack (0 is head, towards tail) and then offseting by the given index
- * (0 is start value, towards head).
+ * @brief Start iterating over a map or untyped vector.
  *
- * @param[in] writer Writer to use.
- * @param[in] start Stack offset to start from (towards tail).
- * @param[in] index Positive offset from the starting stack offset (towards
- *                  head).
- * @return Value at stack position, or NULL if offset is invalid
+ * @param[in] cursor Cursor pointing at map or untyped vector.
+ * @param[out] iter Iterator to initialize.
  */
-static flexi_value_s *
-writer_peek_idx(flexi_writer_s *writer, flexi_ssize_t start,
-    flexi_ssize_t index)
+static void
+cursor_iter_begin(const flexi_cursor_s *cursor, flexi_iter_s *iter)
 {
-    flexi_ssize_t offset = stack_count(&writer->stack);
-
-    offset -= start;
-    offset += index;
+    ASSERT(type_is_map_or_untyped_vector(cursor->type));
 
-    return stack_at(&writer->stack, offset);
+    iter->cursor = *cursor;
+    iter->index = 0;
+    if (cursor->type == FLEXI_TYPE_MAP) {
+        cursor_map_keys(cursor, &iter->keys);
+    } else {
+        cursor_set_error(&iter->keys);
+    }
 }
 
 /**
- * @brief Pop a value off the stack.
+ * @brief Read the key of the value an iterator is about to return.
  *
- * @param[in] writer Writer to operate on.
- * @param[in] count Number of values to pop.
- * @return True if pop was successful, or false if stack was underflowed.
+ * @pre Iterator must not be exhausted.
+ *
+ * @param[in] iter Iterator to examine.
+ * @param[out] key Key of next value, or NULL if not iterating a map.
+ * @return True if the key was read.
  */
 static bool
-writer_pop(flexi_writer_s *writer, flexi_ssize_t count)
+iter_key(const flexi_iter_s *iter, const char **key)
 {
-    flexi_ssize_t scount = stack_count(&writer->stack);
-    if (scount < count) {
-        return false;
-    }
+    const flexi_cursor_s *cursor = &iter->cursor;
+    ASSERT(iter->index < cursor->length);
 
-    // Free all to-be-popped stack keys.
-    if (writer->opt_free != NULL) {
-        flexi_ssize_t top = scount - 1;
-        flexi_ssize_t bottom = top - count;
-        for (flexi_ssize_t i = top; i > bottom; i--) {
-            flexi_value_s *value = stack_at(&writer->stack, i);
-            if (value->key) {
-                writer->opt_free((void *)value->key);
-            }
-            value->key = NULL;
-        }
+    *key = NULL;
+    if (cursor->type != FLEXI_TYPE_MAP) {
+        return true;
     }
 
-    flexi_ssize_t actual = stack_pop(&writer->stack, count);
-    return count == actual;
+    return cursor_map_key_at_index(cursor, &iter->keys, iter->index, key);
 }
 
 /**
- * @brief Obtain the key for a map while sorting.
+ * @brief Advance an iterator to the next value.
  *
- * @param[in] writer Writer to operate on.
- * @param[in] start Starting index in the stack for the map.
- * @param[in] index Array-based index for the map.
- * @return Pointer to key off the stack.
+ * @param[in,out] iter Iterator to advance.
+ * @param[out] key Key of next value, or NULL if not iterating a map.
+ * @param[out] value Next value.
+ * @return FLEXI_OK || FLEXI_ERR_NOTFOUND if there are no more values ||
+ *         FLEXI_ERR_BADREAD.
  */
-static flexi_value_s *
-writer_get_stack_key(flexi_writer_s *writer, flexi_ssize_t start,
-    flexi_ssize_t index)
+static flexi_result_e
+iter_next(flexi_iter_s *iter, const char **key, flexi_cursor_s *value)
 {
-    flexi_ssize_t v_index = start + index;
-    flexi_value_s *v = stack_at(&writer->stack, v_index);
-    if (v->type != FLEXI_TYPE_KEY) {
-        return NULL;
+    const flexi_cursor_s *cursor = &iter->cursor;
+    if (iter->index >= cursor->length) {
+        return FLEXI_ERR_NOTFOUND;
+    }
+
+    if (!iter_key(iter, key)) {
+        // Couldn't find the map key.
+        return FLEXI_ERR_BADREAD;
     }
-    return v;
+
+    if (!cursor_seek_untyped_vector_index(cursor, iter->index, value)) {
+        return FLEXI_ERR_BADREAD;
+    }
+
+    iter->index += 1;
+    return FLEXI_OK;
 }
 
+/******************************************************************************/
+
 /**
- * @brief Obtain the value for a map while sorting.
- *
- * @param[in] writer Writer to operate on.
- * @param[in] start Starting index in the stack for the map.
- * @param[in] index Array-based index for the map.
- * @return Pointer to key off the stack.
+ * @brief Check that a key starting at the given position is terminated
+ *        inside the message.
  */
-static flexi_value_s *
-writer_get_stack_value(flexi_writer_s *writer, flexi_stack_idx_t start,
-    flexi_ssize_t index)
+static bool
+span_key_is_valid(const flexi_span_s *span, const char *key)
 {
-    flexi_ssize_t v_index = start + index;
-    return stack_at(&writer->stack, v_index);
+    return memchr(key, '\0', (size_t)(span_end(span) - key)) != NULL;
 }
 
 /**
- * @brief Sort the values of a map so all values keys are in strcmp order.
+ * @brief Check the keys of a map, which must be terminated and sorted.
  *
- * @param writer[in] Writer to operate on.
- * @param len[in] Number of values to use for map.
- * @return True if sort was successful.
+ * @param[in] cursor Cursor pointing at map.
+ * @return FLEXI_OK || FLEXI_ERR_BADREAD.
  */
-static bool
-writer_sort_map_values(flexi_writer_s *writer, flexi_ssize_t len)
+static flexi_result_e
+cursor_validate_map_keys(const flexi_cursor_s *cursor)
 {
-    flexi_ssize_t start = stack_count(&writer->stack) - len;
-    if (start < 0) {
-        return false;
-    }
-
-    // Shell sort gap sequence.
-    static const flexi_ssize_t gaps[] = {701, 301, 132, 57, 23, 10, 4, 1};
-
-    // The actual shell sort.
-    for (size_t g = 0; g < 8; g++) {
-        flexi_ssize_t gap = gaps[g];
-        for (flexi_ssize_t i = gap; i < len; i++) {
-            flexi_value_s cur = *writer_get_stack_value(writer, start, i);
-            const char *curkey = cur.key;
-
-            flexi_ssize_t j = i;
-            for (; j >= gap; j -= gap) {
-                flexi_value_s seek =
-                    *writer_get_stack_value(writer, start, j - gap);
-                const char *seekkey = seek.key;
-
-                int cmp = strcmp(seekkey, curkey);
-                if (cmp <= 0) {
-                    break;
-                }
+    flexi_cursor_s keys;
+    cursor_map_keys(cursor, &keys);
 
-                flexi_value_s *dest = writer_get_stack_value(writer, start, j);
-                memcpy(dest, &seek, sizeof(flexi_value_s));
-            }
+    const char *prev = NULL;
+    for (flexi_ssize_t i = 0; i < cursor->length; i++) {
+        const char *key = NULL;
+        if (!cursor_map_key_at_index(cursor, &keys, i, &key) ||
+            !span_key_is_valid(&cursor->msg, key)) {
+            return FLEXI_ERR_BADREAD;
+        }
 
-            flexi_value_s *dest = writer_get_stack_value(writer, start, j);
-            memcpy(dest, &cur, sizeof(flexi_value_s));
+        if (prev != NULL && strcmp(prev, key) > 0) {
+            // Keys out of order would break binary search.
+            return FLEXI_ERR_BADREAD;
         }
+        prev = key;
     }
 
-    return true;
+    return FLEXI_OK;
 }
 
 /**
- * @brief Calculate the minimum alignment needed to store values in vector.
+ * @brief Check the value at the cursor, and every value reachable from it.
  *
- * @param[in] writer Writer to operate on.
- * @param[in] len Number of values to examine.
- * @param[out] min Actual minimum alignment needed in bytes.
- * @return FLEXI_OK || FLEXI_ERR_BADWRITE.
+ * @param[in] cursor Cursor pointing at value to validate.
+ * @param[in,out] limits Depth and iterable limits.
+ * @return FLEXI_OK || FLEXI_ERR_BADREAD || FLEXI_ERR_PARSELIMIT.
  */
 static flexi_result_e
-writer_vector_calc_min_stride(flexi_writer_s *writer, flexi_ssize_t len,
-    int *min)
+cursor_validate(const flexi_cursor_s *cursor, parse_limits_s *limits)
 {
-    int min_width = 1;
-    for (flexi_ssize_t i = 0; i < len; i++) {
-        const flexi_value_s *value = writer_peek_idx(writer, len, i);
-        if (value == NULL) {
-            return FLEXI_ERR_INTERNAL;
+    switch (cursor->type) {
+    case FLEXI_TYPE_KEY:
+        return span_key_is_valid(&cursor->msg, cursor->cursor)
+                   ? FLEXI_OK
+                   : FLEXI_ERR_BADREAD;
+    case FLEXI_TYPE_STRING:
+        return cursor->cursor[cursor->length] == '\0' ? FLEXI_OK
+                                                      : FLEXI_ERR_BADREAD;
+    case FLEXI_TYPE_VECTOR_SINT2:
+    case FLEXI_TYPE_VECTOR_UINT2:
+    case FLEXI_TYPE_VECTOR_FLOAT2:
+    case FLEXI_TYPE_VECTOR_SINT3:
+    case FLEXI_TYPE_VECTOR_UINT3:
+    case FLEXI_TYPE_VECTOR_FLOAT3:
+    case FLEXI_TYPE_VECTOR_SINT4:
+    case FLEXI_TYPE_VECTOR_UINT4:
+    case FLEXI_TYPE_VECTOR_FLOAT4:
+        // Fixed length vectors have no length to check against.
+        return span_read_is_valid(&cursor->msg, cursor->cursor,
+                   (int)(cursor->length * cursor->width))
+                   ? FLEXI_OK
+                   : FLEXI_ERR_BADREAD;
+    case FLEXI_TYPE_VECTOR_KEY:
+        for (flexi_ssize_t i = 0; i < cursor->length; i++) {
+            flexi_cursor_s key;
+            if (!cursor_seek_typed_vector_index(cursor, i, &key) ||
+                !span_key_is_valid(&cursor->msg, key.cursor)) {
+                return FLEXI_ERR_BADREAD;
+            }
+        }
+        return FLEXI_OK;
+    case FLEXI_TYPE_MAP:
+    case FLEXI_TYPE_VECTOR: break;
+    default: return FLEXI_OK;
+    }
+
+    if (limits->depth >= FLEXI_CONFIG_MAX_DEPTH ||
+        limits->iterables >= FLEXI_CONFIG_MAX_ITERABLES) {
+        return FLEXI_ERR_PARSELIMIT;
+    }
+    limits->iterables += 1;
+
+    if (cursor->type == FLEXI_TYPE_MAP) {
+        flexi_result_e res = cursor_validate_map_keys(cursor);
+        if (res != FLEXI_OK) {
+            return res;
         }
+    }
 
-        if (value->type == FLEXI_TYPE_SINT || value->type == FLEXI_TYPE_UINT ||
-            value->type == FLEXI_TYPE_FLOAT) {
-            // Trivial.
-            min_width = MAX(min_width, value->width);
-        } else if (type_is_indirect(value->type)) {
-            // Get the current cursor position - we haven't written any data
-            // yet, so this will be pre-padding and pre-length.
-            flexi_ssize_t current;
-            if (!ostream_tell(&writer->ostream, &current)) {
-                return FLEXI_ERR_BADWRITE;
-            }
+    limits->depth += 1;
+    const flexi_packed_t *types = cursor_vector_types(cursor);
+    for (flexi_ssize_t i = 0; i < cursor->length; i++) {
+        flexi_type_e type = FLEXI_UNPACK_TYPE(types[i]);
+        if (type == FLEXI_TYPE_FLOAT && !WIDTH_IS_VALID_FLOAT(cursor->width)) {
+            // Direct floats must be at least 32-bit.
+            return FLEXI_ERR_BADREAD;
+        }
+
+        flexi_cursor_s child;
+        if (!cursor_seek_untyped_vector_index(cursor, i, &child)) {
+            return FLEXI_ERR_BADREAD;
+        }
 
-            // The current cursor position is the largest possible offset
-            // we could possibly have.
-            min_width = MAX(min_width, UINT_WIDTH(current));
+        flexi_result_e res = cursor_validate(&child, limits);
+        if (res != FLEXI_OK) {
+            return res;
         }
     }
+    limits->depth -= 1;
 
-    *min = min_width;
     return FLEXI_OK;
 }
 
+/******************************************************************************/
+
 /**
- * @brief Write out the values of a vector.
- *
- * @param[in] writer Writer to operate on.
- * @param[in] len Number of values to write.
- * @param[in] stride Number of bytes between values.
- * @return FLEXI_OK || FLEXI_ERR_BADWRITE.
+ * @brief Return the type of the elements of a typed vector, or
+ *        FLEXI_TYPE_INVALID if the type is not a typed vector.
  */
-static flexi_result_e
-write_vector_values(flexi_writer_s *writer, flexi_ssize_t len, int stride)
+static flexi_type_e
+typed_vector_element_type(flexi_type_e type)
 {
-    // Write values
-    for (flexi_ssize_t i = 0; i < len; i++) {
-        const flexi_value_s *value = writer_peek_idx(writer, len, i);
-        if (value == NULL) {
-            return FLEXI_ERR_INTERNAL;
-        }
+    switch (type) {
+    case FLEXI_TYPE_VECTOR_SINT:
+    case FLEXI_TYPE_VECTOR_SINT2:
+    case FLEXI_TYPE_VECTOR_SINT3:
+    case FLEXI_TYPE_VECTOR_SINT4: return FLEXI_TYPE_SINT;
+    case FLEXI_TYPE_VECTOR_UINT:
+    case FLEXI_TYPE_VECTOR_UINT2:
+    case FLEXI_TYPE_VECTOR_UINT3:
+    case FLEXI_TYPE_VECTOR_UINT4: return FLEXI_TYPE_UINT;
+    case FLEXI_TYPE_VECTOR_FLOAT:
+    case FLEXI_TYPE_VECTOR_FLOAT2:
+    case FLEXI_TYPE_VECTOR_FLOAT3:
+    case FLEXI_TYPE_VECTOR_FLOAT4: return FLEXI_TYPE_FLOAT;
+    case FLEXI_TYPE_VECTOR_KEY: return FLEXI_TYPE_KEY;
+    case FLEXI_TYPE_VECTOR_BOOL: return FLEXI_TYPE_BOOL;
+    default: return FLEXI_TYPE_INVALID;
+    }
+}
 
-        if (value->type == FLEXI_TYPE_SINT) {
-            // Write value inline.
-            if (!write_sint_by_width(writer, value->u.s64, stride)) {
-                return FLEXI_ERR_BADWRITE;
-            }
-        } else if (value->type == FLEXI_TYPE_UINT) {
-            // Write value inline.
-            if (!write_uint_by_width(writer, value->u.u64, stride)) {
-                return FLEXI_ERR_BADWRITE;
-            }
-        } else if (value->type == FLEXI_TYPE_FLOAT) {
-            // Write value inline.
-            switch (value->width) {
-            case 4:
-                if (!write_f32(writer, value->u.f32, stride)) {
-                    return FLEXI_ERR_BADWRITE;
-                }
-                break;
-            case 8:
-                if (!write_f64(writer, value->u.f64, stride)) {
-                    return FLEXI_ERR_BADWRITE;
-                }
-                break;
-            default: return FLEXI_ERR_INTERNAL;
-            }
-        } else if (type_is_indirect(value->type)) {
-            // Get the current cursor position.
-            flexi_ssize_t current;
-            if (!ostream_tell(&writer->ostream, &current)) {
-                return FLEXI_ERR_BADWRITE;
-            }
+/**
+ * @brief Check that a typed vector can be bulk converted into an array of
+ *        the given length, and find the type of its elements.
+ *
+ * @param[in] cursor Cursor pointing at typed vector.
+ * @param[in] dst_len Length of destination array.
+ * @param[out] type Type of elements.
+ * @return FLEXI_OK || FLEXI_ERR_FAILSAFE || FLEXI_ERR_BADTYPE ||
+ *         FLEXI_ERR_PARAM || FLEXI_ERR_BADREAD.
+ */
+static flexi_result_e
+cursor_typed_vector_convertible(const flexi_cursor_s *cursor,
+    flexi_ssize_t dst_len, flexi_type_e *type)
+{
+    if (cursor_is_error(cursor)) {
+        return FLEXI_ERR_FAILSAFE;
+    }
 
-            // Calculate and write offset.
-            flexi_ssize_t offset = current - value->u.offset;
-            if (!write_uint_by_width(writer, offset, stride)) {
-                return FLEXI_ERR_BADWRITE;
-            }
-        } else if (value->type == FLEXI_TYPE_BOOL) {
-            // Write value inline.
-            if (!write_uint_by_width(writer, value->u.u64, stride)) {
-                return FLEXI_ERR_BADWRITE;
-            }
-        }
+    *type = typed_vector_element_type(cursor->type);
+    if (*type == FLEXI_TYPE_INVALID || *type == FLEXI_TYPE_KEY) {
+        return FLEXI_ERR_BADTYPE;
     }
+
+    if (dst_len < cursor->length) {
+        return FLEXI_ERR_PARAM;
+    }
+
+    // Booleans are always packed one per byte.
+    flexi_ssize_t stride = *type == FLEXI_TYPE_BOOL ? 1 : cursor->width;
+    if (!cursor->trusted &&
+        (cursor->cursor < span_begin(&cursor->msg) ||
+            cursor->cursor + (cursor->length * stride) >
+                span_end(&cursor->msg))) {
+        // Fixed length vectors are not checked when the cursor is created.
+        return FLEXI_ERR_BADREAD;
+    }
+
     return FLEXI_OK;
 }
 
 /**
- * @brief Write out all types of a vector.
+ * @brief Read each element of a typed vector as type T, convert it with
+ *        the expression CONV of element v, and store it in dst.
  *
- * @param[in] writer Writer to operate on.
- * @param[in] len Number of types.
- * @return True if write was successful.
+ * @details Each loop has a fixed element size so the compiler is free to
+ *          vectorize it.
+ */
+#define CONVERT_LOOP(T, CONV)                                                  \
+    do {                                                                       \
+        for (flexi_ssize_t i = 0; i < count; i++) {                            \
+            T v;                                                               \
+            memcpy(&v, src + (i * (flexi_ssize_t)sizeof(T)), sizeof(T));       \
+            dst[i] = CONV;                                                     \
+        }                                                                      \
+    } while (0)
+
+/**
+ * @brief Same as CONVERT_LOOP, but also sets bad if the expression BAD is
+ *        true for any element.
+ *
+ * @details CONV must saturate with plain selects, and bad is collected in
+ *          a separate statement, so the loop stays free of branches and
+ *          side effects and can still be vectorized.
+ */
+#define CONVERT_CHECKED_LOOP(T, BAD, CONV)                                     \
+    do {                                                                       \
+        for (flexi_ssize_t i = 0; i < count; i++) {                            \
+            T v;                                                               \
+            memcpy(&v, src + (i * (flexi_ssize_t)sizeof(T)), sizeof(T));       \
+            bad |= (BAD);                                                      \
+            dst[i] = CONV;                                                     \
+        }                                                                      \
+    } while (0)
+
+#define I64_RANGE_MAX (9223372036854775808.0)
+#define U64_RANGE_MAX (18446744073709551616.0)
+
+#define F64_IN_I64(v) (((v) >= -I64_RANGE_MAX) & ((v) < I64_RANGE_MAX))
+#define F64_IN_U64(v) (((v) >= 0.0) & ((v) < U64_RANGE_MAX))
+#define F64_IN_F32(v)                                                          \
+    (!(((v) > FLT_MAX) & ((v) <= DBL_MAX)) &                                   \
+        !(((v) < -FLT_MAX) & ((v) >= -DBL_MAX)))
+
+/**
+ * @brief Convert a double to int64_t, saturating values that are out of
+ *        range and converting NaN to 0.
+ *
+ * @details Only in-range values reach the conversion, which keeps it
+ *          branch-free.
+ */
+static int64_t
+saturate_f64_to_i64(double v)
+{
+    int64_t r = (int64_t)(F64_IN_I64(v) ? v : 0.0);
+    r = v >= I64_RANGE_MAX ? INT64_MAX : r;
+    r = v < -I64_RANGE_MAX ? INT64_MIN : r;
+    return r;
+}
+
+/**
+ * @brief Convert a double to uint64_t, saturating values that are out of
+ *        range and converting NaN to 0.
+ */
+static uint64_t
+saturate_f64_to_u64(double v)
+{
+    uint64_t r = (uint64_t)(F64_IN_U64(v) ? v : 0.0);
+    r = v >= U64_RANGE_MAX ? UINT64_MAX : r;
+    return r;
+}
+
+/**
+ * @brief Convert a double to float, saturating finite values that are out
+ *        of range.  Infinities and NaN are kept.
+ *
+ * @details The clamp is done on the bits of the double with masks, since
+ *          compilers will not turn a select between doubles into vector
+ *          code.
+ */
+static float
+saturate_f64_to_f32(double v)
+{
+    static const double s_max = FLT_MAX;
+    static const double s_min = -FLT_MAX;
+    uint64_t bits, max_bits, min_bits;
+    memcpy(&bits, &v, sizeof(bits));
+    memcpy(&max_bits, &s_max, sizeof(max_bits));
+    memcpy(&min_bits, &s_min, sizeof(min_bits));
+
+    uint64_t hi = -(uint64_t)((v > FLT_MAX) & (v <= DBL_MAX));
+    uint64_t lo = -(uint64_t)((v < -FLT_MAX) & (v >= -DBL_MAX));
+    bits = (bits & ~(hi | lo)) | (max_bits & hi) | (min_bits & lo);
+
+    double r;
+    memcpy(&r, &bits, sizeof(r));
+    return (float)r;
+}
+
+/**
+ * @brief Bulk convert typed vector elements to int64_t.
+ *
+ * @return True if every element was in range.
  */
 static bool
-write_vector_types(flexi_writer_s *writer, flexi_ssize_t len)
+convert_to_i64(const char *src, flexi_type_e type, int width,
+    flexi_ssize_t count, int64_t *dst)
 {
-    for (int i = 0; i < (int)len; i++) {
-        const flexi_value_s *value = writer_peek_idx(writer, (int)len, i);
-        flexi_packed_t packed =
-            PACK_TYPE(value->type) | PACK_WIDTH(value->width);
-        if (!ostream_write(&writer->ostream, &packed, sizeof(flexi_packed_t))) {
-            return false;
+    unsigned bad = 0;
+    switch (type) {
+    case FLEXI_TYPE_SINT:
+        switch (width) {
+        case 1: CONVERT_LOOP(int8_t, v); break;
+        case 2: CONVERT_LOOP(int16_t, v); break;
+        case 4: CONVERT_LOOP(int32_t, v); break;
+        case 8: CONVERT_LOOP(int64_t, v); break;
+        }
+        break;
+    case FLEXI_TYPE_UINT:
+        switch (width) {
+        case 1: CONVERT_LOOP(uint8_t, v); break;
+        case 2: CONVERT_LOOP(uint16_t, v); break;
+        case 4: CONVERT_LOOP(uint32_t, v); break;
+        case 8:
+            CONVERT_CHECKED_LOOP(uint64_t, v > INT64_MAX,
+                v > INT64_MAX ? INT64_MAX : (int64_t)v);
+            break;
+        }
+        break;
+    case FLEXI_TYPE_FLOAT:
+        switch (width) {
+        case 4:
+            CONVERT_CHECKED_LOOP(float, !F64_IN_I64((double)v),
+                saturate_f64_to_i64(v));
+            break;
+        case 8:
+            CONVERT_CHECKED_LOOP(double, !F64_IN_I64(v),
+                saturate_f64_to_i64(v));
+            break;
         }
+        break;
+    case FLEXI_TYPE_BOOL: CONVERT_LOOP(uint8_t, v != 0); break;
+    default: ASSERT(false); break;
     }
+    return bad == 0;
+}
 
-    return true;
+/**
+ * @brief Bulk convert typed vector elements to uint64_t.
+ *
+ * @return True if every element was in range.
+ */
+static bool
+convert_to_u64(const char *src, flexi_type_e type, int width,
+    flexi_ssize_t count, uint64_t *dst)
+{
+    unsigned bad = 0;
+    switch (type) {
+    case FLEXI_TYPE_SINT:
+        switch (width) {
+        case 1:
+            CONVERT_CHECKED_LOOP(int8_t, v < 0, v < 0 ? 0 : (uint64_t)v);
+            break;
+        case 2:
+            CONVERT_CHECKED_LOOP(int16_t, v < 0, v < 0 ? 0 : (uint64_t)v);
+            break;
+        case 4:
+            CONVERT_CHECKED_LOOP(int32_t, v < 0, v < 0 ? 0 : (uint64_t)v);
+            break;
+        case 8:
+            CONVERT_CHECKED_LOOP(int64_t, v < 0, v < 0 ? 0 : (uint64_t)v);
+            break;
+        }
+        break;
+    case FLEXI_TYPE_UINT:
+        switch (width) {
+        case 1: CONVERT_LOOP(uint8_t, v); break;
+        case 2: CONVERT_LOOP(uint16_t, v); break;
+        case 4: CONVERT_LOOP(uint32_t, v); break;
+        case 8: CONVERT_LOOP(uint64_t, v); break;
+        }
+        break;
+    case FLEXI_TYPE_FLOAT:
+        switch (width) {
+        case 4:
+            CONVERT_CHECKED_LOOP(float, !F64_IN_U64((double)v),
+                saturate_f64_to_u64(v));
+            break;
+        case 8:
+            CONVERT_CHECKED_LOOP(double, !F64_IN_U64(v),
+                saturate_f64_to_u64(v));
+            break;
+        }
+        break;
+    case FLEXI_TYPE_BOOL: CONVERT_LOOP(uint8_t, v != 0); break;
+    default: ASSERT(false); break;
+    }
+    return bad == 0;
 }
 
 /**
- * @brief Sort the keys of a map so all keys are in strcmp order.
+ * @brief Bulk convert typed vector elements to float.
  *
- * @param writer[in] Writer to operate on.
- * @param len[in] Number of keys to use for map.
- * @return True if sort was successful.
+ * @return True if every element was in range.
  */
 static bool
-writer_sort_map_keys(flexi_writer_s *writer, flexi_ssize_t len)
+convert_to_f32(const char *src, flexi_type_e type, int width,
+    flexi_ssize_t count, float *dst)
 {
-    flexi_ssize_t start = stack_count(&writer->stack) - len;
-    if (start < 0) {
+    unsigned bad = 0;
+    switch (type) {
+    case FLEXI_TYPE_SINT:
+        switch (width) {
+        case 1: CONVERT_LOOP(int8_t, (float)v); break;
+        case 2: CONVERT_LOOP(int16_t, (float)v); break;
+        case 4: CONVERT_LOOP(int32_t, (float)v); break;
+        case 8: CONVERT_LOOP(int64_t, (float)v); break;
+        }
+        break;
+    case FLEXI_TYPE_UINT:
+        switch (width) {
+        case 1: CONVERT_LOOP(uint8_t, (float)v); break;
+        case 2: CONVERT_LOOP(uint16_t, (float)v); break;
+        case 4: CONVERT_LOOP(uint32_t, (float)v); break;
+        case 8: CONVERT_LOOP(uint64_t, (float)v); break;
+        }
+        break;
+    case FLEXI_TYPE_FLOAT:
+        switch (width) {
+        case 4: CONVERT_LOOP(float, v); break;
+        case 8:
+            CONVERT_CHECKED_LOOP(double, !F64_IN_F32(v),
+                saturate_f64_to_f32(v));
+            break;
+        }
+        break;
+    case FLEXI_TYPE_BOOL: CONVERT_LOOP(uint8_t, v != 0 ? 1.0f : 0.0f); break;
+    default: ASSERT(false); break;
+    }
+    return bad == 0;
+}
+
+/**
+ * @brief Bulk convert typed vector elements to double.
+ */
+static void
+convert_to_f64(const char *src, flexi_type_e type, int width,
+    flexi_ssize_t count, double *dst)
+{
+    switch (type) {
+    case FLEXI_TYPE_SINT:
+        switch (width) {
+        case 1: CONVERT_LOOP(int8_t, (double)v); break;
+        case 2: CONVERT_LOOP(int16_t, (double)v); break;
+        case 4: CONVERT_LOOP(int32_t, (double)v); break;
+        case 8: CONVERT_LOOP(int64_t, (double)v); break;
+        }
+        break;
+    case FLEXI_TYPE_UINT:
+        switch (width) {
+        case 1: CONVERT_LOOP(uint8_t, (double)v); break;
+        case 2: CONVERT_LOOP(uint16_t, (double)v); break;
+        case 4: CONVERT_LOOP(uint32_t, (double)v); break;
+        case 8: CONVERT_LOOP(uint64_t, (double)v); break;
+        }
+        break;
+    case FLEXI_TYPE_FLOAT:
+        switch (width) {
+        case 4: CONVERT_LOOP(float, (double)v); break;
+        case 8: CONVERT_LOOP(double, v); break;
+        }
+        break;
+    case FLEXI_TYPE_BOOL: CONVERT_LOOP(uint8_t, v != 0 ? 1.0 : 0.0); break;
+    default: ASSERT(false); break;
+    }
+}
+
+#undef CONVERT_LOOP
+#undef CONVERT_CHECKED_LOOP
+#undef I64_RANGE_MAX
+#undef U64_RANGE_MAX
+#undef F64_IN_I64
+#undef F64_IN_U64
+#undef F64_IN_F32
+
+/**
+ * @brief Peek at the n-th value from the current tail of the stack.  0 is
+ *        the tail of the stack and returns a value if the stack contains
+ *        any values.
+ *
+ * @param[in] writer Offset to use.
+ * @param[in] offset Offset from the tail.
+ * @return Value at stack position, or NULL if offset out of range.
+ */
+static flexi_value_s *
+writer_peek_tail(flexi_writer_s *writer, flexi_ssize_t offset)
+{
+    return stack_at(&writer->stack, offset);
+}
+
+/**
+ * @brief Peek at the value in the stack, starting with the n-th value in
+ * the stack (0 is head, towards tail) and then offseting by the given index
+ * (0 is start value, towards head).
+ *
+ * @param[in] writer Writer to use.
+ * @param[in] start Stack offset to start from (towards tail).
+ * @param[in] index Positive offset from the starting stack offset (towards
+ *                  head).
+ * @return Value at stack position, or NULL if offset is invalid
+ */
+static flexi_value_s *
+writer_peek_idx(flexi_writer_s *writer, flexi_ssize_t start,
+    flexi_ssize_t index)
+{
+    flexi_ssize_t offset = stack_count(&writer->stack);
+
+    offset -= start;
+    offset += index;
+
+    return stack_at(&writer->stack, offset);
+}
+
+/**
+ * @brief Pop a value off the stack.
+ *
+ * @param[in] writer Writer to operate on.
+ * @param[in] count Number of values to pop.
+ * @return True if pop was successful, or false if stack was underflowed.
+ */
+static bool
+writer_pop(flexi_writer_s *writer, flexi_ssize_t count)
+{
+    flexi_ssize_t scount = stack_count(&writer->stack);
+    if (scount < count) {
         return false;
     }
 
-    // Shell sort gap sequence.
-    static const flexi_ssize_t gaps[] = {701, 301, 132, 57, 23, 10, 4, 1};
+    // Free all to-be-popped stack keys.
+    if (writer->opt_free != NULL) {
+        flexi_ssize_t top = scount - 1;
+        flexi_ssize_t bottom = top - count;
+        for (flexi_ssize_t i = top; i > bottom; i--) {
+            flexi_value_s *value = stack_at(&writer->stack, i);
+            if (value->key) {
+                writer->opt_free((void *)value->key);
+            }
+            value->key = NULL;
+        }
+    }
+
+    flexi_ssize_t actual = stack_pop(&writer->stack, count);
+    return count == actual;
+}
+
+/**
+ * @brief Largest range of a map that is sorted with insertion sort.
+ */
+#define SORT_INSERTION_MAX (16)
 
-    // The actual shell sort.
-    for (size_t g = 0; g < 8; g++) {
-        flexi_ssize_t gap = gaps[g];
+/**
+ * @brief State of a map sort.
+ *
+ * @details Entries are sorted in place through the stack interface, so no
+ *          scratch memory is needed.
+ */
+typedef struct writer_sort_s {
+    flexi_writer_s *writer;
+    flexi_ssize_t start;
+    bool keys;
+} writer_sort_s;
 
-        for (flexi_ssize_t i = gap; i < len; i++) {
-            flexi_value_s *cur = writer_get_stack_key(writer, start, i);
-            flexi_ssize_t curoff = cur->u.offset;
-            const char *curkey =
-                (const char *)ostream_data_at(&writer->ostream, curoff);
+/**
+ * @brief Obtain the key string of a map entry while sorting.
+ *
+ * @param[in] sort Sort state.
+ * @param[in] index Array-based index for the map.
+ * @return Key string.
+ */
+static const char *
+sort_key(const writer_sort_s *sort, flexi_ssize_t index)
+{
+    const flexi_value_s *v =
+        stack_at(&sort->writer->stack, sort->start + index);
+    if (sort->keys) {
+        return (const char *)writer_data_at(sort->writer, v->u.offset);
+    }
+    return v->key;
+}
+
+/**
+ * @brief Compare the keys of two map entries while sorting.
+ */
+static int
+sort_cmp(const writer_sort_s *sort, flexi_ssize_t a, flexi_ssize_t b)
+{
+    return strcmp(sort_key(sort, a), sort_key(sort, b));
+}
+
+/**
+ * @brief Swap two map entries while sorting.
+ */
+static void
+sort_swap(const writer_sort_s *sort, flexi_ssize_t a, flexi_ssize_t b)
+{
+    if (a == b) {
+        return;
+    }
+
+    flexi_value_s *va = stack_at(&sort->writer->stack, sort->start + a);
+    flexi_value_s *vb = stack_at(&sort->writer->stack, sort->start + b);
+    flexi_value_s tmp;
+    memcpy(&tmp, va, sizeof(flexi_value_s));
+    memcpy(va, vb, sizeof(flexi_value_s));
+    memcpy(vb, &tmp, sizeof(flexi_value_s));
+}
+
+/**
+ * @brief Insertion sort a range of map entries.
+ */
+static void
+sort_insertion(const writer_sort_s *sort, flexi_ssize_t lo, flexi_ssize_t hi)
+{
+    for (flexi_ssize_t i = lo + 1; i < hi; i++) {
+        for (flexi_ssize_t j = i; j > lo && sort_cmp(sort, j - 1, j) > 0;
+             j--) {
+            sort_swap(sort, j - 1, j);
+        }
+    }
+}
+
+/**
+ * @brief Move an entry down a heap until both of its children are smaller.
+ */
+static void
+sort_sift_down(const writer_sort_s *sort, flexi_ssize_t lo,
+    flexi_ssize_t root, flexi_ssize_t len)
+{
+    for (;;) {
+        flexi_ssize_t child = (root * 2) + 1;
+        if (child >= len) {
+            return;
+        }
+
+        if (child + 1 < len &&
+            sort_cmp(sort, lo + child, lo + child + 1) < 0) {
+            child += 1;
+        }
+
+        if (sort_cmp(sort, lo + root, lo + child) >= 0) {
+            return;
+        }
+
+        sort_swap(sort, lo + root, lo + child);
+        root = child;
+    }
+}
+
+/**
+ * @brief Heap sort a range of map entries.
+ */
+static void
+sort_heap(const writer_sort_s *sort, flexi_ssize_t lo, flexi_ssize_t hi)
+{
+    flexi_ssize_t len = hi - lo;
+    for (flexi_ssize_t i = (len / 2) - 1; i >= 0; i--) {
+        sort_sift_down(sort, lo, i, len);
+    }
+
+    for (flexi_ssize_t end = len - 1; end > 0; end--) {
+        sort_swap(sort, lo, lo + end);
+        sort_sift_down(sort, lo, 0, end);
+    }
+}
+
+/**
+ * @brief Partition a range of map entries around the median of its first,
+ *        middle and last entries.
+ *
+ * @return Final index of the pivot.
+ */
+static flexi_ssize_t
+sort_partition(const writer_sort_s *sort, flexi_ssize_t lo, flexi_ssize_t hi)
+{
+    flexi_ssize_t mid = lo + ((hi - lo) / 2);
+    if (sort_cmp(sort, mid, lo) < 0) {
+        sort_swap(sort, mid, lo);
+    }
+    if (sort_cmp(sort, hi - 1, lo) < 0) {
+        sort_swap(sort, hi - 1, lo);
+    }
+    if (sort_cmp(sort, hi - 1, mid) < 0) {
+        sort_swap(sort, hi - 1, mid);
+    }
+
+    // Keep the pivot at the start of the range while partitioning.
+    sort_swap(sort, lo, mid);
+
+    flexi_ssize_t i = lo + 1;
+    flexi_ssize_t j = hi - 1;
+    for (;;) {
+        while (i <= j && sort_cmp(sort, i, lo) < 0) {
+            i += 1;
+        }
+        while (i <= j && sort_cmp(sort, j, lo) > 0) {
+            j -= 1;
+        }
+        if (i >= j) {
+            break;
+        }
+
+        sort_swap(sort, i, j);
+        i += 1;
+        j -= 1;
+    }
+
+    sort_swap(sort, lo, j);
+    return j;
+}
+
+/**
+ * @brief Introsort a range of map entries.
+ *
+ * @param[in] sort Sort state.
+ * @param[in] lo First entry of range.
+ * @param[in] hi One past the last entry of range.
+ * @param[in] depth Number of partitions left before falling back to heap
+ *                  sort.
+ */
+static void
+sort_intro(const writer_sort_s *sort, flexi_ssize_t lo, flexi_ssize_t hi,
+    int depth)
+{
+    while (hi - lo > SORT_INSERTION_MAX) {
+        if (depth == 0) {
+            sort_heap(sort, lo, hi);
+            return;
+        }
+        depth -= 1;
+
+        // Recurse into the smaller side to keep the recursion shallow.
+        flexi_ssize_t p = sort_partition(sort, lo, hi);
+        if (p - lo < hi - p) {
+            sort_intro(sort, lo, p, depth);
+            lo = p + 1;
+        } else {
+            sort_intro(sort, p + 1, hi, depth);
+            hi = p;
+        }
+    }
+
+    sort_insertion(sort, lo, hi);
+}
+
+/**
+ * @brief Sort the entries of a map so all keys are in strcmp order.
+ *
+ * @param[in] writer Writer to operate on.
+ * @param[in] len Number of entries to use for map.
+ * @param[in] keys True if the entries are keys that were already written,
+ *                 false if the entries are values with map keys.
+ * @return True if sort was successful.
+ */
+static bool
+writer_sort_map(flexi_writer_s *writer, flexi_ssize_t len, bool keys)
+{
+    flexi_ssize_t start = stack_count(&writer->stack) - len;
+    if (start < 0) {
+        return false;
+    }
+
+    writer_sort_s sort;
+    sort.writer = writer;
+    sort.start = start;
+    sort.keys = keys;
+
+    if (keys && writer->dry_run) {
+        // Order decides the offsets a map's keys vector needs to hold, so
+        // the dry run sorts too, using the keys it kept.
+        for (flexi_ssize_t i = 0; i < len; i++) {
+            if (sort_key(&sort, i) == NULL) {
+                return false;
+            }
+        }
+    }
+
+    // Keys are often written in order already, which we can confirm in a
+    // single pass.
+    flexi_ssize_t i = 1;
+    while (i < len && sort_cmp(&sort, i - 1, i) <= 0) {
+        i += 1;
+    }
+    if (i >= len) {
+        return true;
+    }
+
+    int depth = 0;
+    for (flexi_ssize_t n = len; n > 1; n /= 2) {
+        depth += 2;
+    }
+
+    sort_intro(&sort, 0, len, depth);
+    return true;
+}
+
+/**
+ * @brief Sort the values of a map so all values keys are in strcmp order.
+ *
+ * @param writer[in] Writer to operate on.
+ * @param len[in] Number of values to use for map.
+ * @return True if sort was successful.
+ */
+static bool
+writer_sort_map_values(flexi_writer_s *writer, flexi_ssize_t len)
+{
+    return writer_sort_map(writer, len, false);
+}
+
+/**
+ * @brief Sort the keys of a map so all keys are in strcmp order.
+ *
+ * @param writer[in] Writer to operate on.
+ * @param len[in] Number of keys to use for map.
+ * @return True if sort was successful.
+ */
+static bool
+writer_sort_map_keys(flexi_writer_s *writer, flexi_ssize_t len)
+{
+    return writer_sort_map(writer, len, true);
+}
+
+/**
+ * @brief Check if the offsets to all indirect values of a vector fit in a
+ *        stride.
+ *
+ * @param[in] writer Writer to operate on.
+ * @param[in] len Number of values to examine.
+ * @param[in] stride Number of bytes between values.
+ * @param[in] base Stream position of the first value.
+ * @return True if every offset fits.
+ */
+static bool
+writer_vector_offsets_fit(flexi_writer_s *writer, flexi_ssize_t len,
+    int stride, flexi_ssize_t base)
+{
+    for (flexi_ssize_t i = 0; i < len; i++) {
+        const flexi_value_s *value = writer_peek_idx(writer, len, i);
+        if (type_is_indirect(value->type)) {
+            flexi_ssize_t offset = base + (i * stride) - value->u.offset;
+            if (UINT_WIDTH((uint64_t)offset) > stride) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Calculate the minimum stride needed to store values in vector.
+ *
+ * @details Offsets to indirect values depend on the stride, through the
+ *          padding and the fields before the values, and pooled values can
+ *          be further back than anything written since.  So the stride is
+ *          widened until every offset really fits.
+ *
+ * @param[in] writer Writer to operate on.
+ * @param[in] len Number of values to examine.
+ * @param[in] stride Smallest stride to use in bytes.
+ * @param[in] align True if the stream is padded to the stride first.
+ * @param[in] prefix Number of stride-wide fields before the first value.
+ * @param[in] keys Offset of the keys vector that the first field points
+ *                 to, or -1 if the first field is not an offset.
+ * @param[out] min Actual minimum stride needed in bytes.
+ * @return FLEXI_OK || FLEXI_ERR_BADWRITE || FLEXI_ERR_INTERNAL.
+ */
+static flexi_result_e
+writer_vector_calc_min_stride(flexi_writer_s *writer, flexi_ssize_t len,
+    int stride, bool align, int prefix, flexi_ssize_t keys, int *min)
+{
+    int min_width = stride;
+    bool indirect = keys >= 0;
+    for (flexi_ssize_t i = 0; i < len; i++) {
+        const flexi_value_s *value = writer_peek_idx(writer, len, i);
+        if (value == NULL) {
+            return FLEXI_ERR_INTERNAL;
+        }
+
+        if (value->type == FLEXI_TYPE_SINT || value->type == FLEXI_TYPE_UINT ||
+            value->type == FLEXI_TYPE_FLOAT) {
+            // Trivial.
+            min_width = MAX(min_width, value->width);
+        } else if (type_is_indirect(value->type)) {
+            indirect = true;
+        }
+    }
+
+    if (indirect) {
+        // We haven't written any data yet, so this is pre-padding and
+        // pre-length.
+        flexi_ssize_t current;
+        if (!writer_tell(writer, &current)) {
+            return FLEXI_ERR_BADWRITE;
+        }
+
+        for (; min_width < 8; min_width *= 2) {
+            flexi_ssize_t base = current;
+            if (align) {
+                base = (flexi_ssize_t)round_to_pow2_mul64(current, min_width);
+            }
+
+            if (keys >= 0 && UINT_WIDTH((uint64_t)(base - keys)) > min_width) {
+                continue;
+            }
+
+            base += (flexi_ssize_t)prefix * min_width;
+            if (writer_vector_offsets_fit(writer, len, min_width, base)) {
+                break;
+            }
+        }
+    }
+
+    *min = min_width;
+    return FLEXI_OK;
+}
+
+/**
+ * @brief Encode the values of a vector into a stage.
+ *
+ * @param[in,out] stage Stage to encode into.
+ * @param[in] len Number of values to write.
+ * @param[in] stride Number of bytes between values.
+ * @param[in] base Stream position of the first value, which is used to
+ *                 calculate offsets to indirect values.
+ * @return FLEXI_OK || FLEXI_ERR_BADWRITE.
+ */
+static flexi_result_e
+write_vector_values(writer_stage_s *stage, flexi_ssize_t len, int stride,
+    flexi_ssize_t base)
+{
+    // Write values
+    for (flexi_ssize_t i = 0; i < len; i++) {
+        const flexi_value_s *value = writer_peek_idx(stage->writer, len, i);
+        if (value == NULL) {
+            return FLEXI_ERR_INTERNAL;
+        }
+
+        if (value->type == FLEXI_TYPE_SINT) {
+            // Write value inline.
+            if (!stage_sint_by_width(stage, value->u.s64, stride)) {
+                return FLEXI_ERR_BADWRITE;
+            }
+        } else if (value->type == FLEXI_TYPE_UINT) {
+            // Write value inline.
+            if (!stage_uint_by_width(stage, value->u.u64, stride)) {
+                return FLEXI_ERR_BADWRITE;
+            }
+        } else if (value->type == FLEXI_TYPE_FLOAT) {
+            // Write value inline.
+            switch (value->width) {
+            case 4:
+                if (!stage_f32(stage, value->u.f32, stride)) {
+                    return FLEXI_ERR_BADWRITE;
+                }
+                break;
+            case 8:
+                if (!stage_f64(stage, value->u.f64, stride)) {
+                    return FLEXI_ERR_BADWRITE;
+                }
+                break;
+            default: return FLEXI_ERR_INTERNAL;
+            }
+        } else if (type_is_indirect(value->type)) {
+            // Calculate and write offset from the position of this value.
+            flexi_ssize_t offset = base + (i * stride) - value->u.offset;
+            if (!stage_uint_by_width(stage, offset, stride)) {
+                return FLEXI_ERR_BADWRITE;
+            }
+        } else if (value->type == FLEXI_TYPE_BOOL) {
+            // Write value inline.
+            if (!stage_uint_by_width(stage, value->u.u64, stride)) {
+                return FLEXI_ERR_BADWRITE;
+            }
+        }
+    }
+    return FLEXI_OK;
+}
+
+/**
+ * @brief Encode all types of a vector into a stage.
+ *
+ * @param[in,out] stage Stage to encode into.
+ * @param[in] len Number of types.
+ * @return True if write was successful.
+ */
+static bool
+write_vector_types(writer_stage_s *stage, flexi_ssize_t len)
+{
+    for (flexi_ssize_t i = 0; i < len; i++) {
+        const flexi_value_s *value = writer_peek_idx(stage->writer, len, i);
+        flexi_packed_t packed =
+            PACK_TYPE(value->type) | PACK_WIDTH(value->width);
+        if (!stage_uint_by_width(stage, packed, sizeof(flexi_packed_t))) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Find the element type of a typed vector that could hold all of
+ *        the values of a vector.
+ *
+ * @param[in] writer Writer to operate on.
+ * @param[in] len Number of values to examine.
+ * @return Type shared by all values, or FLEXI_TYPE_INVALID if the values
+ *         need an untyped vector.
+ */
+static flexi_type_e
+writer_vector_typed_element(flexi_writer_s *writer, flexi_ssize_t len)
+{
+    if (len <= 0) {
+        return FLEXI_TYPE_INVALID;
+    }
+
+    const flexi_value_s *first = writer_peek_idx(writer, len, 0);
+    if (first == NULL) {
+        return FLEXI_TYPE_INVALID;
+    }
+
+    switch (first->type) {
+    case FLEXI_TYPE_SINT:
+    case FLEXI_TYPE_UINT:
+    case FLEXI_TYPE_FLOAT:
+    case FLEXI_TYPE_KEY:
+    case FLEXI_TYPE_BOOL: break;
+    default: return FLEXI_TYPE_INVALID;
+    }
+
+    for (flexi_ssize_t i = 1; i < len; i++) {
+        const flexi_value_s *value = writer_peek_idx(writer, len, i);
+        if (value == NULL || value->type != first->type) {
+            return FLEXI_TYPE_INVALID;
+        }
+    }
+
+    return first->type;
+}
+
+/**
+ * @brief Return the typed vector type for elements of the passed type.
+ *
+ * @param[in] type Type of the elements.
+ * @param[in] len Number of elements.
+ * @return Typed vector type, which is fixed-length if possible.
+ */
+static flexi_type_e
+typed_vector_type(flexi_type_e type, flexi_ssize_t len)
+{
+    switch (type) {
+    case FLEXI_TYPE_SINT:
+        return len == 2   ? FLEXI_TYPE_VECTOR_SINT2
+               : len == 3 ? FLEXI_TYPE_VECTOR_SINT3
+               : len == 4 ? FLEXI_TYPE_VECTOR_SINT4
+                          : FLEXI_TYPE_VECTOR_SINT;
+    case FLEXI_TYPE_UINT:
+        return len == 2   ? FLEXI_TYPE_VECTOR_UINT2
+               : len == 3 ? FLEXI_TYPE_VECTOR_UINT3
+               : len == 4 ? FLEXI_TYPE_VECTOR_UINT4
+                          : FLEXI_TYPE_VECTOR_UINT;
+    case FLEXI_TYPE_FLOAT:
+        return len == 2   ? FLEXI_TYPE_VECTOR_FLOAT2
+               : len == 3 ? FLEXI_TYPE_VECTOR_FLOAT3
+               : len == 4 ? FLEXI_TYPE_VECTOR_FLOAT4
+                          : FLEXI_TYPE_VECTOR_FLOAT;
+    case FLEXI_TYPE_KEY: return FLEXI_TYPE_VECTOR_KEY;
+    case FLEXI_TYPE_BOOL: return FLEXI_TYPE_VECTOR_BOOL;
+    default: return FLEXI_TYPE_INVALID;
+    }
+}
+
+/******************************************************************************/
+
+/**
+ * @brief Initialize a writer pool in the passed buffer.
+ *
+ * @param[out] pool Pool to initialize.
+ * @param[in] buffer Buffer to store the pool in, or NULL for no pool.
+ * @param[in] len Length of buffer in bytes.
+ * @return FLEXI_OK || FLEXI_ERR_PARAM.
+ */
+static flexi_result_e
+writer_pool_init(flexi_writer_pool_s *pool, void *buffer, flexi_ssize_t len)
+{
+    pool->slots = NULL;
+    pool->capacity = 0;
+    pool->count = 0;
+    if (buffer == NULL) {
+        return FLEXI_OK;
+    }
+
+    flexi_ssize_t max_slots =
+        len / (flexi_ssize_t)(sizeof(flexi_ssize_t) * POOL_SLOT_LEN);
+    flexi_ssize_t capacity = 1;
+    while (capacity * 2 <= max_slots) {
+        capacity *= 2;
+    }
+    if (capacity < 2 || capacity > max_slots) {
+        return FLEXI_ERR_PARAM;
+    }
+
+    memset(buffer, 0, (size_t)capacity * sizeof(flexi_ssize_t) * POOL_SLOT_LEN);
+    pool->slots = (flexi_ssize_t *)buffer;
+    pool->capacity = capacity;
+    return FLEXI_OK;
+}
+
+/**
+ * @brief Remove all entries from a writer pool.
+ *
+ * @param[in,out] pool Pool to clear.
+ */
+static void
+writer_pool_clear(flexi_writer_pool_s *pool)
+{
+    if (pool->slots != NULL) {
+        memset(pool->slots, 0,
+            (size_t)pool->capacity * sizeof(flexi_ssize_t) * POOL_SLOT_LEN);
+    }
+    pool->count = 0;
+}
+
+/**
+ * @brief Return the slot to look at after n collisions for a hash.
+ *
+ * @param[in] pool Pool to look in.
+ * @param[in] hash Hash to look up.
+ * @param[in] n Number of collisions so far.
+ * @return Slot, which is empty if the offset + 1 is 0.
+ */
+static flexi_ssize_t *
+writer_pool_probe(const flexi_writer_pool_s *pool, uint32_t hash,
+    flexi_ssize_t n)
+{
+    flexi_ssize_t slot = ((flexi_ssize_t)hash + n) & (pool->capacity - 1);
+    return &pool->slots[slot * POOL_SLOT_LEN];
+}
+
+/**
+ * @brief Fill an empty slot of a writer pool, unless the pool is full.
+ *
+ * @param[in,out] pool Pool to insert into.
+ * @param[in,out] slot Empty slot found by writer_pool_probe.
+ * @param[in] hash Hash of value.
+ * @param[in] offset Offset of value in the stream.
+ * @param[in] extra Extra information to keep about the value.
+ */
+static void
+writer_pool_insert(flexi_writer_pool_s *pool, flexi_ssize_t *slot,
+    uint32_t hash, flexi_ssize_t offset, flexi_ssize_t extra)
+{
+    if (pool->count + 1 >= pool->capacity - (pool->capacity / 4)) {
+        // Keep the load factor under 75%, and leave at least one slot
+        // empty even in the smallest pool.
+        return;
+    }
+
+    slot[0] = (flexi_ssize_t)hash;
+    slot[1] = offset + 1;
+    slot[2] = extra;
+    pool->count += 1;
+}
+
+/**
+ * @brief Look for a key which was already written to the stream.
+ *
+ * @param[in] writer Writer to operate on.
+ * @param[in] str Key to look for.
+ * @param[in] len Length of key.
+ * @param[in] hash Hash of key.
+ * @param[out] slot Slot holding the key, empty slot to insert it into, or
+ *                  NULL if the pool was searched without finding either.
+ * @param[out] offset Offset of key in the stream, or -1 if it was not found.
+ * @return FLEXI_OK || FLEXI_ERR_BADWRITE.
+ */
+static flexi_result_e
+writer_find_key(flexi_writer_s *writer, const char *str, flexi_ssize_t len,
+    uint32_t hash, flexi_ssize_t **slot, flexi_ssize_t *offset)
+{
+    *offset = -1;
+    for (flexi_ssize_t n = 0; n < writer->key_pool.capacity; n++) {
+        *slot = writer_pool_probe(&writer->key_pool, hash, n);
+        flexi_ssize_t found = (*slot)[1];
+        if (found == 0) {
+            return FLEXI_OK;
+        }
+
+        if ((uint32_t)(*slot)[0] == hash && (*slot)[2] == len) {
+            const char *cmp =
+                (const char *)writer_data_at(writer, found - 1);
+            if (cmp == NULL) {
+                return FLEXI_ERR_BADWRITE;
+            } else if (!strcmp(cmp, str)) {
+                *offset = found - 1;
+                return FLEXI_OK;
+            }
+        }
+    }
+
+    *slot = NULL;
+    return FLEXI_OK;
+}
+
+/**
+ * @brief Fingerprint the keys at the top of the stack, in any order.
+ *
+ * @param[in] writer Writer to operate on.
+ * @param[in] len Number of keys.
+ * @param[in] keyed True if the keys are the map keys of values, false if
+ *                  they are keys that were already written.
+ * @param[out] hash Fingerprint of the keys.
+ * @return FLEXI_OK || FLEXI_ERR_BADSTACK || FLEXI_ERR_BADWRITE.
+ */
+static flexi_result_e
+writer_keyset_hash(flexi_writer_s *writer, flexi_ssize_t len, bool keyed,
+    uint32_t *hash)
+{
+    // Adding the hashes together makes the fingerprint order-independent.
+    uint32_t sum = (uint32_t)len;
+    for (flexi_ssize_t i = 0; i < len; i++) {
+        const flexi_value_s *value = writer_peek_idx(writer, len, i);
+        if (value == NULL) {
+            return FLEXI_ERR_BADSTACK;
+        }
+
+        const char *str =
+            keyed ? value->key
+                  : (const char *)writer_data_at(writer, value->u.offset);
+        if (str == NULL) {
+            return FLEXI_ERR_BADWRITE;
+        }
+
+        sum += hash_str(str);
+    }
+
+    *hash = sum;
+    return FLEXI_OK;
+}
+
+/**
+ * @brief Check if a sorted keys vector in the stream contains a key.
+ *
+ * @param[in] writer Writer to operate on.
+ * @param[in] offset Offset of keys vector in the stream.
+ * @param[in] width Width of keys vector.
+ * @param[in] len Length of keys vector.
+ * @param[in] str Key to look for.
+ * @param[out] found True if the key was found.
+ * @return FLEXI_OK || FLEXI_ERR_BADWRITE.
+ */
+static flexi_result_e
+writer_keys_vector_has(flexi_writer_s *writer, flexi_ssize_t offset, int width,
+    flexi_ssize_t len, const char *str, bool *found)
+{
+    *found = false;
+    flexi_ssize_t lo = 0, hi = len;
+    while (lo < hi) {
+        flexi_ssize_t mid = lo + ((hi - lo) / 2);
+        flexi_ssize_t elem = offset + (mid * width);
+        const char *rel_data = (const char *)writer_data_at(writer, elem);
+        if (rel_data == NULL) {
+            return FLEXI_ERR_BADWRITE;
+        }
+
+        uint64_t rel = read_uint_unsafe(rel_data, width);
+        const char *key =
+            (const char *)writer_data_at(writer, elem - (flexi_ssize_t)rel);
+        if (key == NULL) {
+            return FLEXI_ERR_BADWRITE;
+        }
+
+        int cmp = strcmp(key, str);
+        if (cmp == 0) {
+            *found = true;
+            return FLEXI_OK;
+        } else if (cmp < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return FLEXI_OK;
+}
+
+/**
+ * @brief Look for a keys vector which holds the same keys as the top of the
+ *        stack.
+ *
+ * @param[in] writer Writer to operate on.
+ * @param[in] len Number of keys.
+ * @param[in] keyed True if the keys are the map keys of values, false if
+ *                  they are keys that were already written.
+ * @param[in] hash Fingerprint of keys, from writer_keyset_hash.
+ * @param[out] slot Slot holding the keys vector, empty slot to insert it
+ *                  into, or NULL if the pool was searched without finding
+ *                  either.
+ * @param[out] offset Offset of keys vector in the stream, or -1 if it was
+ *                    not found.
+ * @return FLEXI_OK || FLEXI_ERR_BADWRITE.
+ */
+static flexi_result_e
+writer_find_keyset(flexi_writer_s *writer, flexi_ssize_t len, bool keyed,
+    uint32_t hash, flexi_ssize_t **slot, flexi_ssize_t *offset)
+{
+    *offset = -1;
+    for (flexi_ssize_t n = 0; n < writer->keyset_pool.capacity; n++) {
+        *slot = writer_pool_probe(&writer->keyset_pool, hash, n);
+        flexi_ssize_t found = (*slot)[1];
+        if (found == 0) {
+            return FLEXI_OK;
+        } else if ((uint32_t)(*slot)[0] != hash) {
+            continue;
+        }
+
+        int width = (int)(*slot)[2];
+        const char *len_data =
+            (const char *)writer_data_at(writer, found - 1 - width);
+        if (len_data == NULL) {
+            return FLEXI_ERR_BADWRITE;
+        } else if ((flexi_ssize_t)read_uint_unsafe(len_data, width) != len) {
+            continue;
+        }
+
+        bool has = true;
+        for (flexi_ssize_t i = 0; has && i < len; i++) {
+            const flexi_value_s *value = writer_peek_idx(writer, len, i);
+            const char *str =
+                keyed ? value->key
+                      : (const char *)writer_data_at(writer, value->u.offset);
+            if (str == NULL) {
+                return FLEXI_ERR_BADWRITE;
+            }
+
+            flexi_result_e res = writer_keys_vector_has(
+                writer, found - 1, width, len, str, &has);
+            if (FLEXI_ERROR(res)) {
+                return res;
+            }
+        }
+
+        if (has) {
+            *offset = found - 1;
+            return FLEXI_OK;
+        }
+    }
+
+    *slot = NULL;
+    return FLEXI_OK;
+}
+
+/**
+ * @brief Push a keys vector that was written to the stream.
+ *
+ * @param[in] writer Writer to operate on.
+ * @param[in] offset Offset of keys vector in the stream.
+ * @param[in] width Width of keys vector.
+ * @param[out] keyset Stack index of keys vector, can be NULL.
+ * @return FLEXI_OK || FLEXI_ERR_BADSTACK.
+ */
+static flexi_result_e
+writer_push_keys_vector(flexi_writer_s *writer, flexi_ssize_t offset,
+    int width, flexi_stack_idx_t *keyset)
+{
+    if (keyset != NULL) {
+        *keyset = stack_count(&writer->stack);
+    }
+
+    flexi_value_s *stack = stack_push(&writer->stack);
+    if (stack == NULL) {
+        return FLEXI_ERR_BADSTACK;
+    }
+
+    stack->type = FLEXI_TYPE_VECTOR_KEY;
+    stack->u.offset = offset;
+    stack->width = width;
+    stack->key = NULL;
+    return FLEXI_OK;
+}
+
+/**
+ * @brief Look for a string value which was already written to the stream.
+ *
+ * @param[in] writer Writer to operate on.
+ * @param[in] str String to look for.
+ * @param[in] len Length of string.
+ * @param[in] hash Hash of string.
+ * @param[out] slot Slot holding the string, empty slot to insert it into,
+ *                  or NULL if the pool was searched without finding either.
+ * @param[out] offset Offset of string in the stream, or -1 if it was not
+ *                    found.
+ * @return FLEXI_OK || FLEXI_ERR_BADWRITE.
+ */
+static flexi_result_e
+writer_find_string(flexi_writer_s *writer, const char *str, flexi_ssize_t len,
+    uint32_t hash, flexi_ssize_t **slot, flexi_ssize_t *offset)
+{
+    *offset = -1;
+    for (flexi_ssize_t n = 0; n < writer->string_pool.capacity; n++) {
+        *slot = writer_pool_probe(&writer->string_pool, hash, n);
+        flexi_ssize_t found = (*slot)[1];
+        if (found == 0) {
+            return FLEXI_OK;
+        }
+
+        if ((uint32_t)(*slot)[0] == hash && (*slot)[2] == len) {
+            const void *cmp = writer_data_at(writer, found - 1);
+            if (cmp == NULL) {
+                return FLEXI_ERR_BADWRITE;
+            } else if (!memcmp(cmp, str, (size_t)len)) {
+                *offset = found - 1;
+                return FLEXI_OK;
+            }
+        }
+    }
+
+    *slot = NULL;
+    return FLEXI_OK;
+}
+
+/******************************************************************************/
+
+static flexi_result_e
+write_key(flexi_writer_s *writer, const char *key, const char *str)
+{
+    flexi_ssize_t len = strlen(str);
+    flexi_ssize_t offset = -1;
+    flexi_ssize_t *slot = NULL;
+    uint32_t hash = 0;
+    if (writer->key_pool.slots != NULL) {
+        hash = hash_str(str);
+        flexi_result_e res =
+            writer_find_key(writer, str, len, hash, &slot, &offset);
+        if (FLEXI_ERROR(res)) {
+            return res;
+        }
+    }
+
+    if (offset < 0) {
+        // Keep track of string starting position.
+        if (!writer_tell(writer, &offset)) {
+            return FLEXI_ERR_BADWRITE;
+        }
+
+        // Write the string, plus the trailing '\0'.  A dry run keeps every
+        // key, as they are needed for both sorting and pooling.
+        if (!writer_write_kept(writer, str, len + 1)) {
+            return FLEXI_ERR_BADWRITE;
+        }
+
+        if (slot != NULL) {
+            writer_pool_insert(&writer->key_pool, slot, hash, offset, len);
+        }
+    }
+
+    // Push offset to the stack.
+    flexi_value_s *stack = stack_push(&writer->stack);
+    if (!stack) {
+        return FLEXI_ERR_BADSTACK;
+    }
+
+    stack->u.offset = offset;
+    stack->key = OPT_STRDUP(writer, key);
+    stack->type = FLEXI_TYPE_KEY;
+    stack->width = 0;
+    return FLEXI_OK;
+}
+
+/******************************************************************************/
+
+/**
+ * @brief Write the keys at the top of the stack as a keys vector, then
+ *        replace them with the keys vector.
+ *
+ * @param[in] writer Writer to operate on.
+ * @param[in] len Number of keys.
+ * @param[in] stride Minimum width of keys vector.
+ * @param[out] keyset Stack index of keys vector, can be NULL.
+ * @param[in] sorted True if the keys are already sorted.
+ * @param[in,out] slot Empty keyset pool slot to remember the keys vector in,
+ *                     or NULL.
+ * @param[in] hash Fingerprint of keys, if slot is not NULL.
+ * @return FLEXI_OK || FLEXI_ERR_BADWRITE || FLEXI_ERR_BADSTACK.
+ */
+static flexi_result_e
+write_keys_vector(flexi_writer_s *writer, flexi_ssize_t len,
+    flexi_width_e stride, flexi_stack_idx_t *keyset, bool sorted,
+    flexi_ssize_t *slot, uint32_t hash)
+{
+    flexi_ssize_t start = stack_count(&writer->stack) - len;
+    if (start < 0) {
+        return FLEXI_ERR_BADSTACK;
+    }
+
+    // Sort the keys by key name.
+    if (!sorted && !writer_sort_map_keys(writer, len)) {
+        return FLEXI_ERR_BADWRITE;
+    }
+
+    // The stride the developer passed in might not be wide enough to
+    // contain all of the values.  Calculate a minimum stride.
+    int stride_bytes;
+    flexi_result_e res = writer_vector_calc_min_stride(writer, len,
+        FLEXI_WIDTH_TO_BYTES(stride), false, 1, -1, &stride_bytes);
+    if (FLEXI_ERROR(res)) {
+        return res;
+    }
+
+    // The keys start right after the length, so every key offset can be
+    // calculated from a single position.
+    flexi_ssize_t keys_offset;
+    if (!writer_tell(writer, &keys_offset)) {
+        return FLEXI_ERR_BADWRITE;
+    }
+    keys_offset += stride_bytes;
+
+    // A dry run keeps pooled keys vectors to compare against later.
+    writer_stage_s stage;
+    stage_init(&stage, writer);
+    stage.keep = writer->keyset_pool.slots != NULL;
+
+    // Write length
+    if (!stage_uint_by_width(&stage, len, stride_bytes)) {
+        return FLEXI_ERR_BADWRITE;
+    }
+
+    // Keys are written as offsets like any other indirect value.
+    for (flexi_ssize_t i = start; i < stack_count(&writer->stack); i++) {
+        flexi_value_s *value = stack_at(&writer->stack, i);
+        if (value->type != FLEXI_TYPE_KEY) {
+            return FLEXI_ERR_INTERNAL;
+        }
+    }
+    res = write_vector_values(&stage, len, stride_bytes, keys_offset);
+    if (FLEXI_ERROR(res)) {
+        return res;
+    }
+
+    if (!stage_flush(&stage)) {
+        return FLEXI_ERR_BADWRITE;
+    }
+
+    if (slot != NULL) {
+        writer_pool_insert(
+            &writer->keyset_pool, slot, hash, keys_offset, stride_bytes);
+    }
+
+    bool ok = writer_pop(writer, len);
+    if (!ok) {
+        return FLEXI_ERR_BADSTACK;
+    }
+
+    return writer_push_keys_vector(writer, keys_offset, stride_bytes, keyset);
+}
+
+/******************************************************************************/
+
+static flexi_result_e
+write_map_keys(flexi_writer_s *writer, flexi_ssize_t len, flexi_width_e stride,
+    flexi_stack_idx_t *keyset)
+{
+    // Find the start of the keys on the stack.
+    flexi_ssize_t start = stack_count(&writer->stack) - len;
+    if (start < 0) {
+        return FLEXI_ERR_BADSTACK;
+    }
+
+    // All keys must be of key type.  Avoids redundant checks later.
+    for (flexi_ssize_t i = start; i < stack_count(&writer->stack); i++) {
+        flexi_value_s *value = stack_at(&writer->stack, i);
+        if (value->type != FLEXI_TYPE_KEY) {
+            return FLEXI_ERR_NOTKEYS;
+        }
+    }
+
+    // Reuse an identical keys vector if one was already written.
+    flexi_ssize_t *slot = NULL;
+    uint32_t hash = 0;
+    if (writer->keyset_pool.slots != NULL) {
+        flexi_result_e res = writer_keyset_hash(writer, len, false, &hash);
+        if (FLEXI_ERROR(res)) {
+            return res;
+        }
+
+        flexi_ssize_t found;
+        res = writer_find_keyset(writer, len, false, hash, &slot, &found);
+        if (FLEXI_ERROR(res)) {
+            return res;
+        } else if (found >= 0) {
+            if (!writer_pop(writer, len)) {
+                return FLEXI_ERR_BADSTACK;
+            }
+            return writer_push_keys_vector(writer, found, (int)slot[2], keyset);
+        }
+    }
+
+    return write_keys_vector(writer, len, stride, keyset, false, slot, hash);
+}
+
+/******************************************************************************/
+
+static flexi_result_e
+write_map_values(flexi_writer_s *writer, const char *key,
+    flexi_stack_idx_t keyset, flexi_ssize_t len, flexi_width_e stride,
+    bool sorted)
+{
+    // First seek out the keys.
+    flexi_value_s *keys_value = writer_peek_tail(writer, keyset);
+    if (keys_value == NULL || keys_value->type != FLEXI_TYPE_VECTOR_KEY) {
+        return FLEXI_ERR_BADTYPE;
+    }
+
+    // Sort the values based on their keys.
+    if (!sorted && !writer_sort_map_values(writer, len)) {
+        return FLEXI_ERR_INTERNAL;
+    }
+
+    // The stride the developer passed in might not be wide enough to
+    // contain all of the values, or the offset to a shared keys vector
+    // that is far behind them.  Calculate a minimum stride.
+    int stride_bytes;
+    flexi_result_e res = writer_vector_calc_min_stride(writer, len,
+        FLEXI_WIDTH_TO_BYTES(stride), true, 3, keys_value->u.offset,
+        &stride_bytes);
+    if (FLEXI_ERROR(res)) {
+        return res;
+    }
+
+    // Offset to aligned keys vector.
+    flexi_ssize_t current;
+    if (!write_padding(writer, 0, stride_bytes, &current)) {
+        return FLEXI_ERR_BADWRITE;
+    }
+
+    writer_stage_s stage;
+    stage_init(&stage, writer);
+
+    flexi_ssize_t offset = current - keys_value->u.offset;
+    if (!stage_uint_by_width(&stage, offset, stride_bytes)) {
+        return FLEXI_ERR_BADWRITE;
+    }
+
+    // Byte width of key vector.
+    if (!stage_sint_by_width(&stage, keys_value->width, stride_bytes)) {
+        return FLEXI_ERR_BADWRITE;
+    }
+
+    // Now we're to the values - write length.
+    if (!stage_uint_by_width(&stage, len, stride_bytes)) {
+        return FLEXI_ERR_BADWRITE;
+    }
+
+    // The values follow the keys offset, keys width and length.
+    flexi_ssize_t values_offset = current + (flexi_ssize_t)stride_bytes * 3;
+
+    // Write values.
+    res = write_vector_values(&stage, len, stride_bytes, values_offset);
+    if (FLEXI_ERROR(res)) {
+        return res;
+    }
+
+    // Write types.
+    if (!write_vector_types(&stage, len)) {
+        return FLEXI_ERR_BADWRITE;
+    }
+
+    if (!stage_flush(&stage)) {
+        return FLEXI_ERR_BADWRITE;
+    }
+
+    // Pop the values.
+    bool ok = writer_pop(writer, len);
+    if (!ok) {
+        return FLEXI_ERR_BADSTACK;
+    }
+
+    // Push the completed map.
+    flexi_value_s *stack = stack_push(&writer->stack);
+    if (stack == NULL) {
+        return FLEXI_ERR_BADSTACK;
+    }
+
+    stack->u.offset = values_offset;
+    stack->key = OPT_STRDUP(writer, key);
+    stack->type = FLEXI_TYPE_MAP;
+    stack->width = stride_bytes;
+    return FLEXI_OK;
+}
+
+/******************************************************************************/
+
+flexi_span_s
+flexi_make_span(const void *data, flexi_ssize_t len)
+{
+    flexi_span_s rvo;
+    rvo.data = (const char *)data;
+    rvo.length = len;
+    return rvo;
+}
+
+/******************************************************************************/
+
+flexi_result_e
+flexi_open_span(const flexi_span_s *msg, flexi_cursor_s *cursor)
+{
+    if (msg->length < 3) {
+        // Shortest length we can discard without checking.
+        cursor_set_error(cursor);
+        return FLEXI_ERR_BADREAD;
+    }
+
+    // Width of root object.
+    cursor->msg = *msg;
+    cursor->trusted = false;
+    cursor->keys = NULL;
+    cursor->keys_width = 0;
+    cursor->cursor = span_end(msg) - 1;
+    uint8_t root_bytes = *(const uint8_t *)(cursor->cursor);
+    if (root_bytes == 0 || (size_t)msg->length < root_bytes + 2u) {
+        cursor_set_error(cursor);
+        return FLEXI_ERR_BADREAD;
+    }
+
+    // Obtain the packed type.
+    cursor->cursor -= 1;
+    flexi_packed_t packed = *(const uint8_t *)(cursor->cursor);
+
+    // Point at the root object.
+    flexi_type_e type = FLEXI_UNPACK_TYPE(packed);
+    cursor->cursor -= root_bytes;
+
+    // Check the width before going any further.
+    if (!type_has_valid_width(type, root_bytes)) {
+        return FLEXI_ERR_BADREAD;
+    }
+
+    if (type_is_direct(type)) {
+        // No need to resolve an offset, we're done.
+        cursor->type = type;
+        cursor->width = root_bytes;
+        return FLEXI_OK;
+    }
+
+    // We're pointing at an offset, resolve it.
+    flexi_ssize_t offset = 0;
+    if (!read_size_unsafe(cursor->cursor, root_bytes, &offset)) {
+        cursor_set_error(cursor);
+        return FLEXI_ERR_BADREAD;
+    }
+
+    const char *dest = NULL;
+    if (!span_seek_back(&cursor->msg, cursor->cursor, offset, &dest)) {
+        cursor_set_error(cursor);
+        return FLEXI_ERR_BADREAD;
+    }
+
+    if (!cursor_set_checked(cursor, cursor, dest, type,
+            UNPACK_WIDTH_TO_BYTES(packed))) {
+        cursor_set_error(cursor);
+        return FLEXI_ERR_BADREAD;
+    }
+
+    return FLEXI_OK;
+}
+
+/******************************************************************************/
+
+flexi_result_e
+flexi_validate_span(const flexi_span_s *msg, flexi_cursor_s *cursor)
+{
+    flexi_result_e res = flexi_open_span(msg, cursor);
+    if (res != FLEXI_OK) {
+        cursor_set_error(cursor);
+        return res;
+    }
+
+    parse_limits_s limits = {0, 0};
+    res = cursor_validate(cursor, &limits);
+    if (res != FLEXI_OK) {
+        cursor_set_error(cursor);
+        return res;
+    }
+
+    cursor->trusted = true;
+    return FLEXI_OK;
+}
+
+/******************************************************************************/
+
+flexi_type_e
+flexi_cursor_type(const flexi_cursor_s *cursor)
+{
+    return cursor->type;
+}
+
+/******************************************************************************/
+
+int
+flexi_cursor_width(const flexi_cursor_s *cursor)
+{
+    return cursor->width;
+}
+
+/******************************************************************************/
+
+flexi_ssize_t
+flexi_cursor_length(const flexi_cursor_s *cursor)
+{
+    if (cursor->type == FLEXI_TYPE_KEY) {
+        return strlen(cursor->cursor);
+    } else {
+        return cursor->length;
+    }
+}
+
+/******************************************************************************/
+
+flexi_result_e
+flexi_cursor_sint(const flexi_cursor_s *cursor, int64_t *val)
+{
+    if (cursor_is_error(cursor)) {
+        *val = 0;
+        return FLEXI_ERR_FAILSAFE;
+    }
+
+    if (type_is_sint(cursor->type)) {
+        int64_t v;
+        if (!span_read_sint(&cursor->msg, cursor->cursor, cursor->width, &v)) {
+            *val = 0;
+            return FLEXI_ERR_BADREAD;
+        }
+
+        *val = v;
+        return FLEXI_OK;
+    } else if (type_is_uint(cursor->type)) {
+        uint64_t v;
+        if (!span_read_uint(&cursor->msg, cursor->cursor, cursor->width, &v)) {
+            *val = 0;
+            return FLEXI_ERR_BADREAD;
+        }
+        if (v > INT64_MAX) {
+            *val = INT64_MAX;
+            return FLEXI_ERR_RANGE;
+        }
+
+        *val = (int64_t)v;
+        return FLEXI_OK;
+    } else if (type_is_flt(cursor->type) && cursor->width == 4) {
+        float v;
+        if (!span_read_f32(&cursor->msg, cursor->cursor, cursor->width, &v)) {
+            *val = 0;
+            return FLEXI_ERR_BADREAD;
+        }
+        if (v > (float)INT64_MAX) {
+            *val = INT64_MAX;
+            return FLEXI_ERR_RANGE;
+        }
+        if (v < (float)INT64_MIN) {
+            *val = INT64_MIN;
+            return FLEXI_ERR_RANGE;
+        }
+
+        *val = (int64_t)v;
+        return FLEXI_OK;
+    } else if (type_is_flt(cursor->type) && cursor->width == 8) {
+        double v;
+        if (!span_read_f64(&cursor->msg, cursor->cursor, cursor->width, &v)) {
+            *val = 0;
+            return FLEXI_ERR_BADREAD;
+        }
+        if (v > (double)INT64_MAX) {
+            *val = INT64_MAX;
+            return FLEXI_ERR_RANGE;
+        }
+        if (v < (double)INT64_MIN) {
+            *val = INT64_MIN;
+            return FLEXI_ERR_RANGE;
+        }
+
+        *val = (int64_t)v;
+        return FLEXI_OK;
+    } else if (cursor->type == FLEXI_TYPE_BOOL && cursor->width == 1) {
+        *val = *(const bool *)(cursor->cursor);
+        return FLEXI_OK;
+    }
+
+    *val = 0;
+    return FLEXI_ERR_BADTYPE;
+}
+
+/******************************************************************************/
+
+flexi_result_e
+flexi_cursor_uint(const flexi_cursor_s *cursor, uint64_t *val)
+{
+    if (cursor_is_error(cursor)) {
+        *val = 0;
+        return FLEXI_ERR_FAILSAFE;
+    }
+
+    if (type_is_sint(cursor->type)) {
+        int64_t v;
+        if (!span_read_sint(&cursor->msg, cursor->cursor, cursor->width, &v)) {
+            *val = 0;
+            return FLEXI_ERR_BADREAD;
+        }
+        if (v < 0) {
+            *val = 0;
+            return FLEXI_ERR_RANGE;
+        }
+
+        *val = (uint64_t)v;
+        return FLEXI_OK;
+    } else if (type_is_uint(cursor->type)) {
+        uint64_t v;
+        if (!span_read_uint(&cursor->msg, cursor->cursor, cursor->width, &v)) {
+            *val = 0;
+            return FLEXI_ERR_BADREAD;
+        }
+
+        *val = v;
+        return FLEXI_OK;
+    } else if (type_is_flt(cursor->type) && cursor->width == 4) {
+        float v;
+        if (!span_read_f32(&cursor->msg, cursor->cursor, cursor->width, &v)) {
+            *val = 0;
+            return FLEXI_ERR_BADREAD;
+        }
+
+        *val = (uint64_t)v;
+        return FLEXI_OK;
+    } else if (type_is_flt(cursor->type) && cursor->width == 8) {
+        double v;
+        if (!span_read_f64(&cursor->msg, cursor->cursor, cursor->width, &v)) {
+            *val = 0;
+            return FLEXI_ERR_BADREAD;
+        }
+
+        *val = (uint64_t)v;
+        return FLEXI_OK;
+    } else if (cursor->type == FLEXI_TYPE_BOOL && cursor->width == 1) {
+        *val = *(const bool *)(cursor->cursor);
+        return FLEXI_OK;
+    }
+
+    *val = 0;
+    return FLEXI_ERR_BADTYPE;
+}
+
+/******************************************************************************/
+
+flexi_result_e
+flexi_cursor_f32(const flexi_cursor_s *cursor, float *val)
+{
+    if (cursor_is_error(cursor)) {
+        *val = 0.0f;
+        return FLEXI_ERR_FAILSAFE;
+    }
+
+    if (type_is_sint(cursor->type)) {
+        int64_t v;
+        if (!span_read_sint(&cursor->msg, cursor->cursor, cursor->width, &v)) {
+            *val = 0.0f;
+            return FLEXI_ERR_BADREAD;
+        }
+
+        *val = (float)v;
+        return FLEXI_OK;
+    } else if (type_is_uint(cursor->type)) {
+        uint64_t v;
+        if (!span_read_uint(&cursor->msg, cursor->cursor, cursor->width, &v)) {
+            *val = 0.0f;
+            return FLEXI_ERR_BADREAD;
+        }
+
+        *val = (float)v;
+        return FLEXI_OK;
+    } else if (type_is_flt(cursor->type) && cursor->width == 4) {
+        float v;
+        if (!span_read_f32(&cursor->msg, cursor->cursor, cursor->width, &v)) {
+            *val = 0.0f;
+            return FLEXI_ERR_BADREAD;
+        }
+
+        *val = v;
+        return FLEXI_OK;
+    } else if (type_is_flt(cursor->type) && cursor->width == 8) {
+        double v;
+        if (!span_read_f64(&cursor->msg, cursor->cursor, cursor->width, &v)) {
+            *val = 0.0f;
+            return FLEXI_ERR_BADREAD;
+        }
+
+        *val = (float)v;
+        return FLEXI_OK;
+    } else if (cursor->type == FLEXI_TYPE_BOOL && cursor->width == 1) {
+        *val = (float)*(const bool *)(cursor->cursor);
+        return FLEXI_OK;
+    }
+
+    *val = 0.0f;
+    return FLEXI_ERR_BADTYPE;
+}
+
+/******************************************************************************/
+
+flexi_result_e
+flexi_cursor_f64(const flexi_cursor_s *cursor, double *val)
+{
+    if (cursor_is_error(cursor)) {
+        *val = 0.0;
+        return FLEXI_ERR_FAILSAFE;
+    }
+
+    if (type_is_sint(cursor->type)) {
+        int64_t v;
+        if (!span_read_sint(&cursor->msg, cursor->cursor, cursor->width, &v)) {
+            *val = 0.0;
+            return FLEXI_ERR_BADREAD;
+        }
+
+        *val = (double)v;
+        return FLEXI_OK;
+    } else if (type_is_uint(cursor->type)) {
+        uint64_t v;
+        if (!span_read_uint(&cursor->msg, cursor->cursor, cursor->width, &v)) {
+            *val = 0.0;
+            return FLEXI_ERR_BADREAD;
+        }
+
+        *val = (double)v;
+        return FLEXI_OK;
+    } else if (type_is_flt(cursor->type) && cursor->width == 4) {
+        float v;
+        if (!span_read_f32(&cursor->msg, cursor->cursor, cursor->width, &v)) {
+            *val = 0.0;
+            return FLEXI_ERR_BADREAD;
+        }
+
+        *val = v;
+        return FLEXI_OK;
+    } else if (type_is_flt(cursor->type) && cursor->width == 8) {
+        double v;
+        if (!span_read_f64(&cursor->msg, cursor->cursor, cursor->width, &v)) {
+            *val = 0.0;
+            return FLEXI_ERR_BADREAD;
+        }
+
+        *val = v;
+        return FLEXI_OK;
+    } else if (cursor->type == FLEXI_TYPE_BOOL && cursor->width == 1) {
+        *val = (double)*(const bool *)(cursor->cursor);
+        return FLEXI_OK;
+    }
+
+    *val = 0.0;
+    return FLEXI_ERR_BADTYPE;
+}
+
+/******************************************************************************/
+
+flexi_result_e
+flexi_cursor_key(const flexi_cursor_s *cursor, const char **str)
+{
+    if (cursor_is_error(cursor)) {
+        *str = "";
+        return FLEXI_ERR_FAILSAFE;
+    }
+
+    switch (cursor->type) {
+    case FLEXI_TYPE_KEY: break;
+    case FLEXI_TYPE_STRING: break;
+    default: *str = ""; return FLEXI_ERR_BADTYPE;
+    }
+
+    *str = cursor->cursor;
+    return FLEXI_OK;
+}
+
+/******************************************************************************/
+
+flexi_result_e
+flexi_cursor_string(const flexi_cursor_s *cursor, const char **str,
+    flexi_ssize_t *len)
+{
+    if (cursor_is_error(cursor)) {
+        *str = "";
+        *len = 0;
+        return FLEXI_ERR_FAILSAFE;
+    }
+
+    switch (cursor->type) {
+    case FLEXI_TYPE_KEY: {
+        *str = cursor->cursor;
+        *len = strlen(cursor->cursor);
+        return FLEXI_OK;
+    }
+    case FLEXI_TYPE_STRING: {
+        *str = cursor->cursor;
+        *len = cursor->length;
+        return FLEXI_OK;
+    }
+    default: {
+        *str = "";
+        *len = 0;
+        return FLEXI_ERR_BADTYPE;
+    }
+    }
+}
+
+/******************************************************************************/
+
+flexi_result_e
+flexi_cursor_map_key_at_index(const flexi_cursor_s *cursor, flexi_ssize_t index,
+    const char **str)
+{
+    if (cursor_is_error(cursor)) {
+        *str = "";
+        return FLEXI_ERR_FAILSAFE;
+    }
+
+    if (cursor->type != FLEXI_TYPE_MAP || index < 0 ||
+        index >= cursor->length) {
+        *str = "";
+        return FLEXI_ERR_BADTYPE;
+    }
+
+    flexi_cursor_s keys;
+    cursor_map_keys(cursor, &keys);
+
+    if (!cursor_map_key_at_index(cursor, &keys, index, str)) {
+        *str = "";
+        return FLEXI_ERR_INTERNAL;
+    }
+
+    return FLEXI_OK;
+}
+
+/******************************************************************************/
+
+flexi_result_e
+flexi_cursor_seek_map_key(const flexi_cursor_s *cursor, const char *key,
+    flexi_cursor_s *dest)
+{
+    if (cursor_is_error(cursor)) {
+        cursor_set_error(dest);
+        return FLEXI_ERR_FAILSAFE;
+    }
+
+    if (cursor->type != FLEXI_TYPE_MAP) {
+        cursor_set_error(dest);
+        return FLEXI_ERR_BADTYPE;
+    }
+
+    return cursor_seek_map_key(cursor, key, (flexi_ssize_t)strlen(key), dest);
+}
+
+/******************************************************************************/
+
+flexi_seek_cache_s
+flexi_make_seek_cache(void)
+{
+    flexi_seek_cache_s rvo;
+    rvo.index = -1;
+    rvo.length = -1;
+    rvo.hits = 0;
+    rvo.misses = 0;
+    return rvo;
+}
+
+/******************************************************************************/
+
+flexi_result_e
+flexi_cursor_seek_map_key_cached(const flexi_cursor_s *cursor,
+    const char *key, flexi_seek_cache_s *cache, flexi_cursor_s *dest)
+{
+    if (cursor_is_error(cursor)) {
+        cursor_set_error(dest);
+        return FLEXI_ERR_FAILSAFE;
+    }
+
+    if (cursor->type != FLEXI_TYPE_MAP) {
+        cursor_set_error(dest);
+        return FLEXI_ERR_BADTYPE;
+    }
+
+    flexi_cursor_s keys;
+    cursor_map_keys(cursor, &keys);
+
+    flexi_ssize_t key_len = (flexi_ssize_t)strlen(key);
+    if (cache->length == cursor->length && cache->index >= 0 &&
+        cache->index < cursor->length) {
+        // Same shape as last time, so check the remembered slot first.
+        const char *cmp = NULL;
+        if (!cursor_map_key_at_index(cursor, &keys, cache->index, &cmp)) {
+            cursor_set_error(dest);
+            return FLEXI_ERR_BADREAD;
+        }
+
+        if (!key_cmp(cmp, key, key_len)) {
+            cache->hits += 1;
+            if (!cursor_seek_untyped_vector_index(cursor, cache->index,
+                    dest)) {
+                cursor_set_error(dest);
+                return FLEXI_ERR_BADREAD;
+            }
+            return FLEXI_OK;
+        }
+    }
+
+    cache->misses += 1;
+
+    flexi_ssize_t index = 0;
+    flexi_result_e res = cursor_find_map_key(cursor, &keys, key, key_len,
+        &index);
+    if (res != FLEXI_OK) {
+        cursor_set_error(dest);
+        return res;
+    }
+
+    cache->index = index;
+    cache->length = cursor->length;
+    if (!cursor_seek_untyped_vector_index(cursor, index, dest)) {
+        cursor_set_error(dest);
+        return FLEXI_ERR_BADREAD;
+    }
+    return FLEXI_OK;
+}
+
+/******************************************************************************/
+
+flexi_result_e
+flexi_cursor_seek_map_keys(const flexi_cursor_s *cursor,
+    const char *const *keys, flexi_ssize_t count, flexi_cursor_s *dests)
+{
+    flexi_ssize_t i;
+    if (cursor_is_error(cursor)) {
+        for (i = 0; i < count; i++) {
+            cursor_set_error(&dests[i]);
+        }
+        return FLEXI_ERR_FAILSAFE;
+    }
+
+    if (cursor->type != FLEXI_TYPE_MAP) {
+        for (i = 0; i < count; i++) {
+            cursor_set_error(&dests[i]);
+        }
+        return FLEXI_ERR_BADTYPE;
+    }
+
+    flexi_cursor_s map_keys;
+    cursor_map_keys(cursor, &map_keys);
+
+    flexi_result_e res = FLEXI_OK;
+    flexi_ssize_t pos = 0;
+    for (i = 0; i < count && res != FLEXI_ERR_BADREAD; i++) {
+        if (i > 0 && pos > 0 && strcmp(keys[i], keys[i - 1]) < 0) {
+            // Wanted keys went backwards, find where the merge resumes.
+            flexi_ssize_t left = 0;
+            flexi_ssize_t right = pos;
+            while (left < right) {
+                flexi_ssize_t mid = left + ((right - left) / 2);
+                const char *cmp = NULL;
+                if (!cursor_map_key_at_index(cursor, &map_keys, mid, &cmp)) {
+                    res = FLEXI_ERR_BADREAD;
+                    break;
+                }
+
+                if (strcmp(cmp, keys[i]) < 0) {
+                    left = mid + 1;
+                } else {
+                    right = mid;
+                }
+            }
+            pos = left;
+        }
+
+        // Merge forward until we reach or pass the wanted key.
+        int cmp_res = 1;
+        for (; pos < cursor->length && res != FLEXI_ERR_BADREAD; pos++) {
+            const char *cmp = NULL;
+            if (!cursor_map_key_at_index(cursor, &map_keys, pos, &cmp)) {
+                res = FLEXI_ERR_BADREAD;
+                break;
+            }
+
+            cmp_res = strcmp(cmp, keys[i]);
+            if (cmp_res >= 0) {
+                break;
+            }
+        }
+
+        if (res == FLEXI_ERR_BADREAD) {
+            cursor_set_error(&dests[i]);
+        } else if (cmp_res != 0) {
+            cursor_set_error(&dests[i]);
+            res = FLEXI_ERR_NOTFOUND;
+        } else if (!cursor_seek_untyped_vector_index(cursor, pos, &dests[i])) {
+            cursor_set_error(&dests[i]);
+            res = FLEXI_ERR_BADREAD;
+        }
+    }
+
+    for (; i < count; i++) {
+        // Corrupt keys mean the remaining keys can't be trusted.
+        cursor_set_error(&dests[i]);
+    }
+
+    return res;
+}
+
+/******************************************************************************/
+
+flexi_ssize_t
+flexi_map_index_size(flexi_ssize_t len)
+{
+    // Capacity can reach four times the length, and each slot is 8 bytes.
+    if (len < 0 || len > FLEXI_SSIZE_MAX / 32) {
+        return 0;
+    }
+
+    // Size for a load factor of 50%, which leaves headroom under the 75%
+    // that flexi_build_map_index requires.
+    flexi_ssize_t capacity = 2;
+    while (capacity < len * 2) {
+        capacity *= 2;
+    }
+    return capacity * (flexi_ssize_t)sizeof(uint32_t) * 2;
+}
+
+/******************************************************************************/
+
+flexi_result_e
+flexi_build_map_index(const flexi_cursor_s *cursor, void *buffer,
+    flexi_ssize_t len, flexi_map_index_s *index)
+{
+    index->map = NULL;
+    index->slots = NULL;
+    index->capacity = 0;
+
+    if (cursor_is_error(cursor)) {
+        return FLEXI_ERR_FAILSAFE;
+    }
+
+    if (cursor->type != FLEXI_TYPE_MAP) {
+        return FLEXI_ERR_BADTYPE;
+    }
+
+    // Each slot is a pair of hash and index + 1, where 0 is empty.
+    flexi_ssize_t max_slots = len / (flexi_ssize_t)(sizeof(uint32_t) * 2);
+    flexi_ssize_t capacity = 1;
+    while (capacity * 2 <= max_slots) {
+        capacity *= 2;
+    }
+    if (buffer == NULL || capacity > max_slots ||
+        cursor->length >= capacity ||
+        cursor->length > capacity - (capacity / 4)) {
+        // Not enough room to keep the load factor under 75%.
+        return FLEXI_ERR_PARAM;
+    }
 
-            flexi_ssize_t j = i;
-            for (; j >= gap; j -= gap) {
-                flexi_value_s *seek =
-                    writer_get_stack_key(writer, start, j - gap);
-                const char *seekkey = (const char *)ostream_data_at(
-                    &writer->ostream, seek->u.offset);
+    cursor_map_keys(cursor, &index->keys);
 
-                int cmp = strcmp(seekkey, curkey);
-                if (cmp <= 0) {
-                    break;
-                }
+    uint32_t *slots = (uint32_t *)buffer;
+    memset(slots, 0, (size_t)capacity * sizeof(uint32_t) * 2);
 
-                flexi_value_s *dest = writer_get_stack_key(writer, start, j);
-                dest->u.offset = seek->u.offset;
-            }
+    flexi_ssize_t mask = capacity - 1;
+    for (flexi_ssize_t i = 0; i < cursor->length; i++) {
+        const char *key = NULL;
+        if (!cursor_map_key_at_index(cursor, &index->keys, i, &key)) {
+            return FLEXI_ERR_BADREAD;
+        }
 
-            flexi_value_s *dest = writer_get_stack_key(writer, start, j);
-            dest->u.offset = curoff;
+        uint32_t hash = hash_str(key);
+        flexi_ssize_t slot = (flexi_ssize_t)hash & mask;
+        while (slots[slot * 2 + 1] != 0) {
+            slot = (slot + 1) & mask;
         }
+
+        slots[slot * 2] = hash;
+        slots[slot * 2 + 1] = (uint32_t)(i + 1);
     }
 
-    return true;
+    index->map = cursor->cursor;
+    index->slots = slots;
+    index->capacity = capacity;
+    return FLEXI_OK;
 }
 
 /******************************************************************************/
 
-static flexi_result_e
-write_key(flexi_writer_s *writer, const char *key, const char *str)
+flexi_result_e
+flexi_cursor_seek_map_key_indexed(const flexi_cursor_s *cursor,
+    const flexi_map_index_s *index, const char *key, flexi_cursor_s *dest)
 {
-    // Keep track of string starting position.
-    flexi_ssize_t offset;
-    if (!ostream_tell(&writer->ostream, &offset)) {
-        return FLEXI_ERR_BADWRITE;
+    if (cursor_is_error(cursor)) {
+        cursor_set_error(dest);
+        return FLEXI_ERR_FAILSAFE;
     }
 
-    // Write the string, plus the trailing '\0'.
-    flexi_ssize_t len = strlen(str);
-    if (!ostream_write(&writer->ostream, str, len + 1)) {
-        return FLEXI_ERR_BADWRITE;
+    if (cursor->type != FLEXI_TYPE_MAP) {
+        cursor_set_error(dest);
+        return FLEXI_ERR_BADTYPE;
     }
 
-    // Push offset to the stack.
-    flexi_value_s *stack = stack_push(&writer->stack);
-    if (!stack) {
-        return FLEXI_ERR_BADSTACK;
+    if (index->map != cursor->cursor ||
+        index->keys.msg.data != cursor->msg.data) {
+        // Index was built for some other map.
+        cursor_set_error(dest);
+        return FLEXI_ERR_PARAM;
     }
 
-    stack->u.offset = offset;
-    stack->key = OPT_STRDUP(writer, key);
-    stack->type = FLEXI_TYPE_KEY;
-    stack->width = 0;
-    return FLEXI_OK;
+    uint32_t hash = hash_str(key);
+    flexi_ssize_t mask = index->capacity - 1;
+    flexi_ssize_t slot = (flexi_ssize_t)hash & mask;
+    for (;;) {
+        uint32_t found = index->slots[slot * 2 + 1];
+        if (found == 0) {
+            break;
+        }
+
+        if (index->slots[slot * 2] == hash) {
+            const char *cmp = NULL;
+            if (!cursor_map_key_at_index(cursor, &index->keys, found - 1,
+                    &cmp)) {
+                cursor_set_error(dest);
+                return FLEXI_ERR_BADREAD;
+            }
+
+            if (!strcmp(cmp, key)) {
+                if (!cursor_seek_untyped_vector_index(cursor, found - 1,
+                        dest)) {
+                    cursor_set_error(dest);
+                    return FLEXI_ERR_BADREAD;
+                }
+                return FLEXI_OK;
+            }
+        }
+
+        slot = (slot + 1) & mask;
+    }
+
+    cursor_set_error(dest);
+    return FLEXI_ERR_NOTFOUND;
 }
 
 /******************************************************************************/
 
-static flexi_result_e
-write_map_keys(flexi_writer_s *writer, flexi_ssize_t len, flexi_width_e stride,
-    flexi_stack_idx_t *keyset)
+flexi_result_e
+flexi_cursor_vector_types(const flexi_cursor_s *cursor,
+    const flexi_packed_t **packed)
 {
-    // Find the start of the keys on the stack.
-    flexi_ssize_t start = stack_count(&writer->stack) - len;
-    if (start < 0) {
-        return FLEXI_ERR_BADSTACK;
+    if (cursor_is_error(cursor)) {
+        *packed = &g_empty_packed;
+        return FLEXI_ERR_FAILSAFE;
     }
 
-    // All keys must be of key type.  Avoids redundant checks later.
-    for (flexi_ssize_t i = start; i < stack_count(&writer->stack); i++) {
-        flexi_value_s *value = stack_at(&writer->stack, i);
-        if (value->type != FLEXI_TYPE_KEY) {
-            return FLEXI_ERR_NOTKEYS;
-        }
+    if (cursor->type != FLEXI_TYPE_VECTOR && cursor->type != FLEXI_TYPE_MAP) {
+        *packed = &g_empty_packed;
+        return FLEXI_ERR_BADTYPE;
     }
 
-    // Sort the keys by key name.
-    writer_sort_map_keys(writer, len);
-
-    // The stride the developer passed in might not be wide enough to
-    // contain all of the values.  Calculate a minimum stride.
-    int min_stride_bytes;
-    flexi_result_e res =
-        writer_vector_calc_min_stride(writer, len, &min_stride_bytes);
-    if (FLEXI_ERROR(res)) {
-        return res;
-    }
+    *packed = cursor_vector_types(cursor);
+    return FLEXI_OK;
+}
 
-    // Take the larger of our calculation vs. parameter.
-    int stride_bytes = FLEXI_WIDTH_TO_BYTES(stride);
-    stride_bytes = MAX(stride_bytes, min_stride_bytes);
+/******************************************************************************/
 
-    // Write length
-    if (!write_uint_by_width(writer, len, stride_bytes)) {
-        return FLEXI_ERR_BADWRITE;
+flexi_result_e
+flexi_cursor_seek_vector_index(const flexi_cursor_s *cursor,
+    flexi_ssize_t index, flexi_cursor_s *dest)
+{
+    if (cursor_is_error(cursor)) {
+        cursor_set_error(dest);
+        return FLEXI_ERR_FAILSAFE;
     }
 
-    // Keep track of the base location of the keys.
-    flexi_ssize_t keys_offset;
-    if (!ostream_tell(&writer->ostream, &keys_offset)) {
-        return FLEXI_ERR_BADWRITE;
-    }
+    if (type_is_map_or_untyped_vector(cursor->type)) {
+        if (index < 0 || index >= cursor->length) {
+            // Index is out of range.
+            cursor_set_error(dest);
+            return FLEXI_ERR_FAILSAFE;
+        }
 
-    // Write out key offsets.
-    for (flexi_ssize_t i = start; i < stack_count(&writer->stack); i++) {
-        flexi_value_s *value = stack_at(&writer->stack, i);
-        if (value->type != FLEXI_TYPE_KEY) {
+        // Untyped vectors and maps can be seeked.
+        if (!cursor_seek_untyped_vector_index(cursor, index, dest)) {
+            cursor_set_error(dest);
             return FLEXI_ERR_INTERNAL;
         }
 
-        // TODO: We can pre-calculate this.
-        flexi_ssize_t current;
-        if (!ostream_tell(&writer->ostream, &current)) {
-            return FLEXI_ERR_BADWRITE;
+        return FLEXI_OK;
+    } else if (type_is_typed_vector(cursor->type)) {
+        if (index < 0 || index >= cursor->length) {
+            // Index is out of range.
+            cursor_set_error(dest);
+            return FLEXI_ERR_FAILSAFE;
         }
 
-        flexi_ssize_t offset = current - value->u.offset;
-        if (!write_uint_by_width(writer, offset, stride_bytes)) {
-            return FLEXI_ERR_BADWRITE;
+        // Typed vectors can still be seeked.  It's slower than direct
+        // access, but it should still work.
+        if (!cursor_seek_typed_vector_index(cursor, index, dest)) {
+            cursor_set_error(dest);
+            return FLEXI_ERR_INTERNAL;
         }
-    }
-
-    bool ok = writer_pop(writer, len);
-    if (!ok) {
-        return FLEXI_ERR_BADSTACK;
-    }
 
-    if (keyset != NULL) {
-        *keyset = stack_count(&writer->stack);
-    }
-
-    flexi_value_s *stack = stack_push(&writer->stack);
-    if (stack == NULL) {
-        return FLEXI_ERR_BADSTACK;
+        return FLEXI_OK;
     }
 
-    stack->type = FLEXI_TYPE_VECTOR_KEY;
-    stack->u.offset = keys_offset;
-    stack->width = stride_bytes;
-    stack->key = NULL;
-    return FLEXI_OK;
+    cursor_set_error(dest);
+    return FLEXI_ERR_BADTYPE;
 }
 
 /******************************************************************************/
 
-static flexi_result_e
-write_map_values(flexi_writer_s *writer, const char *key,
-    flexi_stack_idx_t keyset, flexi_ssize_t len, flexi_width_e stride)
+flexi_result_e
+flexi_compile_path(const char *str, flexi_path_step_s *steps,
+    flexi_ssize_t steps_len, flexi_path_s *path)
 {
-    // First seek out the keys.
-    flexi_value_s *keys_value = writer_peek_tail(writer, keyset);
-    if (keys_value == NULL || keys_value->type != FLEXI_TYPE_VECTOR_KEY) {
-        return FLEXI_ERR_BADTYPE;
-    }
+    path->steps = steps;
+    path->count = 0;
 
-    // Sort the values based on their keys.
-    if (!writer_sort_map_values(writer, len)) {
-        return FLEXI_ERR_INTERNAL;
+    if (*str == '\0') {
+        // Empty path refers to the cursor itself.
+        return FLEXI_OK;
+    } else if (*str != '/') {
+        // Paths must be absolute.
+        return FLEXI_ERR_PARAM;
     }
 
-    // The stride the developer passed in might not be wide enough to
-    // contain all of the values.  Calculate a minimum stride.
-    int min_stride_bytes;
-    flexi_result_e res =
-        writer_vector_calc_min_stride(writer, len, &min_stride_bytes);
-    if (FLEXI_ERROR(res)) {
-        return res;
-    }
+    flexi_ssize_t count = 0;
+    while (*str == '/') {
+        const char *seg = str + 1;
+        const char *end = seg;
+        while (*end != '\0' && *end != '/') {
+            end += 1;
+        }
 
-    // Take the larger of our calculation vs. parameter.
-    int stride_bytes = FLEXI_WIDTH_TO_BYTES(stride);
-    stride_bytes = MAX(stride_bytes, min_stride_bytes);
+        if (end == seg) {
+            // Empty path segment.
+            return FLEXI_ERR_PARAM;
+        }
 
-    // Offset to aligned keys vector.
-    flexi_ssize_t current;
-    if (!write_padding(writer, 0, stride_bytes, &current)) {
-        return FLEXI_ERR_BADWRITE;
-    }
+        if (count >= steps_len) {
+            // Not enough room for the step.
+            return FLEXI_ERR_PARAM;
+        }
 
-    flexi_ssize_t offset = current - keys_value->u.offset;
-    if (!write_uint_by_width(writer, offset, stride_bytes)) {
-        return FLEXI_ERR_BADWRITE;
-    }
+        flexi_path_step_s *step = &steps[count];
+        step->key = seg;
+        step->key_len = end - seg;
+        if (!parse_path_index(seg, end, &step->index)) {
+            // Only usable as a map key.
+            step->index = -1;
+        }
 
-    // Byte width of key vector.
-    if (!write_sint_by_width(writer, keys_value->width, stride_bytes)) {
-        return FLEXI_ERR_BADWRITE;
-    }
+        if (step->index >= 0) {
+            step->first = step->last = step->index;
+        } else if (step->key_len == 1 && *seg == '*') {
+            step->first = 0;
+            step->last = FLEXI_SSIZE_MAX;
+        } else if (!parse_path_range(seg, end, &step->first, &step->last)) {
+            // Matches no index.
+            step->first = 0;
+            step->last = -1;
+        }
 
-    // Now we're to the values - write length.
-    if (!write_uint_by_width(writer, len, stride_bytes)) {
-        return FLEXI_ERR_BADWRITE;
+        count += 1;
+        str = end;
     }
 
-    // Keep track of the base location of the vector.
-    flexi_ssize_t values_offset;
-    if (!ostream_tell(&writer->ostream, &values_offset)) {
-        return FLEXI_ERR_BADWRITE;
-    }
+    path->count = count;
+    return FLEXI_OK;
+}
 
-    // Write values.
-    res = write_vector_values(writer, len, stride_bytes);
-    if (FLEXI_ERROR(res)) {
-        return res;
-    }
+/******************************************************************************/
 
-    // Write types.
-    if (!write_vector_types(writer, len)) {
-        return FLEXI_ERR_BADWRITE;
+flexi_result_e
+flexi_cursor_seek_path(const flexi_cursor_s *cursor, const flexi_path_s *path,
+    flexi_cursor_s *dest)
+{
+    if (cursor_is_error(cursor)) {
+        cursor_set_error(dest);
+        return FLEXI_ERR_FAILSAFE;
     }
 
-    // Pop the values.
-    bool ok = writer_pop(writer, len);
-    if (!ok) {
-        return FLEXI_ERR_BADSTACK;
-    }
+    flexi_cursor_s current = *cursor;
+    for (flexi_ssize_t i = 0; i < path->count; i++) {
+        const flexi_path_step_s *step = &path->steps[i];
 
-    // Push the completed map.
-    flexi_value_s *stack = stack_push(&writer->stack);
-    if (stack == NULL) {
-        return FLEXI_ERR_BADSTACK;
+        flexi_result_e res;
+        if (current.type == FLEXI_TYPE_MAP) {
+            res = cursor_seek_map_key(&current, step->key, step->key_len,
+                dest);
+        } else if (step->index >= 0) {
+            res = flexi_cursor_seek_vector_index(&current, step->index, dest);
+        } else {
+            res = FLEXI_ERR_BADTYPE;
+        }
+
+        if (res != FLEXI_OK) {
+            cursor_set_error(dest);
+            return res;
+        }
+
+        current = *dest;
     }
 
-    stack->u.offset = values_offset;
-    stack->key = OPT_STRDUP(writer, key);
-    stack->type = FLEXI_TYPE_MAP;
-    stack->width = stride_bytes;
+    *dest = current;
     return FLEXI_OK;
 }
 
 /******************************************************************************/
 
-flexi_span_s
-flexi_make_span(const void *data, flexi_ssize_t len)
+flexi_result_e
+flexi_cursor_typed_vector_data(const flexi_cursor_s *cursor, const void **data,
+    flexi_type_e *type, int *stride, flexi_ssize_t *count)
 {
-    flexi_span_s rvo;
-    rvo.data = (const char *)data;
-    rvo.length = len;
-    return rvo;
+    if (cursor_is_error(cursor)) {
+        *data = &g_empty_typed_vector;
+        if (type) {
+            *type = FLEXI_TYPE_INVALID;
+        }
+        if (stride) {
+            *stride = 0;
+        }
+        if (count) {
+            *count = 0;
+        }
+        return FLEXI_ERR_FAILSAFE;
+    }
+
+    if (type_is_typed_vector(cursor->type)) {
+        *data = cursor->cursor;
+        if (type) {
+            *type = cursor->type;
+        }
+        if (stride) {
+            *stride = cursor->width;
+        }
+        if (count) {
+            *count = cursor->length;
+        }
+        return FLEXI_OK;
+    }
+
+    *data = &g_empty_typed_vector;
+    if (type) {
+        *type = FLEXI_TYPE_INVALID;
+    }
+    if (stride) {
+        *stride = 0;
+    }
+    if (count) {
+        *count = 0;
+    }
+    return FLEXI_ERR_BADTYPE;
 }
 
 /******************************************************************************/
 
 flexi_result_e
-flexi_open_span(const flexi_span_s *msg, flexi_cursor_s *cursor)
+flexi_cursor_typed_vector_to_i64(const flexi_cursor_s *cursor, int64_t *dst,
+    flexi_ssize_t dst_len)
 {
-    if (msg->length < 3) {
-        // Shortest length we can discard without checking.
-        cursor_set_error(cursor);
-        return FLEXI_ERR_BADREAD;
+    flexi_type_e type;
+    flexi_result_e res = cursor_typed_vector_convertible(cursor, dst_len,
+        &type);
+    if (res != FLEXI_OK) {
+        return res;
     }
 
-    // Width of root object.
-    cursor->msg = *msg;
-    cursor->cursor = span_end(msg) - 1;
-    uint8_t root_bytes = *(const uint8_t *)(cursor->cursor);
-    if (root_bytes == 0 || (size_t)msg->length < root_bytes + 2u) {
-        cursor_set_error(cursor);
-        return FLEXI_ERR_BADREAD;
+    if (!convert_to_i64(cursor->cursor, type, cursor->width, cursor->length,
+            dst)) {
+        return FLEXI_ERR_RANGE;
     }
+    return FLEXI_OK;
+}
 
-    // Obtain the packed type.
-    cursor->cursor -= 1;
-    flexi_packed_t packed = *(const uint8_t *)(cursor->cursor);
-
-    // Point at the root object.
-    flexi_type_e type = FLEXI_UNPACK_TYPE(packed);
-    cursor->cursor -= root_bytes;
+/******************************************************************************/
 
-    // Check the width before going any further.
-    if (!type_has_valid_width(type, root_bytes)) {
-        return FLEXI_ERR_BADREAD;
+flexi_result_e
+flexi_cursor_typed_vector_to_u64(const flexi_cursor_s *cursor, uint64_t *dst,
+    flexi_ssize_t dst_len)
+{
+    flexi_type_e type;
+    flexi_result_e res = cursor_typed_vector_convertible(cursor, dst_len,
+        &type);
+    if (res != FLEXI_OK) {
+        return res;
     }
 
-    if (type_is_direct(type)) {
-        // No need to resolve an offset, we're done.
-        cursor->type = type;
-        cursor->width = root_bytes;
-        return FLEXI_OK;
+    if (!convert_to_u64(cursor->cursor, type, cursor->width, cursor->length,
+            dst)) {
+        return FLEXI_ERR_RANGE;
     }
+    return FLEXI_OK;
+}
 
-    // We're pointing at an offset, resolve it.
-    flexi_ssize_t offset = 0;
-    if (!read_size_unsafe(cursor->cursor, root_bytes, &offset)) {
-        cursor_set_error(cursor);
-        return FLEXI_ERR_BADREAD;
-    }
+/******************************************************************************/
 
-    const char *dest = NULL;
-    if (!span_seek_back(&cursor->msg, cursor->cursor, offset, &dest)) {
-        cursor_set_error(cursor);
-        return FLEXI_ERR_BADREAD;
+flexi_result_e
+flexi_cursor_typed_vector_to_f32(const flexi_cursor_s *cursor, float *dst,
+    flexi_ssize_t dst_len)
+{
+    flexi_type_e type;
+    flexi_result_e res = cursor_typed_vector_convertible(cursor, dst_len,
+        &type);
+    if (res != FLEXI_OK) {
+        return res;
     }
 
-    if (!cursor_set_checked(cursor, msg, dest, type,
-            UNPACK_WIDTH_TO_BYTES(packed))) {
-        cursor_set_error(cursor);
-        return FLEXI_ERR_BADREAD;
+    if (!convert_to_f32(cursor->cursor, type, cursor->width, cursor->length,
+            dst)) {
+        return FLEXI_ERR_RANGE;
     }
-
     return FLEXI_OK;
 }
 
 /******************************************************************************/
 
-flexi_type_e
-flexi_cursor_type(const flexi_cursor_s *cursor)
+flexi_result_e
+flexi_cursor_typed_vector_to_f64(const flexi_cursor_s *cursor, double *dst,
+    flexi_ssize_t dst_len)
 {
-    return cursor->type;
-}
-
-/******************************************************************************/
+    flexi_type_e type;
+    flexi_result_e res = cursor_typed_vector_convertible(cursor, dst_len,
+        &type);
+    if (res != FLEXI_OK) {
+        return res;
+    }
 
-int
-flexi_cursor_width(const flexi_cursor_s *cursor)
-{
-    return cursor->width;
+    convert_to_f64(cursor->cursor, type, cursor->width, cursor->length, dst);
+    return FLEXI_OK;
 }
 
 /******************************************************************************/
 
-flexi_ssize_t
-flexi_cursor_length(const flexi_cursor_s *cursor)
+flexi_result_e
+flexi_cursor_foreach(flexi_cursor_s *cursor, flexi_foreach_fn foreach,
+    void *user)
 {
-    if (cursor->type == FLEXI_TYPE_KEY) {
-        return strlen(cursor->cursor);
-    } else {
-        return cursor->length;
+    flexi_iter_s iter;
+    flexi_result_e res = flexi_cursor_iter_begin(cursor, &iter);
+    if (res == FLEXI_ERR_FAILSAFE) {
+        // An error cursor is not a map or vector either.
+        return FLEXI_ERR_BADTYPE;
+    } else if (res != FLEXI_OK) {
+        return res;
+    }
+
+    const char *key;
+    flexi_cursor_s each;
+    while ((res = iter_next(&iter, &key, &each)) == FLEXI_OK) {
+        if (!foreach (key, &each, user)) {
+            return FLEXI_OK;
+        }
     }
+
+    return res == FLEXI_ERR_NOTFOUND ? FLEXI_OK : res;
 }
 
 /******************************************************************************/
 
 flexi_result_e
-flexi_cursor_sint(const flexi_cursor_s *cursor, int64_t *val)
+flexi_cursor_iter_begin(const flexi_cursor_s *cursor, flexi_iter_s *iter)
 {
     if (cursor_is_error(cursor)) {
-        *val = 0;
+        cursor_set_error(&iter->cursor);
         return FLEXI_ERR_FAILSAFE;
     }
 
-    if (type_is_sint(cursor->type)) {
-        int64_t v;
-        if (!span_read_sint(&cursor->msg, cursor->cursor, cursor->width, &v)) {
-            *val = 0;
-            return FLEXI_ERR_BADREAD;
-        }
-
-        *val = v;
-        return FLEXI_OK;
-    } else if (type_is_uint(cursor->type)) {
-        uint64_t v;
-        if (!span_read_uint(&cursor->msg, cursor->cursor, cursor->width, &v)) {
-            *val = 0;
-            return FLEXI_ERR_BADREAD;
-        }
-        if (v > INT64_MAX) {
-            *val = INT64_MAX;
-            return FLEXI_ERR_RANGE;
-        }
-
-        *val = (int64_t)v;
-        return FLEXI_OK;
-    } else if (type_is_flt(cursor->type) && cursor->width == 4) {
-        float v;
-        if (!span_read_f32(&cursor->msg, cursor->cursor, cursor->width, &v)) {
-            *val = 0;
-            return FLEXI_ERR_BADREAD;
-        }
-        if (v > (float)INT64_MAX) {
-            *val = INT64_MAX;
-            return FLEXI_ERR_RANGE;
-        }
-        if (v < (float)INT64_MIN) {
-            *val = INT64_MIN;
-            return FLEXI_ERR_RANGE;
-        }
-
-        *val = (int64_t)v;
-        return FLEXI_OK;
-    } else if (type_is_flt(cursor->type) && cursor->width == 8) {
-        double v;
-        if (!span_read_f64(&cursor->msg, cursor->cursor, cursor->width, &v)) {
-            *val = 0;
-            return FLEXI_ERR_BADREAD;
-        }
-        if (v > (double)INT64_MAX) {
-            *val = INT64_MAX;
-            return FLEXI_ERR_RANGE;
-        }
-        if (v < (double)INT64_MIN) {
-            *val = INT64_MIN;
-            return FLEXI_ERR_RANGE;
-        }
-
-        *val = (int64_t)v;
-        return FLEXI_OK;
-    } else if (cursor->type == FLEXI_TYPE_BOOL && cursor->width == 1) {
-        *val = *(const bool *)(cursor->cursor);
-        return FLEXI_OK;
+    if (!type_is_map_or_untyped_vector(cursor->type)) {
+        cursor_set_error(&iter->cursor);
+        return FLEXI_ERR_BADTYPE;
     }
 
-    *val = 0;
-    return FLEXI_ERR_BADTYPE;
+    cursor_iter_begin(cursor, iter);
+    return FLEXI_OK;
 }
 
 /******************************************************************************/
 
 flexi_result_e
-flexi_cursor_uint(const flexi_cursor_s *cursor, uint64_t *val)
+flexi_iter_next(flexi_iter_s *iter, const char **key, flexi_cursor_s *value)
 {
-    if (cursor_is_error(cursor)) {
-        *val = 0;
+    if (cursor_is_error(&iter->cursor)) {
+        cursor_set_error(value);
         return FLEXI_ERR_FAILSAFE;
     }
 
-    if (type_is_sint(cursor->type)) {
-        int64_t v;
-        if (!span_read_sint(&cursor->msg, cursor->cursor, cursor->width, &v)) {
-            *val = 0;
-            return FLEXI_ERR_BADREAD;
-        }
-        if (v < 0) {
-            *val = 0;
-            return FLEXI_ERR_RANGE;
-        }
-
-        *val = (uint64_t)v;
-        return FLEXI_OK;
-    } else if (type_is_uint(cursor->type)) {
-        uint64_t v;
-        if (!span_read_uint(&cursor->msg, cursor->cursor, cursor->width, &v)) {
-            *val = 0;
-            return FLEXI_ERR_BADREAD;
-        }
-
-        *val = v;
-        return FLEXI_OK;
-    } else if (type_is_flt(cursor->type) && cursor->width == 4) {
-        float v;
-        if (!span_read_f32(&cursor->msg, cursor->cursor, cursor->width, &v)) {
-            *val = 0;
-            return FLEXI_ERR_BADREAD;
-        }
-
-        *val = (uint64_t)v;
-        return FLEXI_OK;
-    } else if (type_is_flt(cursor->type) && cursor->width == 8) {
-        double v;
-        if (!span_read_f64(&cursor->msg, cursor->cursor, cursor->width, &v)) {
-            *val = 0;
-            return FLEXI_ERR_BADREAD;
+    const char *dummy;
+    flexi_result_e res = iter_next(iter, key ? key : &dummy, value);
+    if (res != FLEXI_OK) {
+        cursor_set_error(value);
+        if (res == FLEXI_ERR_BADREAD) {
+            // Don't try to read past the corruption again.
+            cursor_set_error(&iter->cursor);
         }
-
-        *val = (uint64_t)v;
-        return FLEXI_OK;
-    } else if (cursor->type == FLEXI_TYPE_BOOL && cursor->width == 1) {
-        *val = *(const bool *)(cursor->cursor);
-        return FLEXI_OK;
     }
-
-    *val = 0;
-    return FLEXI_ERR_BADTYPE;
+    return res;
 }
 
 /******************************************************************************/
 
 flexi_result_e
-flexi_cursor_f32(const flexi_cursor_s *cursor, float *val)
+flexi_cursor_blob(const flexi_cursor_s *cursor, const uint8_t **blob,
+    flexi_ssize_t *len)
 {
     if (cursor_is_error(cursor)) {
-        *val = 0.0f;
+        *blob = &g_empty_blob;
+        *len = 0;
         return FLEXI_ERR_FAILSAFE;
     }
 
-    if (type_is_sint(cursor->type)) {
-        int64_t v;
-        if (!span_read_sint(&cursor->msg, cursor->cursor, cursor->width, &v)) {
-            *val = 0.0f;
-            return FLEXI_ERR_BADREAD;
-        }
-
-        *val = (float)v;
-        return FLEXI_OK;
-    } else if (type_is_uint(cursor->type)) {
-        uint64_t v;
-        if (!span_read_uint(&cursor->msg, cursor->cursor, cursor->width, &v)) {
-            *val = 0.0f;
-            return FLEXI_ERR_BADREAD;
-        }
-
-        *val = (float)v;
-        return FLEXI_OK;
-    } else if (type_is_flt(cursor->type) && cursor->width == 4) {
-        float v;
-        if (!span_read_f32(&cursor->msg, cursor->cursor, cursor->width, &v)) {
-            *val = 0.0f;
-            return FLEXI_ERR_BADREAD;
-        }
-
-        *val = v;
-        return FLEXI_OK;
-    } else if (type_is_flt(cursor->type) && cursor->width == 8) {
-        double v;
-        if (!span_read_f64(&cursor->msg, cursor->cursor, cursor->width, &v)) {
-            *val = 0.0f;
-            return FLEXI_ERR_BADREAD;
-        }
-
-        *val = (float)v;
-        return FLEXI_OK;
-    } else if (cursor->type == FLEXI_TYPE_BOOL && cursor->width == 1) {
-        *val = (float)*(const bool *)(cursor->cursor);
-        return FLEXI_OK;
+    if (cursor->type != FLEXI_TYPE_BLOB) {
+        *blob = &g_empty_blob;
+        *len = 0;
+        return FLEXI_ERR_BADTYPE;
     }
 
-    *val = 0.0f;
-    return FLEXI_ERR_BADTYPE;
+    *blob = (const uint8_t *)cursor->cursor;
+    *len = cursor->length;
+    return FLEXI_OK;
 }
 
 /******************************************************************************/
 
 flexi_result_e
-flexi_cursor_f64(const flexi_cursor_s *cursor, double *val)
+flexi_cursor_bool(const flexi_cursor_s *cursor, bool *val)
 {
     if (cursor_is_error(cursor)) {
-        *val = 0.0;
+        *val = false;
         return FLEXI_ERR_FAILSAFE;
     }
 
-    if (type_is_sint(cursor->type)) {
-        int64_t v;
-        if (!span_read_sint(&cursor->msg, cursor->cursor, cursor->width, &v)) {
-            *val = 0.0;
-            return FLEXI_ERR_BADREAD;
-        }
-
-        *val = (double)v;
-        return FLEXI_OK;
-    } else if (type_is_uint(cursor->type)) {
+    if (type_is_anyint(cursor->type)) {
         uint64_t v;
         if (!span_read_uint(&cursor->msg, cursor->cursor, cursor->width, &v)) {
-            *val = 0.0;
+            *val = false;
             return FLEXI_ERR_BADREAD;
         }
 
-        *val = (double)v;
+        *val = (bool)v;
         return FLEXI_OK;
-    } else if (type_is_flt(cursor->type) && cursor->width == 4) {
+    } else if (cursor->type == FLEXI_TYPE_FLOAT &&
+               cursor->width == sizeof(float)) {
         float v;
         if (!span_read_f32(&cursor->msg, cursor->cursor, cursor->width, &v)) {
-            *val = 0.0;
+            *val = false;
             return FLEXI_ERR_BADREAD;
         }
 
-        *val = v;
+        *val = (bool)v;
         return FLEXI_OK;
-    } else if (type_is_flt(cursor->type) && cursor->width == 8) {
+    } else if (cursor->type == FLEXI_TYPE_FLOAT &&
+               cursor->width == sizeof(double)) {
         double v;
         if (!span_read_f64(&cursor->msg, cursor->cursor, cursor->width, &v)) {
-            *val = 0.0;
+            *val = false;
             return FLEXI_ERR_BADREAD;
         }
 
-        *val = v;
+        *val = (bool)v;
         return FLEXI_OK;
-    } else if (cursor->type == FLEXI_TYPE_BOOL && cursor->width == 1) {
-        *val = (double)*(const bool *)(cursor->cursor);
+    } else if (cursor->type == FLEXI_TYPE_BOOL) {
+        *val = *(const bool *)(cursor->cursor);
         return FLEXI_OK;
     }
 
-    *val = 0.0;
+    *val = false;
     return FLEXI_ERR_BADTYPE;
 }
 
 /******************************************************************************/
 
-flexi_result_e
-flexi_cursor_key(const flexi_cursor_s *cursor, const char **str)
+flexi_stack_s
+flexi_make_stack(flexi_stack_at_fn at, flexi_stack_count_fn count,
+    flexi_stack_push_fn push, flexi_stack_pop_fn pop, void *user)
 {
-    if (cursor_is_error(cursor)) {
-        *str = "";
-        return FLEXI_ERR_FAILSAFE;
-    }
+    flexi_stack_s stack;
+    stack.at = at;
+    stack.count = count;
+    stack.push = push;
+    stack.pop = pop;
+    stack.user = user;
+    return stack;
+}
 
-    switch (cursor->type) {
-    case FLEXI_TYPE_KEY: break;
-    case FLEXI_TYPE_STRING: break;
-    default: *str = ""; return FLEXI_ERR_BADTYPE;
-    }
+/******************************************************************************/
 
-    *str = cursor->cursor;
-    return FLEXI_OK;
+flexi_ostream_s
+flexi_make_ostream(flexi_ostream_write_fn write,
+    flexi_ostream_data_at_fn data_at, flexi_ostream_tell_fn tell, void *user)
+{
+    flexi_ostream_s ostream;
+    ostream.write = write;
+    ostream.data_at = data_at;
+    ostream.tell = tell;
+    ostream.user = user;
+    return ostream;
 }
 
 /******************************************************************************/
 
-flexi_result_e
-flexi_cursor_string(const flexi_cursor_s *cursor, const char **str,
-    flexi_ssize_t *len)
+flexi_writer_s
+flexi_make_writer(const flexi_stack_s *stack, const flexi_ostream_s *ostream,
+    flexi_strdup_fn opt_strdup, flexi_free_fn opt_free)
 {
-    if (cursor_is_error(cursor)) {
-        *str = "";
-        *len = 0;
-        return FLEXI_ERR_FAILSAFE;
-    }
+    flexi_writer_s writer;
+    writer.stack = *stack;
+    writer.ostream = *ostream;
+    writer.opt_strdup = opt_strdup;
+    writer.opt_free = opt_free;
+    writer_pool_init(&writer.key_pool, NULL, 0);
+    writer_pool_init(&writer.keyset_pool, NULL, 0);
+    writer_pool_init(&writer.string_pool, NULL, 0);
+    writer.string_pool_max = 0;
+    writer.typed_vectors = false;
+    writer.buffer.data = NULL;
+    writer.buffer.capacity = 0;
+    writer.buffer.len = 0;
+    writer.buffer.base = 0;
+    writer.dry_run = false;
+    writer.dry_run_len = 0;
+    writer.scratch.data = NULL;
+    writer.scratch.capacity = 0;
+    writer.scratch.len = 0;
+    writer.scratch.count = 0;
+    writer.err = FLEXI_INVALID;
+    return writer;
+}
 
-    switch (cursor->type) {
-    case FLEXI_TYPE_KEY: {
-        *str = cursor->cursor;
-        *len = strlen(cursor->cursor);
-        return FLEXI_OK;
-    }
-    case FLEXI_TYPE_STRING: {
-        *str = cursor->cursor;
-        *len = cursor->length;
-        return FLEXI_OK;
-    }
-    default: {
-        *str = "";
-        *len = 0;
-        return FLEXI_ERR_BADTYPE;
-    }
-    }
+/******************************************************************************/
+
+flexi_array_stack_s
+flexi_make_fixed_stack(flexi_value_s *values, flexi_ssize_t capacity)
+{
+    flexi_array_stack_s array;
+    array.values = values;
+    array.count = 0;
+    array.capacity = capacity;
+    array.realloc_fn = NULL;
+    array.free_fn = NULL;
+    return array;
 }
 
 /******************************************************************************/
 
-flexi_result_e
-flexi_cursor_map_key_at_index(const flexi_cursor_s *cursor, flexi_ssize_t index,
-    const char **str)
+flexi_array_stack_s
+flexi_make_growable_stack(flexi_realloc_fn realloc_fn, flexi_free_fn free_fn)
 {
-    if (cursor_is_error(cursor)) {
-        *str = "";
-        return FLEXI_ERR_FAILSAFE;
-    }
+    flexi_array_stack_s array;
+    array.values = NULL;
+    array.count = 0;
+    array.capacity = 0;
+    array.realloc_fn = realloc_fn;
+    array.free_fn = free_fn;
+    return array;
+}
 
-    if (cursor->type != FLEXI_TYPE_MAP || index < 0 ||
-        index >= cursor->length) {
-        *str = "";
-        return FLEXI_ERR_BADTYPE;
-    }
+/******************************************************************************/
 
-    flexi_cursor_s keys;
-    if (!cursor_map_keys(cursor, &keys)) {
-        *str = "";
-        return FLEXI_ERR_BADREAD;
+void
+flexi_destroy_array_stack(flexi_array_stack_s *array)
+{
+    if (array->free_fn != NULL) {
+        array->free_fn(array->values);
+        array->values = NULL;
+        array->capacity = 0;
     }
+    array->count = 0;
+}
 
-    if (!cursor_map_key_at_index(cursor, &keys, index, str)) {
-        *str = "";
-        return FLEXI_ERR_INTERNAL;
+/******************************************************************************/
+
+flexi_stack_s
+flexi_array_stack(flexi_array_stack_s *array)
+{
+    return flexi_make_stack(array_stack_at, array_stack_count,
+        array_stack_push, array_stack_pop, array);
+}
+
+/******************************************************************************/
+
+flexi_mem_ostream_s
+flexi_make_mem_ostream(flexi_ssize_t initial_size, flexi_realloc_fn realloc_fn,
+    flexi_free_fn free_fn)
+{
+    flexi_mem_ostream_s mem;
+    mem.head = NULL;
+    mem.tail = NULL;
+    mem.len = 0;
+    mem.next_size = MAX(initial_size, 64);
+    mem.realloc_fn = realloc_fn;
+    mem.free_fn = free_fn;
+    return mem;
+}
+
+/******************************************************************************/
+
+void
+flexi_destroy_mem_ostream(flexi_mem_ostream_s *mem)
+{
+    flexi_mem_chunk_s *chunk = mem->head;
+    while (chunk != NULL) {
+        flexi_mem_chunk_s *next = chunk->next;
+        mem->free_fn(chunk);
+        chunk = next;
     }
 
-    return FLEXI_OK;
+    mem->head = NULL;
+    mem->tail = NULL;
+    mem->len = 0;
 }
 
 /******************************************************************************/
 
-flexi_result_e
-flexi_cursor_seek_map_key(const flexi_cursor_s *cursor, const char *key,
-    flexi_cursor_s *dest)
+void
+flexi_mem_ostream_reset(flexi_mem_ostream_s *mem)
 {
-    if (cursor_is_error(cursor)) {
-        cursor_set_error(dest);
-        return FLEXI_ERR_FAILSAFE;
+    if (mem->head != NULL && mem->head == mem->tail) {
+        mem->head->len = 0;
+        mem->len = 0;
+        return;
     }
 
-    if (cursor->type != FLEXI_TYPE_MAP) {
-        cursor_set_error(dest);
-        return FLEXI_ERR_BADTYPE;
+    // Replace the chunks with one chunk that fits them all next time.
+    flexi_ssize_t capacity = 0;
+    for (flexi_mem_chunk_s *chunk = mem->head; chunk != NULL;
+         chunk = chunk->next) {
+        capacity += chunk->capacity;
     }
 
-    if (cursor->length <= FLEXI_CONFIG_SEEK_MAP_KEY_LINEAR_MAX) {
-        return cursor_seek_map_key_linear(cursor, cursor->length, key, dest);
-    } else {
-        return cursor_seek_map_key_bsearch(cursor, cursor->length, key, dest);
+    flexi_destroy_mem_ostream(mem);
+    mem->next_size = MAX(mem->next_size, capacity);
+}
+
+/******************************************************************************/
+
+flexi_ostream_s
+flexi_mem_ostream(flexi_mem_ostream_s *mem)
+{
+    return flexi_make_ostream(
+        mem_ostream_write, mem_ostream_data_at, mem_ostream_tell, mem);
+}
+
+/******************************************************************************/
+
+const void *
+flexi_mem_ostream_data(const flexi_mem_ostream_s *mem, flexi_ssize_t *len)
+{
+    *len = mem->len;
+    if (mem->head == NULL || mem->head != mem->tail) {
+        return NULL;
     }
+    return MEM_CHUNK_DATA(mem->head);
 }
 
 /******************************************************************************/
 
 flexi_result_e
-flexi_cursor_vector_types(const flexi_cursor_s *cursor,
-    const flexi_packed_t **packed)
+flexi_mem_ostream_copy(const flexi_mem_ostream_s *mem, void *dst,
+    flexi_ssize_t len)
 {
-    if (cursor_is_error(cursor)) {
-        *packed = &g_empty_packed;
-        return FLEXI_ERR_FAILSAFE;
+    if (len < mem->len) {
+        return FLEXI_ERR_PARAM;
     }
 
-    if (cursor->type != FLEXI_TYPE_VECTOR && cursor->type != FLEXI_TYPE_MAP) {
-        *packed = &g_empty_packed;
-        return FLEXI_ERR_BADTYPE;
+    char *out = (char *)dst;
+    for (const flexi_mem_chunk_s *chunk = mem->head; chunk != NULL;
+         chunk = chunk->next) {
+        memcpy(out + chunk->base, MEM_CHUNK_DATA(chunk), (size_t)chunk->len);
     }
-
-    *packed = cursor_vector_types(cursor);
     return FLEXI_OK;
 }
 
 /******************************************************************************/
 
-flexi_result_e
-flexi_cursor_seek_vector_index(const flexi_cursor_s *cursor,
-    flexi_ssize_t index, flexi_cursor_s *dest)
+flexi_fixed_ostream_s
+flexi_make_fixed_ostream(void *buffer, flexi_ssize_t len)
 {
-    if (cursor_is_error(cursor)) {
-        cursor_set_error(dest);
-        return FLEXI_ERR_FAILSAFE;
+    flexi_fixed_ostream_s fixed;
+    fixed.data = (char *)buffer;
+    fixed.len = 0;
+    fixed.capacity = buffer != NULL ? len : 0;
+    return fixed;
+}
+
+/******************************************************************************/
+
+flexi_ostream_s
+flexi_fixed_ostream(flexi_fixed_ostream_s *fixed)
+{
+    return flexi_make_ostream(fixed_ostream_write, fixed_ostream_data_at,
+        fixed_ostream_tell, fixed);
+}
+
+/******************************************************************************/
+
+flexi_ssize_t
+flexi_writer_pool_size(flexi_ssize_t count)
+{
+    flexi_ssize_t capacity = 2;
+    while (capacity < count * 2) {
+        capacity *= 2;
     }
+    return capacity * (flexi_ssize_t)sizeof(flexi_ssize_t) * POOL_SLOT_LEN;
+}
 
-    if (type_is_map_or_untyped_vector(cursor->type)) {
-        if (index < 0 || index >= cursor->length) {
-            // Index is out of range.
-            cursor_set_error(dest);
-            return FLEXI_ERR_FAILSAFE;
-        }
+/******************************************************************************/
 
-        // Untyped vectors and maps can be seeked.
-        if (!cursor_seek_untyped_vector_index(cursor, index, dest)) {
-            cursor_set_error(dest);
-            return FLEXI_ERR_INTERNAL;
-        }
+flexi_result_e
+flexi_writer_set_key_pool(flexi_writer_s *writer, void *buffer,
+    flexi_ssize_t len)
+{
+    return writer_pool_init(&writer->key_pool, buffer, len);
+}
 
-        return FLEXI_OK;
-    } else if (type_is_typed_vector(cursor->type)) {
-        if (index < 0 || index >= cursor->length) {
-            // Index is out of range.
-            cursor_set_error(dest);
-            return FLEXI_ERR_FAILSAFE;
-        }
+/******************************************************************************/
 
-        // Typed vectors can still be seeked.  It's slower than direct
-        // access, but it should still work.
-        if (!cursor_seek_typed_vector_index(cursor, index, dest)) {
-            cursor_set_error(dest);
-            return FLEXI_ERR_INTERNAL;
-        }
+flexi_result_e
+flexi_writer_set_keyset_pool(flexi_writer_s *writer, void *buffer,
+    flexi_ssize_t len)
+{
+    return writer_pool_init(&writer->keyset_pool, buffer, len);
+}
 
-        return FLEXI_OK;
+/******************************************************************************/
+
+flexi_result_e
+flexi_writer_set_string_pool(flexi_writer_s *writer, void *buffer,
+    flexi_ssize_t len, flexi_ssize_t max_len)
+{
+    if (max_len < 0) {
+        return FLEXI_ERR_PARAM;
     }
 
-    cursor_set_error(dest);
-    return FLEXI_ERR_BADTYPE;
+    writer->string_pool_max = max_len;
+    return writer_pool_init(&writer->string_pool, buffer, len);
+}
+
+/******************************************************************************/
+
+void
+flexi_writer_set_typed_vectors(flexi_writer_s *writer, bool enable)
+{
+    writer->typed_vectors = enable;
 }
 
 /******************************************************************************/
 
 flexi_result_e
-flexi_cursor_typed_vector_data(const flexi_cursor_s *cursor, const void **data,
-    flexi_type_e *type, int *stride, flexi_ssize_t *count)
+flexi_writer_set_buffer(flexi_writer_s *writer, void *buffer,
+    flexi_ssize_t len)
 {
-    if (cursor_is_error(cursor)) {
-        *data = &g_empty_typed_vector;
-        if (type) {
-            *type = FLEXI_TYPE_INVALID;
-        }
-        if (stride) {
-            *stride = 0;
-        }
-        if (count) {
-            *count = 0;
-        }
-        return FLEXI_ERR_FAILSAFE;
+    if (buffer != NULL && len <= 0) {
+        return FLEXI_ERR_PARAM;
     }
 
-    if (type_is_typed_vector(cursor->type)) {
-        *data = cursor->cursor;
-        if (type) {
-            *type = cursor->type;
-        }
-        if (stride) {
-            *stride = cursor->width;
-        }
-        if (count) {
-            *count = cursor->length;
-        }
-        return FLEXI_OK;
+    if (!writer_flush(writer)) {
+        return FLEXI_ERR_BADWRITE;
     }
 
-    *data = &g_empty_typed_vector;
-    if (type) {
-        *type = FLEXI_TYPE_INVALID;
-    }
-    if (stride) {
-        *stride = 0;
-    }
-    if (count) {
-        *count = 0;
+    // Buffered data starts at the current end of the stream.
+    flexi_ssize_t base = 0;
+    if (buffer != NULL && !ostream_tell(&writer->ostream, &base)) {
+        return FLEXI_ERR_BADWRITE;
     }
-    return FLEXI_ERR_BADTYPE;
+
+    writer->buffer.data = (char *)buffer;
+    writer->buffer.capacity = buffer != NULL ? len : 0;
+    writer->buffer.len = 0;
+    writer->buffer.base = base;
+    return FLEXI_OK;
 }
 
 /******************************************************************************/
 
 flexi_result_e
-flexi_cursor_foreach(flexi_cursor_s *cursor, flexi_foreach_fn foreach,
-    void *user)
+flexi_writer_flush(flexi_writer_s *writer)
 {
-    switch (cursor->type) {
-    case FLEXI_TYPE_MAP: return cursor_foreach_map(cursor, foreach, user);
-    case FLEXI_TYPE_VECTOR:
-        return cursor_foreach_untyped_vector(cursor, foreach, user);
-    default: return FLEXI_ERR_BADTYPE;
+    if (!writer_flush(writer)) {
+        return FLEXI_ERR_BADWRITE;
     }
+    return FLEXI_OK;
 }
 
 /******************************************************************************/
 
 flexi_result_e
-flexi_cursor_blob(const flexi_cursor_s *cursor, const uint8_t **blob,
-    flexi_ssize_t *len)
+flexi_destroy_writer(flexi_writer_s *writer)
 {
-    if (cursor_is_error(cursor)) {
-        *blob = &g_empty_blob;
-        *len = 0;
-        return FLEXI_ERR_FAILSAFE;
-    }
-
-    if (cursor->type != FLEXI_TYPE_BLOB) {
-        *blob = &g_empty_blob;
-        *len = 0;
-        return FLEXI_ERR_BADTYPE;
-    }
-
-    *blob = (const uint8_t *)cursor->cursor;
-    *len = cursor->length;
-    return FLEXI_OK;
+    flexi_ssize_t count = stack_count(&writer->stack);
+    return writer_pop(writer, count) ? FLEXI_OK : FLEXI_ERR_BADSTACK;
 }
 
 /******************************************************************************/
 
 flexi_result_e
-flexi_cursor_bool(const flexi_cursor_s *cursor, bool *val)
+flexi_writer_reset(flexi_writer_s *writer)
 {
-    if (cursor_is_error(cursor)) {
-        *val = false;
-        return FLEXI_ERR_FAILSAFE;
+    flexi_ssize_t count = stack_count(&writer->stack);
+    if (!writer_pop(writer, count)) {
+        return FLEXI_ERR_BADSTACK;
     }
 
-    if (type_is_anyint(cursor->type)) {
-        uint64_t v;
-        if (!span_read_uint(&cursor->msg, cursor->cursor, cursor->width, &v)) {
-            *val = false;
-            return FLEXI_ERR_BADREAD;
-        }
-
-        *val = (bool)v;
-        return FLEXI_OK;
-    } else if (cursor->type == FLEXI_TYPE_FLOAT &&
-               cursor->width == sizeof(float)) {
-        float v;
-        if (!span_read_f32(&cursor->msg, cursor->cursor, cursor->width, &v)) {
-            *val = false;
-            return FLEXI_ERR_BADREAD;
-        }
-
-        *val = (bool)v;
-        return FLEXI_OK;
-    } else if (cursor->type == FLEXI_TYPE_FLOAT &&
-               cursor->width == sizeof(double)) {
-        double v;
-        if (!span_read_f64(&cursor->msg, cursor->cursor, cursor->width, &v)) {
-            *val = false;
-            return FLEXI_ERR_BADREAD;
-        }
+    if (writer->ostream.write == mem_ostream_write) {
+        flexi_mem_ostream_reset((flexi_mem_ostream_s *)writer->ostream.user);
+    }
 
-        *val = (bool)v;
-        return FLEXI_OK;
-    } else if (cursor->type == FLEXI_TYPE_BOOL) {
-        *val = *(const bool *)(cursor->cursor);
-        return FLEXI_OK;
+    // Buffered data starts over at the rewound end of the stream.
+    writer->buffer.len = 0;
+    if (writer->buffer.data != NULL &&
+        !ostream_tell(&writer->ostream, &writer->buffer.base)) {
+        return FLEXI_ERR_BADWRITE;
     }
 
-    *val = false;
-    return FLEXI_ERR_BADTYPE;
+    writer_pool_clear(&writer->key_pool);
+    writer_pool_clear(&writer->keyset_pool);
+    writer_pool_clear(&writer->string_pool);
+    writer->dry_run_len = 0;
+    writer->scratch.len = 0;
+    writer->scratch.count = 0;
+    writer->err = FLEXI_INVALID;
+    return FLEXI_OK;
 }
 
 /******************************************************************************/
 
-flexi_stack_s
-flexi_make_stack(flexi_stack_at_fn at, flexi_stack_count_fn count,
-    flexi_stack_push_fn push, flexi_stack_pop_fn pop, void *user)
+flexi_result_e
+flexi_writer_begin_dry_run(flexi_writer_s *writer)
 {
-    flexi_stack_s stack;
-    stack.at = at;
-    stack.count = count;
-    stack.push = push;
-    stack.pop = pop;
-    stack.user = user;
-    return stack;
+    writer->dry_run = true;
+    return flexi_writer_reset(writer);
 }
 
 /******************************************************************************/
 
-flexi_ostream_s
-flexi_make_ostream(flexi_ostream_write_fn write,
-    flexi_ostream_data_at_fn data_at, flexi_ostream_tell_fn tell, void *user)
+flexi_result_e
+flexi_writer_set_dry_run_scratch(flexi_writer_s *writer, void *buffer,
+    flexi_ssize_t len)
 {
-    flexi_ostream_s ostream;
-    ostream.write = write;
-    ostream.data_at = data_at;
-    ostream.tell = tell;
-    ostream.user = user;
-    return ostream;
-}
-
-/******************************************************************************/
+    if (buffer != NULL && len <= 0) {
+        return FLEXI_ERR_PARAM;
+    }
 
-flexi_writer_s
-flexi_make_writer(const flexi_stack_s *stack, const flexi_ostream_s *ostream,
-    flexi_strdup_fn opt_strdup, flexi_free_fn opt_free)
-{
-    flexi_writer_s writer;
-    writer.stack = *stack;
-    writer.ostream = *ostream;
-    writer.opt_strdup = opt_strdup;
-    writer.opt_free = opt_free;
-    writer.err = FLEXI_INVALID;
-    return writer;
+    // Entries are stored from the end, so the end must stay aligned.
+    writer->scratch.data = (char *)buffer;
+    writer->scratch.capacity =
+        buffer != NULL ? len - (len % (flexi_ssize_t)sizeof(flexi_ssize_t))
+                       : 0;
+    writer->scratch.len = 0;
+    writer->scratch.count = 0;
+    return FLEXI_OK;
 }
 
 /******************************************************************************/
 
 flexi_result_e
-flexi_destroy_writer(flexi_writer_s *writer)
+flexi_writer_end_dry_run(flexi_writer_s *writer, flexi_ssize_t *size)
 {
-    flexi_ssize_t count = stack_count(&writer->stack);
-    return writer_pop(writer, count) ? FLEXI_OK : FLEXI_ERR_BADSTACK;
+    *size = writer->dry_run_len;
+    writer->dry_run = false;
+    return flexi_writer_reset(writer);
 }
 
 /******************************************************************************/
@@ -2912,24 +5824,47 @@ flexi_write_string(flexi_writer_s *writer, const char *key, const char *str,
         return FLEXI_ERR_FAILSAFE;
     }
 
-    // Write the string length to stream.
     int width = UINT_WIDTH(len);
-    if (!write_uint_by_width(writer, len, width)) {
-        writer->err = FLEXI_ERR_BADWRITE;
-        return writer->err;
+    flexi_ssize_t offset = -1;
+    flexi_ssize_t *slot = NULL;
+    uint32_t hash = 0;
+    bool pooled =
+        writer->string_pool.slots != NULL && len <= writer->string_pool_max;
+    if (pooled) {
+        hash = hash_mem(str, len);
+        flexi_result_e res =
+            writer_find_string(writer, str, len, hash, &slot, &offset);
+        if (FLEXI_ERROR(res)) {
+            writer->err = res;
+            return writer->err;
+        }
     }
 
-    // Keep track of string starting position.
-    flexi_ssize_t offset;
-    if (!ostream_tell(&writer->ostream, &offset)) {
-        writer->err = FLEXI_ERR_BADWRITE;
-        return writer->err;
-    }
+    if (offset < 0) {
+        // Write the string length to stream.
+        if (!write_uint_by_width(writer, len, width)) {
+            writer->err = FLEXI_ERR_BADWRITE;
+            return writer->err;
+        }
 
-    // Write the string, plus the trailing '\0'.
-    if (!ostream_write(&writer->ostream, str, len + 1)) {
-        writer->err = FLEXI_ERR_BADWRITE;
-        return writer->err;
+        // Keep track of string starting position.
+        if (!writer_tell(writer, &offset)) {
+            writer->err = FLEXI_ERR_BADWRITE;
+            return writer->err;
+        }
+
+        // Write the string, plus the trailing '\0'.  A dry run keeps
+        // strings that might be pooled to compare against later.
+        bool ok = pooled ? writer_write_kept(writer, str, len + 1)
+                         : writer_write(writer, str, len + 1);
+        if (!ok) {
+            writer->err = FLEXI_ERR_BADWRITE;
+            return writer->err;
+        }
+
+        if (slot != NULL) {
+            writer_pool_insert(&writer->string_pool, slot, hash, offset, len);
+        }
     }
 
     // Push offset to the stack.
@@ -3130,7 +6065,8 @@ flexi_write_map_values(flexi_writer_s *writer, const char *key,
         return FLEXI_ERR_FAILSAFE;
     }
 
-    flexi_result_e res = write_map_values(writer, key, keyset, len, stride);
+    flexi_result_e res =
+        write_map_values(writer, key, keyset, len, stride, false);
     if (FLEXI_ERROR(res)) {
         writer->err = res;
     }
@@ -3155,27 +6091,66 @@ flexi_write_map(flexi_writer_s *writer, const char *key, flexi_ssize_t len,
         return writer->err;
     }
 
-    // Push keys to the stack.
-    flexi_result_e res;
+    // Every value needs a key.
     for (flexi_ssize_t i = values_start; i < values_end; i++) {
         flexi_value_s *value = stack_at(&writer->stack, i);
         if (value == NULL || value->key == NULL) {
             writer->err = FLEXI_ERR_INTERNAL;
             return writer->err;
         }
+    }
+
+    // Sort the values once up front.  Keys are then pushed in sorted order,
+    // so neither the keys nor the values need to be sorted again.
+    if (!writer_sort_map_values(writer, len)) {
+        writer->err = FLEXI_ERR_INTERNAL;
+        return writer->err;
+    }
+
+    // Reuse an identical keys vector if one was already written, which
+    // skips writing the keys.
+    flexi_ssize_t found = -1;
+    flexi_ssize_t *slot = NULL;
+    uint32_t hash = 0;
+    flexi_result_e res;
+    if (writer->keyset_pool.slots != NULL) {
+        res = writer_keyset_hash(writer, len, true, &hash);
+        if (FLEXI_ERROR(res)) {
+            writer->err = res;
+            return writer->err;
+        }
 
-        res = write_key(writer, NULL, value->key);
+        res = writer_find_keyset(writer, len, true, hash, &slot, &found);
         if (FLEXI_ERROR(res)) {
             writer->err = res;
             return writer->err;
         }
     }
 
-    // Push the key array to the stack.
-    res = write_map_keys(writer, len, FLEXI_WIDTH_1B, NULL);
-    if (FLEXI_ERROR(res)) {
-        writer->err = res;
-        return writer->err;
+    if (found >= 0) {
+        res = writer_push_keys_vector(writer, found, (int)slot[2], NULL);
+        if (FLEXI_ERROR(res)) {
+            writer->err = res;
+            return writer->err;
+        }
+    } else {
+        // Push keys to the stack.
+        for (flexi_ssize_t i = values_start; i < values_end; i++) {
+            flexi_value_s *value = stack_at(&writer->stack, i);
+            res = write_key(writer, NULL, value->key);
+            if (FLEXI_ERROR(res)) {
+                writer->err = res;
+                return writer->err;
+            }
+        }
+
+        // Push the key array to the stack, and remember it in the pool.
+        res = write_keys_vector(
+            writer, len, FLEXI_WIDTH_1B, NULL, true, slot, hash);
+        if (FLEXI_ERROR(res)) {
+            writer->err = res;
+            return writer->err;
+        }
     }
 
     // We need to move the keys lower on the stack than values.
@@ -3186,7 +6161,7 @@ flexi_write_map(flexi_writer_s *writer, const char *key, flexi_ssize_t len,
     }
 
     // Write out all of our values.
-    res = write_map_values(writer, key, values_start, len, stride);
+    res = write_map_values(writer, key, values_start, len, stride, true);
     if (FLEXI_ERROR(res)) {
         writer->err = res;
         return writer->err;
@@ -3218,42 +6193,60 @@ flexi_write_vector(flexi_writer_s *writer, const char *key, flexi_ssize_t len,
         return FLEXI_ERR_FAILSAFE;
     }
 
+    // Values that all share one type can be written as a typed vector.
+    flexi_type_e type = FLEXI_TYPE_VECTOR;
+    if (writer->typed_vectors) {
+        flexi_type_e element = writer_vector_typed_element(writer, len);
+        if (element != FLEXI_TYPE_INVALID) {
+            type = typed_vector_type(element, len);
+        }
+    }
+
+    // Fixed-length typed vectors have no length.
+    bool has_len = !type_is_fixed_typed_vector(type);
+
     // The stride the developer passed in might not be wide enough to
     // contain all of the values.  Calculate a minimum stride.
-    int min_stride_bytes;
-    flexi_result_e res =
-        writer_vector_calc_min_stride(writer, len, &min_stride_bytes);
+    int stride_bytes;
+    flexi_result_e res = writer_vector_calc_min_stride(writer, len,
+        FLEXI_WIDTH_TO_BYTES(stride), true, has_len ? 1 : 0, -1,
+        &stride_bytes);
     if (FLEXI_ERROR(res)) {
         writer->err = res;
         return writer->err;
     }
 
-    // Take the larger of our calculation vs. parameter.
-    int stride_bytes = FLEXI_WIDTH_TO_BYTES(stride);
-    stride_bytes = MAX(stride_bytes, min_stride_bytes);
-
     // Align future writes to the nearest multiple.
     flexi_ssize_t offset;
-    if (!write_padding(writer, stride_bytes, stride_bytes, &offset)) {
+    int prefix = has_len ? stride_bytes : 0;
+    if (!write_padding(writer, prefix, stride_bytes, &offset)) {
         writer->err = FLEXI_ERR_BADWRITE;
         return writer->err;
     }
 
+    writer_stage_s stage;
+    stage_init(&stage, writer);
+
     // Write length
-    if (!write_uint_by_width(writer, len, stride_bytes)) {
+    if (has_len && !stage_uint_by_width(&stage, len, stride_bytes)) {
         writer->err = FLEXI_ERR_BADWRITE;
         return writer->err;
     }
 
     // Write values.
-    res = write_vector_values(writer, len, stride_bytes);
+    res = write_vector_values(&stage, len, stride_bytes, offset);
     if (FLEXI_ERROR(res)) {
         writer->err = res;
         return writer->err;
     }
 
-    // Write types.
-    if (!write_vector_types(writer, len)) {
+    // Write types, which typed vectors don't have.
+    if (type == FLEXI_TYPE_VECTOR && !write_vector_types(&stage, len)) {
+        writer->err = FLEXI_ERR_BADWRITE;
+        return writer->err;
+    }
+
+    if (!stage_flush(&stage)) {
         writer->err = FLEXI_ERR_BADWRITE;
         return writer->err;
     }
@@ -3274,7 +6267,7 @@ flexi_write_vector(flexi_writer_s *writer, const char *key, flexi_ssize_t len,
 
     stack->u.offset = offset;
     stack->key = OPT_STRDUP(writer, key);
-    stack->type = FLEXI_TYPE_VECTOR;
+    stack->type = type;
     stack->width = stride_bytes;
     return FLEXI_OK;
 }
@@ -3303,7 +6296,7 @@ flexi_write_typed_vector_sint(flexi_writer_s *writer, const char *key,
         }
 
         // Write values.
-        if (!ostream_write(&writer->ostream, ptr, len * stride_bytes)) {
+        if (!writer_write(writer, ptr, len * stride_bytes)) {
             writer->err = FLEXI_ERR_BADWRITE;
             return writer->err;
         }
@@ -3336,7 +6329,7 @@ flexi_write_typed_vector_sint(flexi_writer_s *writer, const char *key,
         }
 
         // Write values.
-        if (!ostream_write(&writer->ostream, ptr, len * stride_bytes)) {
+        if (!writer_write(writer, ptr, len * stride_bytes)) {
             writer->err = FLEXI_ERR_BADWRITE;
             return writer->err;
         }
@@ -3379,7 +6372,7 @@ flexi_write_typed_vector_uint(flexi_writer_s *writer, const char *key,
         }
 
         // Write values.
-        if (!ostream_write(&writer->ostream, ptr, len * stride_bytes)) {
+        if (!writer_write(writer, ptr, len * stride_bytes)) {
             writer->err = FLEXI_ERR_BADWRITE;
             return writer->err;
         }
@@ -3412,7 +6405,7 @@ flexi_write_typed_vector_uint(flexi_writer_s *writer, const char *key,
         }
 
         // Write values.
-        if (!ostream_write(&writer->ostream, ptr, len * stride_bytes)) {
+        if (!writer_write(writer, ptr, len * stride_bytes)) {
             writer->err = FLEXI_ERR_BADWRITE;
             return writer->err;
         }
@@ -3454,7 +6447,7 @@ flexi_write_typed_vector_flt(flexi_writer_s *writer, const char *key,
         }
 
         // Write values.
-        if (!ostream_write(&writer->ostream, ptr, len * stride_bytes)) {
+        if (!writer_write(writer, ptr, len * stride_bytes)) {
             writer->err = FLEXI_ERR_BADWRITE;
             return writer->err;
         }
@@ -3487,7 +6480,7 @@ flexi_write_typed_vector_flt(flexi_writer_s *writer, const char *key,
         }
 
         // Write values.
-        if (!ostream_write(&writer->ostream, ptr, len * stride_bytes)) {
+        if (!writer_write(writer, ptr, len * stride_bytes)) {
             writer->err = FLEXI_ERR_BADWRITE;
             return writer->err;
         }
@@ -3532,7 +6525,7 @@ flexi_write_blob(flexi_writer_s *writer, const char *key, const void *ptr,
     }
 
     // Write the blob.
-    if (!ostream_write(&writer->ostream, ptr, len)) {
+    if (!writer_write(writer, ptr, len)) {
         writer->err = FLEXI_ERR_BADWRITE;
         return writer->err;
     }
@@ -3592,13 +6585,13 @@ flexi_write_typed_vector_bool(flexi_writer_s *writer, const char *key,
 
     // Keep track of the base location of the vector.
     flexi_ssize_t offset;
-    if (!ostream_tell(&writer->ostream, &offset)) {
+    if (!writer_tell(writer, &offset)) {
         writer->err = FLEXI_ERR_BADWRITE;
         return writer->err;
     }
 
     // Write values.
-    if (!ostream_write(&writer->ostream, ptr, len * sizeof(bool))) {
+    if (!writer_write(writer, ptr, len * sizeof(bool))) {
         writer->err = FLEXI_ERR_BADWRITE;
         return writer->err;
     }
@@ -3618,8 +6611,8 @@ flexi_write_typed_vector_bool(flexi_writer_s *writer, const char *key,
 
 /******************************************************************************/
 
-flexi_result_e
-flexi_write_finalize(flexi_writer_s *writer)
+static flexi_result_e
+write_finalize(flexi_writer_s *writer)
 {
     if (FLEXI_ERROR(writer->err)) {
         return FLEXI_ERR_FAILSAFE;
@@ -3632,12 +6625,16 @@ flexi_write_finalize(flexi_writer_s *writer)
         return writer->err;
     }
 
+    // The root value, its type and its width are written together.
+    writer_stage_s stage;
+    stage_init(&stage, writer);
+
     if (type_is_direct(root->type)) {
         switch (root->type) {
         case FLEXI_TYPE_NULL: {
             // Write out the null root type.
             const uint8_t buffer[3] = {0x00, 0x00, 0x01};
-            if (!ostream_write(&writer->ostream, buffer, COUNTOF(buffer))) {
+            if (!writer_write(writer, buffer, COUNTOF(buffer))) {
                 writer->err = FLEXI_ERR_BADWRITE;
                 return writer->err;
             }
@@ -3645,7 +6642,7 @@ flexi_write_finalize(flexi_writer_s *writer)
         }
         case FLEXI_TYPE_SINT: {
             // Write the number.
-            if (!write_sint_by_width(writer, root->u.s64, root->width)) {
+            if (!stage_sint_by_width(&stage, root->u.s64, root->width)) {
                 writer->err = FLEXI_ERR_BADWRITE;
                 return writer->err;
             }
@@ -3653,13 +6650,18 @@ flexi_write_finalize(flexi_writer_s *writer)
             // Write the type.
             flexi_packed_t type =
                 PACK_TYPE(root->type) | PACK_WIDTH(root->width);
-            if (!ostream_write(&writer->ostream, &type, 1)) {
+            if (!stage_uint_by_width(&stage, type, 1)) {
                 writer->err = FLEXI_ERR_BADWRITE;
                 return writer->err;
             }
 
             // Write the width.
-            if (!ostream_write(&writer->ostream, &root->width, 1)) {
+            if (!stage_uint_by_width(&stage, root->width, 1)) {
+                writer->err = FLEXI_ERR_BADWRITE;
+                return writer->err;
+            }
+
+            if (!stage_flush(&stage)) {
                 writer->err = FLEXI_ERR_BADWRITE;
                 return writer->err;
             }
@@ -3668,7 +6670,7 @@ flexi_write_finalize(flexi_writer_s *writer)
         }
         case FLEXI_TYPE_UINT: {
             // Write the number.
-            if (!write_uint_by_width(writer, root->u.u64, root->width)) {
+            if (!stage_uint_by_width(&stage, root->u.u64, root->width)) {
                 writer->err = FLEXI_ERR_BADWRITE;
                 return writer->err;
             }
@@ -3676,13 +6678,18 @@ flexi_write_finalize(flexi_writer_s *writer)
             // Write the type.
             flexi_packed_t type =
                 PACK_TYPE(root->type) | PACK_WIDTH(root->width);
-            if (!ostream_write(&writer->ostream, &type, 1)) {
+            if (!stage_uint_by_width(&stage, type, 1)) {
                 writer->err = FLEXI_ERR_BADWRITE;
                 return writer->err;
             }
 
             // Write the width.
-            if (!ostream_write(&writer->ostream, &root->width, 1)) {
+            if (!stage_uint_by_width(&stage, root->width, 1)) {
+                writer->err = FLEXI_ERR_BADWRITE;
+                return writer->err;
+            }
+
+            if (!stage_flush(&stage)) {
                 writer->err = FLEXI_ERR_BADWRITE;
                 return writer->err;
             }
@@ -3693,13 +6700,13 @@ flexi_write_finalize(flexi_writer_s *writer)
             // Write the number.
             switch (root->width) {
             case 4:
-                if (!write_f32(writer, root->u.f32, root->width)) {
+                if (!stage_f32(&stage, root->u.f32, root->width)) {
                     writer->err = FLEXI_ERR_BADWRITE;
                     return writer->err;
                 }
                 break;
             case 8:
-                if (!write_f64(writer, root->u.f64, root->width)) {
+                if (!stage_f64(&stage, root->u.f64, root->width)) {
                     writer->err = FLEXI_ERR_BADWRITE;
                     return writer->err;
                 }
@@ -3710,13 +6717,18 @@ flexi_write_finalize(flexi_writer_s *writer)
             // Write the type.
             flexi_packed_t type =
                 PACK_TYPE(root->type) | PACK_WIDTH(root->width);
-            if (!ostream_write(&writer->ostream, &type, 1)) {
+            if (!stage_uint_by_width(&stage, type, 1)) {
                 writer->err = FLEXI_ERR_BADWRITE;
                 return writer->err;
             }
 
             // Write the width.
-            if (!ostream_write(&writer->ostream, &root->width, 1)) {
+            if (!stage_uint_by_width(&stage, root->width, 1)) {
+                writer->err = FLEXI_ERR_BADWRITE;
+                return writer->err;
+            }
+
+            if (!stage_flush(&stage)) {
                 writer->err = FLEXI_ERR_BADWRITE;
                 return writer->err;
             }
@@ -3726,20 +6738,25 @@ flexi_write_finalize(flexi_writer_s *writer)
         case FLEXI_TYPE_BOOL: {
             // Write the boolean.
             bool value = root->u.u64 ? 1 : 0;
-            if (!ostream_write(&writer->ostream, &value, 1)) {
+            if (!stage_uint_by_width(&stage, value, 1)) {
                 writer->err = FLEXI_ERR_BADWRITE;
                 return writer->err;
             }
 
             // Write the type.
             flexi_packed_t type = PACK_TYPE(root->type) | FLEXI_WIDTH_1B;
-            if (!ostream_write(&writer->ostream, &type, 1)) {
+            if (!stage_uint_by_width(&stage, type, 1)) {
                 writer->err = FLEXI_ERR_BADWRITE;
                 return writer->err;
             }
 
             // Write the width.
-            if (!ostream_write(&writer->ostream, &root->width, 1)) {
+            if (!stage_uint_by_width(&stage, root->width, 1)) {
+                writer->err = FLEXI_ERR_BADWRITE;
+                return writer->err;
+            }
+
+            if (!stage_flush(&stage)) {
                 writer->err = FLEXI_ERR_BADWRITE;
                 return writer->err;
             }
@@ -3751,7 +6768,7 @@ flexi_write_finalize(flexi_writer_s *writer)
     } else if (type_is_indirect(root->type)) {
         // Get the current location.
         flexi_ssize_t current;
-        if (!ostream_tell(&writer->ostream, &current)) {
+        if (!writer_tell(writer, &current)) {
             writer->err = FLEXI_ERR_BADWRITE;
             return writer->err;
         }
@@ -3759,20 +6776,25 @@ flexi_write_finalize(flexi_writer_s *writer)
         // Create the offset and figure out its witdh.
         flexi_ssize_t offset = current - root->u.offset;
         int width = UINT_WIDTH(offset);
-        if (!write_uint_by_width(writer, offset, width)) {
+        if (!stage_uint_by_width(&stage, offset, width)) {
             writer->err = FLEXI_ERR_BADWRITE;
             return writer->err;
         }
 
         // Write the type that the offset is pointing to.
         flexi_packed_t type = PACK_TYPE(root->type) | PACK_WIDTH(root->width);
-        if (!write_uint_by_width(writer, type, 1)) {
+        if (!stage_uint_by_width(&stage, type, 1)) {
             writer->err = FLEXI_ERR_BADWRITE;
             return writer->err;
         }
 
         // Write the width of the offset.
-        if (!write_sint_by_width(writer, width, 1)) {
+        if (!stage_sint_by_width(&stage, width, 1)) {
+            writer->err = FLEXI_ERR_BADWRITE;
+            return writer->err;
+        }
+
+        if (!stage_flush(&stage)) {
             writer->err = FLEXI_ERR_BADWRITE;
             return writer->err;
         }
@@ -3782,10 +6804,28 @@ flexi_write_finalize(flexi_writer_s *writer)
             return writer->err;
         }
 
-        return FLEXI_OK;
+        return FLEXI_OK;
+    }
+
+    return FLEXI_ERR_INTERNAL;
+}
+
+/******************************************************************************/
+
+flexi_result_e
+flexi_write_finalize(flexi_writer_s *writer)
+{
+    flexi_result_e res = write_finalize(writer);
+    if (res != FLEXI_OK) {
+        return res;
+    }
+
+    if (!writer_flush(writer)) {
+        writer->err = FLEXI_ERR_BADWRITE;
+        return writer->err;
     }
 
-    return FLEXI_ERR_INTERNAL;
+    return FLEXI_OK;
 }
 
 /******************************************************************************/
@@ -3815,35 +6855,12 @@ flexi_writer_debug_stack_count(flexi_writer_s *writer)
 
 #if FLEXI_FEATURE_PARSER
 
-typedef struct foreach_ctx_s {
-    const flexi_parser_s *parser;
-    void *user;
-    parse_limits_s *limits;
-    flexi_result_e err;
-} foreach_ctx_s;
-
-static flexi_result_e
-parse_cursor(const flexi_parser_s *parser, const char *key,
-    const flexi_cursor_s *cursor, void *user, parse_limits_s *limits);
+STATIC_ASSERT(FLEXI_CONFIG_MAX_DEPTH > 1, max_depth_must_allow_nesting);
 
 /**
- * @brief For each value, parse the cursor.
+ * @brief State of an in-progress parse.
  */
-static bool
-parser_emit_foreach(const char *key, flexi_cursor_s *value, void *user)
-{
-    foreach_ctx_s *ctx = (foreach_ctx_s *)user;
-
-    flexi_result_e res =
-        parse_cursor(ctx->parser, key, value, ctx->user, ctx->limits);
-
-    if (FLEXI_ERROR(res)) {
-        ctx->err = res;
-        return false;
-    }
-
-    return true;
-}
+typedef flexi_parse_ctx_s parse_ctx_s;
 
 /**
  * @brief Call the float callback.
@@ -3880,100 +6897,285 @@ parser_emit_flt(const flexi_parser_s *parser, const char *key,
 }
 
 /**
- * @brief Call the map callbacks and iterate map values.
+ * @brief Call the map or vector begin callback.
  *
- * @param[in] parser Parser to operate on.
+ * @param[in] ctx Parse context.
  * @param[in] key Key of value.
- * @param[in] cursor Location of cursor to read with.
- * @param[in] user User pointer.
- * @param[in] limits Parse limit tracking.
- * @return FLEXI_OK || FLEXI_ERR_CALLBACK || FLEXI_ERR_BADREAD.
+ * @param[in] cursor Cursor pointing at map or vector.
+ * @return Whether to abort, parse or skip the values of the map or vector.
+ */
+static flexi_visit_e
+parser_begin(const parse_ctx_s *ctx, const char *key,
+    const flexi_cursor_s *cursor)
+{
+    const flexi_parser_s *parser = ctx->parser;
+    bool ok;
+    if (cursor->type == FLEXI_TYPE_MAP) {
+        if (ctx->map_begin) {
+            return ctx->map_begin(key, cursor->length, ctx->user);
+        }
+        ok = parser->map_begin(key, cursor->length, ctx->user);
+    } else {
+        if (ctx->vector_begin) {
+            return ctx->vector_begin(key, cursor->length, ctx->user);
+        }
+        ok = parser->vector_begin(key, cursor->length, ctx->user);
+    }
+    return ok ? FLEXI_VISIT_CONTINUE : FLEXI_VISIT_ABORT;
+}
+
+/**
+ * @brief Call the map or vector end callback.
+ *
+ * @param[in] ctx Parse context.
+ * @param[in] type Type of map or vector.
+ * @return FLEXI_OK || FLEXI_ERR_CALLBACK.
  */
 static flexi_result_e
-parser_emit_map(const flexi_parser_s *parser, const char *key,
-    const flexi_cursor_s *cursor, void *user, parse_limits_s *limits)
+parser_end(const parse_ctx_s *ctx, flexi_type_e type)
 {
-    ASSERT(cursor->type == FLEXI_TYPE_MAP);
+    const flexi_parser_s *parser = ctx->parser;
+    bool ok = type == FLEXI_TYPE_MAP ? parser->map_end(ctx->user)
+                                     : parser->vector_end(ctx->user);
+    return ok ? FLEXI_OK : FLEXI_ERR_CALLBACK;
+}
 
-    foreach_ctx_s ctx;
-    ctx.parser = parser;
-    ctx.user = user;
-    ctx.limits = limits;
-    ctx.err = FLEXI_INVALID;
+/**
+ * @brief Number of uint32_t in each slot of the visited set: the offset + 1
+ *        where 0 is empty, the packed type and width, and the id.
+ */
+#define VISITED_SLOT_LEN (3)
 
-    ctx.limits->depth += 1;
-    if (limits->depth >= FLEXI_CONFIG_MAX_DEPTH) {
-        // Prevent stack overflows.
-        return FLEXI_ERR_PARSELIMIT;
-    }
+/**
+ * @brief Hash the offset, type and width of a map or vector in the visited
+ *        set.
+ *
+ * @param[in] offset Offset to hash.
+ * @param[in] packed Packed type and width to hash.
+ * @return Hash of offset, type and width.
+ */
+static uint32_t
+hash_offset(uint32_t offset, uint32_t packed)
+{
+    uint32_t hash = (offset ^ (packed << 24)) * UINT32_C(2654435761);
+    return hash ^ (hash >> 16);
+}
 
-    if (!parser->map_begin(key, cursor->length, user)) {
-        return FLEXI_ERR_CALLBACK;
+/**
+ * @brief Return the packed type and width of a map or vector, which must
+ *        both match for two references to be the same map or vector.
+ */
+static uint32_t
+parse_visited_packed(const flexi_cursor_s *cursor)
+{
+    return PACK_TYPE(cursor->type) | PACK_WIDTH(cursor->width);
+}
+
+/**
+ * @brief Find the slot in the visited set for a map or vector.
+ *
+ * @param[in] ctx Parse context.
+ * @param[in] cursor Cursor pointing at map or vector.
+ * @param[out] slot Slot holding the map or vector, or the empty slot it
+ *                  would be inserted at.
+ * @return True if the map or vector is in the set.
+ */
+static bool
+parse_visited_find(const parse_ctx_s *ctx, const flexi_cursor_s *cursor,
+    flexi_ssize_t *slot)
+{
+    // The same bytes can be read as a map or vector of another type or
+    // width, so those have to match as well as the offset.
+    uint32_t key = (uint32_t)(cursor->cursor - cursor->msg.data) + 1;
+    uint32_t packed = parse_visited_packed(cursor);
+    flexi_ssize_t mask = ctx->visited_capacity - 1;
+    flexi_ssize_t i = (flexi_ssize_t)hash_offset(key, packed) & mask;
+    for (;;) {
+        const uint32_t *entry = &ctx->visited[i * VISITED_SLOT_LEN];
+        uint32_t found = entry[0];
+        if (found == key && entry[1] == packed) {
+            *slot = i;
+            return true;
+        } else if (found == 0) {
+            *slot = i;
+            return false;
+        }
+        i = (i + 1) & mask;
     }
+}
 
-    flexi_result_e res = cursor_foreach_map(cursor, parser_emit_foreach, &ctx);
-    if (FLEXI_ERROR(res)) {
-        return res;
-    } else if (FLEXI_ERROR(ctx.err)) {
-        return ctx.err;
+/**
+ * @brief If the map or vector at the cursor has already been parsed, call
+ *        the shared callback instead of parsing it again.
+ *
+ * @param[in] ctx Parse context.
+ * @param[in] key Key of value.
+ * @param[in] cursor Cursor pointing at map or vector.
+ * @param[out] slot Slot to remember the map or vector in once it's parsed,
+ *                  or -1 if it can't be remembered.
+ * @param[out] handled True if the shared callback was called.
+ * @return FLEXI_OK || FLEXI_ERR_CALLBACK.
+ */
+static flexi_result_e
+parse_visited_check(const parse_ctx_s *ctx, const char *key,
+    const flexi_cursor_s *cursor, flexi_ssize_t *slot, bool *handled)
+{
+    *slot = -1;
+    *handled = false;
+    if (cursor->cursor - cursor->msg.data >= (flexi_ssize_t)UINT32_MAX) {
+        // Too far into the message to track.
+        return FLEXI_OK;
     }
 
-    if (!parser->map_end(user)) {
-        return FLEXI_ERR_CALLBACK;
+    flexi_ssize_t found;
+    if (!parse_visited_find(ctx, cursor, &found)) {
+        if (ctx->visited_count <
+                ctx->visited_capacity - (ctx->visited_capacity / 4) &&
+            ctx->begun < (flexi_ssize_t)UINT32_MAX) {
+            // Keep the load factor under 75%.
+            *slot = found;
+        }
+        return FLEXI_OK;
     }
 
-    ctx.limits->depth -= 1;
-    return FLEXI_OK;
+    *handled = true;
+    flexi_ssize_t id =
+        (flexi_ssize_t)ctx->visited[found * VISITED_SLOT_LEN + 2];
+    return ctx->shared(key, cursor->type, id, ctx->user) ? FLEXI_OK
+                                                         : FLEXI_ERR_CALLBACK;
 }
 
 /**
- * @brief Call the vector callbacks and iterate map values.
+ * @brief Call the map or vector begin callback and push a frame for
+ *        iterating its values.
  *
- * @param[in] parser Parser to operate on.
+ * @param[in,out] ctx Parse context.
  * @param[in] key Key of value.
- * @param[in] cursor Location of cursor to read with.
- * @param[in] user User pointer.
- * @param[in] limits Parse limit tracking.
- * @return FLEXI_OK || FLEXI_ERR_CALLBACK || FLEXI_ERR_BADREAD.
+ * @param[in] cursor Cursor pointing at map or vector.
+ * @param[in] live Filters which the values of the map or vector might
+ *                 match, or 0 if every value should be parsed.
+ * @return FLEXI_OK || FLEXI_ERR_CALLBACK || FLEXI_ERR_PARSELIMIT.
  */
 static flexi_result_e
-parser_emit_vector(const flexi_parser_s *parser, const char *key,
-    const flexi_cursor_s *cursor, void *user, parse_limits_s *limits)
+parser_push(parse_ctx_s *ctx, const char *key, const flexi_cursor_s *cursor,
+    uint32_t live)
 {
-    ASSERT(cursor->type == FLEXI_TYPE_VECTOR);
-
-    foreach_ctx_s ctx;
-    ctx.parser = parser;
-    ctx.user = user;
-    ctx.limits = limits;
-    ctx.err = FLEXI_INVALID;
+    flexi_ssize_t slot = -1;
+    if (ctx->visited != NULL && live == 0) {
+        bool handled;
+        flexi_result_e res =
+            parse_visited_check(ctx, key, cursor, &slot, &handled);
+        if (handled || FLEXI_ERROR(res)) {
+            return res;
+        }
+    }
 
-    ctx.limits->depth += 1;
-    if (limits->depth >= FLEXI_CONFIG_MAX_DEPTH) {
-        // Prevent stack overflows.
+    ctx->iterables += 1;
+    if (ctx->iterables >= ctx->max_iterables) {
+        // Defuse FlexBuffer "bomb" inputs.
         return FLEXI_ERR_PARSELIMIT;
     }
 
-    if (!parser->vector_begin(key, cursor->length, user)) {
-        return FLEXI_ERR_CALLBACK;
+    if (ctx->depth >= ctx->frames_len) {
+        // Out of frames to nest into.
+        return FLEXI_ERR_PARSELIMIT;
     }
 
-    flexi_result_e res =
-        cursor_foreach_untyped_vector(cursor, parser_emit_foreach, &ctx);
-    if (FLEXI_ERROR(res)) {
-        return res;
-    } else if (FLEXI_ERROR(ctx.err)) {
-        return ctx.err;
+    flexi_ssize_t id = ctx->begun;
+    ctx->begun += 1;
+    switch (parser_begin(ctx, key, cursor)) {
+    case FLEXI_VISIT_CONTINUE: break;
+    case FLEXI_VISIT_SKIP: return parser_end(ctx, cursor->type);
+    default: return FLEXI_ERR_CALLBACK;
     }
 
-    if (!parser->vector_end(user)) {
-        return FLEXI_ERR_CALLBACK;
+    if (slot >= 0) {
+        // Later references to this map or vector can skip it.
+        uint32_t *entry = &ctx->visited[slot * VISITED_SLOT_LEN];
+        entry[0] = (uint32_t)(cursor->cursor - cursor->msg.data) + 1;
+        entry[1] = parse_visited_packed(cursor);
+        entry[2] = (uint32_t)id;
+        ctx->visited_count += 1;
     }
 
-    ctx.limits->depth -= 1;
+    flexi_parse_frame_s *frame = &ctx->frames[ctx->depth];
+    cursor_iter_begin(cursor, &frame->iter);
+    frame->live = live;
+    ctx->depth += 1;
     return FLEXI_OK;
 }
 
+/**
+ * @brief Pop the innermost frame and call the map or vector end callback.
+ *
+ * @param[in,out] ctx Parse context.
+ * @return FLEXI_OK || FLEXI_ERR_CALLBACK.
+ */
+static flexi_result_e
+parser_pop(parse_ctx_s *ctx)
+{
+    ASSERT(ctx->depth > 0);
+
+    ctx->depth -= 1;
+    return parser_end(ctx, ctx->frames[ctx->depth].iter.cursor.type);
+}
+
+/**
+ * @brief Check if a single step of a filter matches a value.
+ *
+ * @param[in] step Step to check.
+ * @param[in] key Key of value, or NULL if value is not in a map.
+ * @param[in] index Index of value.
+ * @return True if the step matches.
+ */
+static bool
+parse_filter_step_matches(const flexi_path_step_s *step, const char *key,
+    flexi_ssize_t index)
+{
+    if (step->key_len == 1 && step->key[0] == '*') {
+        return true;
+    } else if (key != NULL) {
+        return key_cmp(key, step->key, step->key_len) == 0;
+    }
+    return index >= step->first && index <= step->last;
+}
+
+/**
+ * @brief Find which filters still match a value inside a map or vector.
+ *
+ * @param[in] ctx Parse context.
+ * @param[in] live Filters which matched the map or vector.
+ * @param[in] depth Number of steps taken to reach the map or vector.
+ * @param[in] key Key of value, or NULL if value is not in a map.
+ * @param[in] index Index of value.
+ * @param[out] next Filters which might match values inside the value, or
+ *                  0 if a filter matched the value itself.
+ * @return True if the value should be parsed.
+ */
+static bool
+parse_filter_value(const parse_ctx_s *ctx, uint32_t live,
+    flexi_ssize_t depth, const char *key, flexi_ssize_t index, uint32_t *next)
+{
+    *next = 0;
+    for (int i = 0; i < ctx->filters_len; i++) {
+        const flexi_path_s *filter = &ctx->filters[i];
+        if ((live & (1u << i)) == 0 ||
+            !parse_filter_step_matches(&filter->steps[depth], key, index)) {
+            continue;
+        }
+
+        if (filter->count == depth + 1) {
+            // Everything inside this value is wanted.
+            *next = 0;
+            return true;
+        }
+
+        *next |= 1u << i;
+    }
+
+    return *next != 0;
+}
+
 /**
  * @brief Call the vector callbacks and iterate keys in vector.
  *
@@ -3999,7 +7201,7 @@ parser_emit_vector_keys(const flexi_parser_s *parser, const char *key,
         }
 
         const char *dest = NULL;
-        if (!span_seek_back(&cursor->msg, offset_ptr, offset, &dest)) {
+        if (!cursor_seek_back(cursor, offset_ptr, offset, &dest)) {
             return FLEXI_ERR_BADREAD;
         }
 
@@ -4011,19 +7213,28 @@ parser_emit_vector_keys(const flexi_parser_s *parser, const char *key,
 }
 
 /**
- * @brief Call the appropriate parser callbacks at the given cursor.
+ * @brief Call the appropriate parser callbacks at the given cursor.  Maps
+ *        and vectors are pushed onto the frame stack instead of being
+ *        iterated here.
  *
- * @param[in] parser Parser to operate on.
+ * @param[in,out] ctx Parse context.
  * @param[in] key Key of cursor.
  * @param[in] cursor Location of cursor to read with.
- * @param[in] user User pointer.
- * @param[in] limits Parse limit tracking.
+ * @param[in] live Filters which values inside the cursor might match, or 0
+ *                 if the cursor should be parsed in its entirety.
  * @return FLEXI_OK || FLEXI_ERR_BADREAD || FLEXI_ERR_PARSELIMIT.
  */
 static flexi_result_e
-parse_cursor(const flexi_parser_s *parser, const char *key,
-    const flexi_cursor_s *cursor, void *user, parse_limits_s *limits)
+parse_cursor(parse_ctx_s *ctx, const char *key, const flexi_cursor_s *cursor,
+    uint32_t live)
 {
+    if (live != 0 && !type_is_map_or_untyped_vector(cursor->type)) {
+        // Leads to a filter, but there's nothing inside that could match.
+        return FLEXI_OK;
+    }
+
+    const flexi_parser_s *parser = ctx->parser;
+    void *user = ctx->user;
     switch (cursor->type) {
     case FLEXI_TYPE_NULL:
         return parser->null(key, user) ? FLEXI_OK : FLEXI_ERR_CALLBACK;
@@ -4057,20 +7268,7 @@ parse_cursor(const flexi_parser_s *parser, const char *key,
                    : FLEXI_ERR_CALLBACK;
     }
     case FLEXI_TYPE_MAP:
-        limits->iterables += 1;
-        if (limits->iterables >= FLEXI_CONFIG_MAX_ITERABLES) {
-            // Defuse FlexBuffer "bomb" inputs.
-            return FLEXI_ERR_PARSELIMIT;
-        }
-        return parser_emit_map(parser, key, cursor, user, limits);
-    case FLEXI_TYPE_VECTOR: {
-        limits->iterables += 1;
-        if (limits->iterables >= FLEXI_CONFIG_MAX_ITERABLES) {
-            // Defuse FlexBuffer "bomb" inputs.
-            return FLEXI_ERR_PARSELIMIT;
-        }
-        return parser_emit_vector(parser, key, cursor, user, limits);
-    }
+    case FLEXI_TYPE_VECTOR: return parser_push(ctx, key, cursor, live);
     case FLEXI_TYPE_VECTOR_SINT:
     case FLEXI_TYPE_VECTOR_UINT:
     case FLEXI_TYPE_VECTOR_FLOAT:
@@ -4117,14 +7315,337 @@ parse_cursor(const flexi_parser_s *parser, const char *key,
     return FLEXI_ERR_INTERNAL;
 }
 
+/**
+ * @brief If the next value of an untyped vector is a direct scalar with a
+ *        batch callback, decode it and every following value of the same
+ *        type into the batch buffer and call the batch callback.
+ *
+ * @param[in] ctx Parse context.
+ * @param[in,out] iter Iterator over untyped vector, which is advanced past
+ *                     every value in the batch.
+ * @param[out] handled True if a batch was decoded.
+ * @return FLEXI_OK || FLEXI_ERR_CALLBACK.
+ */
+static flexi_result_e
+parse_batch(const parse_ctx_s *ctx, flexi_iter_s *iter, bool *handled)
+{
+    const flexi_cursor_s *cursor = &iter->cursor;
+    ASSERT(cursor->type == FLEXI_TYPE_VECTOR);
+    ASSERT(iter->index < cursor->length);
+
+    *handled = false;
+    const flexi_packed_t *types = cursor_vector_types(cursor);
+    flexi_type_e type = FLEXI_UNPACK_TYPE(types[iter->index]);
+    switch (type) {
+    case FLEXI_TYPE_SINT:
+        if (ctx->sint_batch == NULL) {
+            return FLEXI_OK;
+        }
+        break;
+    case FLEXI_TYPE_UINT:
+        if (ctx->uint_batch == NULL) {
+            return FLEXI_OK;
+        }
+        break;
+    case FLEXI_TYPE_FLOAT:
+        if (ctx->f64_batch == NULL || !WIDTH_IS_VALID_FLOAT(cursor->width)) {
+            return FLEXI_OK;
+        }
+        break;
+    default: return FLEXI_OK;
+    }
+
+    flexi_ssize_t first = iter->index;
+    flexi_ssize_t end = first + 1;
+    while (end < cursor->length && end - first < ctx->batch_len &&
+           FLEXI_UNPACK_TYPE(types[end]) == type) {
+        end += 1;
+    }
+
+    // Direct values of the same type are laid out like a typed vector.
+    const char *src = cursor->cursor + (first * cursor->width);
+    flexi_ssize_t count = end - first;
+    iter->index = end;
+    *handled = true;
+
+    bool ok = false;
+    switch (type) {
+    case FLEXI_TYPE_SINT: {
+        int64_t *values = (int64_t *)ctx->batch;
+        convert_to_i64(src, type, cursor->width, count, values);
+        ok = ctx->sint_batch(values, count, ctx->user);
+        break;
+    }
+    case FLEXI_TYPE_UINT: {
+        uint64_t *values = (uint64_t *)ctx->batch;
+        convert_to_u64(src, type, cursor->width, count, values);
+        ok = ctx->uint_batch(values, count, ctx->user);
+        break;
+    }
+    case FLEXI_TYPE_FLOAT: {
+        double *values = (double *)ctx->batch;
+        convert_to_f64(src, type, cursor->width, count, values);
+        ok = ctx->f64_batch(values, count, ctx->user);
+        break;
+    }
+    default: ASSERT(false); break;
+    }
+    return ok ? FLEXI_OK : FLEXI_ERR_CALLBACK;
+}
+
+/**
+ * @brief Parse the next value of the innermost frame, or pop the frame if
+ *        there are no values left.
+ *
+ * @param[in,out] ctx Parse context.
+ * @return FLEXI_OK || FLEXI_ERR_CALLBACK || FLEXI_ERR_BADREAD ||
+ *         FLEXI_ERR_PARSELIMIT.
+ */
+static flexi_result_e
+parse_next(parse_ctx_s *ctx)
+{
+    flexi_parse_frame_s *frame = &ctx->frames[ctx->depth - 1];
+    flexi_iter_s *iter = &frame->iter;
+    if (iter->index >= iter->cursor.length) {
+        return parser_pop(ctx);
+    }
+
+    if (ctx->batch_len > 0 && frame->live == 0 &&
+        iter->cursor.type == FLEXI_TYPE_VECTOR) {
+        bool handled;
+        flexi_result_e res = parse_batch(ctx, iter, &handled);
+        if (handled || FLEXI_ERROR(res)) {
+            return res;
+        }
+    }
+
+    const char *key;
+    if (!iter_key(iter, &key)) {
+        return FLEXI_ERR_BADREAD;
+    }
+
+    flexi_ssize_t index = iter->index;
+    iter->index += 1;
+
+    uint32_t live = 0;
+    if (frame->live != 0 && !parse_filter_value(ctx, frame->live,
+                                ctx->depth - 1, key, index, &live)) {
+        // Skip the value without reading it.
+        return FLEXI_OK;
+    }
+
+    flexi_cursor_s each;
+    if (!cursor_seek_untyped_vector_index(&iter->cursor, index, &each)) {
+        return FLEXI_ERR_BADREAD;
+    }
+
+    return parse_cursor(ctx, key, &each, live);
+}
+
+/**
+ * @brief Parse the value at the root of the parse, then keep pulling values
+ *        from the innermost frame until every frame has been popped or the
+ *        budget runs out.
+ *
+ * @param[in,out] ctx Parse context.
+ * @param[in] budget Maximum number of values to parse, must be > 0.
+ * @return FLEXI_OK || FLEXI_INCOMPLETE || FLEXI_ERR_CALLBACK ||
+ *         FLEXI_ERR_BADREAD || FLEXI_ERR_PARSELIMIT.
+ */
+static flexi_result_e
+parse_run(parse_ctx_s *ctx, flexi_ssize_t budget)
+{
+    ASSERT(budget > 0);
+
+    flexi_result_e res = FLEXI_OK;
+    if (!ctx->started) {
+        uint32_t live = 0;
+        for (int i = 0; i < ctx->filters_len; i++) {
+            if (ctx->filters[i].count == 0) {
+                // Filter matches the whole message.
+                live = 0;
+                break;
+            }
+            live |= 1u << i;
+        }
+
+        ctx->started = true;
+        res = parse_cursor(ctx, NULL, &ctx->root, live);
+        ctx->values += 1;
+        budget -= 1;
+    }
+
+    while (FLEXI_SUCCESS(res) && ctx->depth > 0) {
+        if (ctx->max_values > 0 && ctx->values >= ctx->max_values) {
+            // Out of budget for the whole message.
+            return FLEXI_ERR_PARSELIMIT;
+        }
+
+        if (budget <= 0) {
+            return FLEXI_INCOMPLETE;
+        }
+
+        res = parse_next(ctx);
+        ctx->values += 1;
+        budget -= 1;
+    }
+    return res;
+}
+
+/******************************************************************************/
+
+flexi_ssize_t
+flexi_parse_visited_size(flexi_ssize_t count)
+{
+    flexi_ssize_t capacity = 2;
+    while (capacity < count * 2) {
+        capacity *= 2;
+    }
+    return capacity * (flexi_ssize_t)sizeof(uint32_t) * VISITED_SLOT_LEN;
+}
+
+/******************************************************************************/
+
+flexi_parse_options_s
+flexi_make_parse_options(flexi_parse_frame_s *frames, flexi_ssize_t frames_len)
+{
+    flexi_parse_options_s options;
+    options.frames = frames;
+    options.frames_len = frames_len;
+    options.filters = NULL;
+    options.filters_len = 0;
+    options.map_begin = NULL;
+    options.vector_begin = NULL;
+    options.batch = NULL;
+    options.batch_len = 0;
+    options.sint_batch = NULL;
+    options.uint_batch = NULL;
+    options.f64_batch = NULL;
+    options.visited = NULL;
+    options.visited_size = 0;
+    options.shared = NULL;
+    options.max_iterables = FLEXI_CONFIG_MAX_ITERABLES;
+    options.max_values = 0;
+    return options;
+}
+
 /******************************************************************************/
 
 flexi_result_e
 flexi_parse_cursor(const flexi_parser_s *parser, const flexi_cursor_s *cursor,
     void *user)
 {
-    parse_limits_s limits = {0};
-    return parse_cursor(parser, NULL, cursor, user, &limits);
+    // The outermost value does not need a frame of its own.
+    flexi_parse_frame_s frames[FLEXI_CONFIG_MAX_DEPTH - 1];
+    flexi_parse_options_s options =
+        flexi_make_parse_options(frames, FLEXI_CONFIG_MAX_DEPTH - 1);
+    return flexi_parse_cursor_ex(parser, cursor, user, &options);
+}
+
+/******************************************************************************/
+
+flexi_result_e
+flexi_parse_cursor_ex(const flexi_parser_s *parser,
+    const flexi_cursor_s *cursor, void *user,
+    const flexi_parse_options_s *options)
+{
+    flexi_parse_ctx_s ctx;
+    flexi_result_e res = flexi_parse_begin(&ctx, parser, cursor, user, options);
+    if (FLEXI_ERROR(res)) {
+        return res;
+    }
+
+    return flexi_parse_step(&ctx, FLEXI_SSIZE_MAX);
+}
+
+/******************************************************************************/
+
+flexi_result_e
+flexi_parse_begin(flexi_parse_ctx_s *ctx, const flexi_parser_s *parser,
+    const flexi_cursor_s *cursor, void *user,
+    const flexi_parse_options_s *options)
+{
+    if (options->frames_len < 0 ||
+        (options->frames == NULL && options->frames_len != 0)) {
+        return FLEXI_ERR_PARAM;
+    }
+
+    if (options->filters_len < 0 ||
+        options->filters_len > FLEXI_PARSE_MAX_FILTERS ||
+        (options->filters == NULL && options->filters_len != 0)) {
+        return FLEXI_ERR_PARAM;
+    }
+
+    if (options->batch_len < 0 ||
+        (options->batch == NULL && options->batch_len != 0)) {
+        return FLEXI_ERR_PARAM;
+    }
+
+    if (options->max_iterables <= 0 || options->max_values < 0) {
+        return FLEXI_ERR_PARAM;
+    }
+
+    flexi_ssize_t visited_capacity = 0;
+    if (options->visited != NULL) {
+        flexi_ssize_t max_slots = options->visited_size /
+            (flexi_ssize_t)(sizeof(uint32_t) * VISITED_SLOT_LEN);
+        visited_capacity = 1;
+        while (visited_capacity * 2 <= max_slots) {
+            visited_capacity *= 2;
+        }
+        if (visited_capacity < 2 || options->shared == NULL) {
+            return FLEXI_ERR_PARAM;
+        }
+
+        memset(options->visited, 0,
+            (size_t)visited_capacity * sizeof(uint32_t) * VISITED_SLOT_LEN);
+    }
+
+    ctx->parser = parser;
+    ctx->user = user;
+    ctx->frames = options->frames;
+    ctx->frames_len = options->frames_len;
+    ctx->filters = options->filters;
+    ctx->filters_len = options->filters_len;
+    ctx->map_begin = options->map_begin;
+    ctx->vector_begin = options->vector_begin;
+    ctx->batch = options->batch;
+    ctx->batch_len = options->batch_len;
+    ctx->sint_batch = options->sint_batch;
+    ctx->uint_batch = options->uint_batch;
+    ctx->f64_batch = options->f64_batch;
+    ctx->visited = (uint32_t *)options->visited;
+    ctx->visited_capacity = visited_capacity;
+    ctx->visited_count = 0;
+    ctx->shared = options->shared;
+    ctx->begun = 0;
+    ctx->depth = 0;
+    ctx->iterables = 0;
+    ctx->max_iterables = options->max_iterables;
+    ctx->values = 0;
+    ctx->max_values = options->max_values;
+    ctx->root = *cursor;
+    ctx->started = false;
+    ctx->result = FLEXI_INCOMPLETE;
+    return FLEXI_OK;
+}
+
+/******************************************************************************/
+
+flexi_result_e
+flexi_parse_step(flexi_parse_ctx_s *ctx, flexi_ssize_t budget)
+{
+    if (budget <= 0) {
+        return FLEXI_ERR_PARAM;
+    }
+
+    if (ctx->result != FLEXI_INCOMPLETE) {
+        // Parse has already finished.
+        return ctx->result;
+    }
+
+    ctx->result = parse_run(ctx, budget);
+    return ctx->result;
 }
 
 #endif // #if FLEXI_FEATURE_PARSER
@@ -4704,8 +8225,7 @@ flexi_json_from_cursor(const flexi_cursor_s *cursor,
     state.skip_comma = 1;
     state.depth = 0;
 
-    parse_limits_s limits = {0};
-    return parse_cursor(&parser, NULL, cursor, &state, &limits);
+    return flexi_parse_cursor(&parser, cursor, &state);
 }
 
 /******************************************************************************/
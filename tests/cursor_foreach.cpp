@@ -209,3 +209,100 @@ TEST_CASE("flexi_cursor_foreach (Map)", "[cursor_foreach]")
         REQUIRE(UINT16_MAX == val);
     }
 }
+
+TEST_CASE("flexi_cursor_foreach (Errors)", "[cursor_foreach]")
+{
+    flexi_span_s span = flexi_make_span(g_test_map.data(), g_test_map.size());
+
+    flexi_cursor_s cursor;
+    REQUIRE(FLEXI_OK == flexi_open_span(&span, &cursor));
+
+    // Neither a scalar nor an error cursor can be iterated.
+    foreach_results_t results;
+    flexi_cursor_s value;
+    REQUIRE(FLEXI_OK == flexi_cursor_seek_map_key(&cursor, "bool", &value));
+    REQUIRE(FLEXI_ERR_BADTYPE ==
+            flexi_cursor_foreach(&value, &ForeachCB, &results));
+
+    REQUIRE(FLEXI_ERR_NOTFOUND ==
+            flexi_cursor_seek_map_key(&cursor, "missing", &value));
+    REQUIRE(FLEXI_ERR_BADTYPE ==
+            flexi_cursor_foreach(&value, &ForeachCB, &results));
+    REQUIRE(results.empty());
+}
+
+TEST_CASE("flexi_iter_next (Vector)", "[cursor_foreach]")
+{
+    flexi_span_s span =
+        flexi_make_span(g_test_vector.data(), g_test_vector.size());
+
+    flexi_cursor_s cursor;
+    REQUIRE(FLEXI_OK == flexi_open_span(&span, &cursor));
+
+    flexi_iter_s iter;
+    REQUIRE(FLEXI_OK == flexi_cursor_iter_begin(&cursor, &iter));
+
+    static constexpr std::array<flexi_type_e, 5> s_types = {FLEXI_TYPE_BOOL,
+        FLEXI_TYPE_SINT, FLEXI_TYPE_INDIRECT_SINT, FLEXI_TYPE_UINT,
+        FLEXI_TYPE_INDIRECT_UINT};
+
+    for (flexi_type_e type : s_types) {
+        const char *key = "";
+        flexi_cursor_s value;
+        REQUIRE(FLEXI_OK == flexi_iter_next(&iter, &key, &value));
+        REQUIRE(nullptr == key);
+        REQUIRE(type == flexi_cursor_type(&value));
+    }
+
+    flexi_cursor_s value;
+    REQUIRE(FLEXI_ERR_NOTFOUND == flexi_iter_next(&iter, nullptr, &value));
+    REQUIRE(FLEXI_TYPE_INVALID == flexi_cursor_type(&value));
+    REQUIRE(FLEXI_ERR_NOTFOUND == flexi_iter_next(&iter, nullptr, &value));
+}
+
+TEST_CASE("flexi_iter_next (Map)", "[cursor_foreach]")
+{
+    flexi_span_s span = flexi_make_span(g_test_map.data(), g_test_map.size());
+
+    flexi_cursor_s cursor;
+    REQUIRE(FLEXI_OK == flexi_open_span(&span, &cursor));
+
+    // Interleave two iterators over the same map.
+    flexi_iter_s first, second;
+    REQUIRE(FLEXI_OK == flexi_cursor_iter_begin(&cursor, &first));
+    REQUIRE(FLEXI_OK == flexi_cursor_iter_begin(&cursor, &second));
+
+    const char *key = nullptr;
+    flexi_cursor_s value;
+    REQUIRE(FLEXI_OK == flexi_iter_next(&first, &key, &value));
+    REQUIRE_THAT("bool", Equals(key));
+    REQUIRE(FLEXI_OK == flexi_iter_next(&first, &key, &value));
+    REQUIRE_THAT("indirect_sint", Equals(key));
+
+    REQUIRE(FLEXI_OK == flexi_iter_next(&second, &key, &value));
+    REQUIRE_THAT("bool", Equals(key));
+    REQUIRE(FLEXI_TYPE_BOOL == flexi_cursor_type(&value));
+
+    REQUIRE(FLEXI_OK == flexi_iter_next(&first, &key, &value));
+    REQUIRE_THAT("indirect_uint", Equals(key));
+    REQUIRE(FLEXI_TYPE_INDIRECT_UINT == flexi_cursor_type(&value));
+
+    uint64_t val;
+    REQUIRE(FLEXI_OK == flexi_cursor_uint(&value, &val));
+    REQUIRE(UINT32_MAX == val);
+}
+
+TEST_CASE("flexi_cursor_iter_begin (Errors)", "[cursor_foreach]")
+{
+    flexi_span_s span =
+        flexi_make_span(g_test_vector.data(), g_test_vector.size());
+
+    flexi_cursor_s cursor, value;
+    REQUIRE(FLEXI_OK == flexi_open_span(&span, &cursor));
+    REQUIRE(FLEXI_OK == flexi_cursor_seek_vector_index(&cursor, 1, &value));
+
+    flexi_iter_s iter;
+    REQUIRE(FLEXI_ERR_BADTYPE == flexi_cursor_iter_begin(&value, &iter));
+    REQUIRE(FLEXI_ERR_FAILSAFE == flexi_iter_next(&iter, nullptr, &value));
+    REQUIRE(FLEXI_TYPE_INVALID == flexi_cursor_type(&value));
+}
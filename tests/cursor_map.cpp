@@ -44,3 +44,231 @@ TEST_CASE("flexi_cursor_seek_map_key", "[cursor_map]")
     REQUIRE(FLEXI_OK ==
             flexi_cursor_seek_map_key(&cursor, "map-23", &curValue));
 }
+
+/******************************************************************************/
+
+static void
+WriteMapOfInts(TestWriterStrdup &writer, int count)
+{
+    flexi_writer_s *fwriter = writer.GetWriter();
+    for (int i = 0; i < count; i++) {
+        std::string key = "key-" + std::to_string(i);
+        REQUIRE(FLEXI_OK == flexi_write_sint(fwriter, key.c_str(), i));
+    }
+    REQUIRE(FLEXI_OK == flexi_write_map(fwriter, NULL, count, FLEXI_WIDTH_1B));
+    REQUIRE(FLEXI_OK == flexi_write_finalize(fwriter));
+}
+
+/******************************************************************************/
+
+TEST_CASE("flexi_cursor_seek_map_key_indexed", "[cursor_map]")
+{
+    TestWriterStrdup writer;
+    WriteMapOfInts(writer, 300);
+
+    flexi_cursor_s cursor{};
+    writer.GetCursor(&cursor);
+    REQUIRE(300 == flexi_cursor_length(&cursor));
+
+    std::vector<uint32_t> buffer(flexi_map_index_size(300) / sizeof(uint32_t));
+    flexi_map_index_s index{};
+    REQUIRE(FLEXI_OK == flexi_build_map_index(&cursor, buffer.data(),
+                            buffer.size() * sizeof(uint32_t), &index));
+
+    for (int i = 0; i < 300; i++) {
+        std::string key = "key-" + std::to_string(i);
+
+        flexi_cursor_s value{};
+        REQUIRE(FLEXI_OK == flexi_cursor_seek_map_key_indexed(&cursor, &index,
+                                key.c_str(), &value));
+
+        int64_t v = -1;
+        REQUIRE(FLEXI_OK == flexi_cursor_sint(&value, &v));
+        REQUIRE(i == v);
+    }
+
+    flexi_cursor_s value{};
+    REQUIRE(FLEXI_ERR_NOTFOUND ==
+            flexi_cursor_seek_map_key_indexed(&cursor, &index, "key-300",
+                &value));
+    REQUIRE(FLEXI_TYPE_INVALID == flexi_cursor_type(&value));
+}
+
+TEST_CASE("flexi_build_map_index errors", "[cursor_map]")
+{
+    TestWriterStrdup writer;
+    WriteMapOfInts(writer, 12);
+
+    flexi_cursor_s cursor{};
+    writer.GetCursor(&cursor);
+
+    // Sizes that can't be represented are rejected.
+    REQUIRE(0 == flexi_map_index_size(-1));
+    REQUIRE(0 == flexi_map_index_size(FLEXI_SSIZE_MAX));
+    REQUIRE(0 == flexi_map_index_size(FLEXI_SSIZE_MAX / 16));
+    REQUIRE(0 < flexi_map_index_size(FLEXI_SSIZE_MAX / 32));
+
+    // Buffer is too small to hold an index with a reasonable load factor.
+    std::array<uint32_t, 16> small{};
+    flexi_map_index_s index{};
+    REQUIRE(FLEXI_ERR_PARAM == flexi_build_map_index(&cursor, small.data(),
+                                   sizeof(small), &index));
+
+    std::array<uint32_t, 64> buffer{};
+    REQUIRE(FLEXI_OK == flexi_build_map_index(&cursor, buffer.data(),
+                            sizeof(buffer), &index));
+
+    // Index can't be used with a value that isn't the indexed map.
+    flexi_cursor_s value{}, dest{};
+    REQUIRE(FLEXI_OK == flexi_cursor_seek_map_key(&cursor, "key-1", &value));
+    REQUIRE(FLEXI_ERR_BADTYPE ==
+            flexi_cursor_seek_map_key_indexed(&value, &index, "key-1", &dest));
+    REQUIRE(FLEXI_ERR_BADTYPE == flexi_build_map_index(&value, buffer.data(),
+                                     sizeof(buffer), &index));
+}
+
+/******************************************************************************/
+
+TEST_CASE("flexi_cursor_seek_map_keys (Sorted)", "[cursor_map]")
+{
+    TestWriterStrdup writer;
+    WriteMapOfInts(writer, 40);
+
+    flexi_cursor_s cursor{};
+    writer.GetCursor(&cursor);
+
+    const char *keys[] = {"key-0", "key-10", "key-25", "key-39", "key-9"};
+    std::array<flexi_cursor_s, 5> dests{};
+    REQUIRE(FLEXI_OK ==
+            flexi_cursor_seek_map_keys(&cursor, keys, 5, dests.data()));
+
+    const int64_t expected[] = {0, 10, 25, 39, 9};
+    for (size_t i = 0; i < dests.size(); i++) {
+        int64_t v = -1;
+        REQUIRE(FLEXI_OK == flexi_cursor_sint(&dests[i], &v));
+        REQUIRE(expected[i] == v);
+    }
+}
+
+TEST_CASE("flexi_cursor_seek_map_keys (Unsorted)", "[cursor_map]")
+{
+    TestWriterStrdup writer;
+    WriteMapOfInts(writer, 40);
+
+    flexi_cursor_s cursor{};
+    writer.GetCursor(&cursor);
+
+    const char *keys[] = {"key-9", "key-25", "key-0", "key-39", "key-10",
+        "key-10"};
+    std::array<flexi_cursor_s, 6> dests{};
+    REQUIRE(FLEXI_OK ==
+            flexi_cursor_seek_map_keys(&cursor, keys, 6, dests.data()));
+
+    const int64_t expected[] = {9, 25, 0, 39, 10, 10};
+    for (size_t i = 0; i < dests.size(); i++) {
+        int64_t v = -1;
+        REQUIRE(FLEXI_OK == flexi_cursor_sint(&dests[i], &v));
+        REQUIRE(expected[i] == v);
+    }
+}
+
+TEST_CASE("flexi_cursor_seek_map_keys (Missing)", "[cursor_map]")
+{
+    TestWriterStrdup writer;
+    WriteMapOfInts(writer, 40);
+
+    flexi_cursor_s cursor{};
+    writer.GetCursor(&cursor);
+
+    const char *keys[] = {"aaa", "key-1", "key-100", "key-2", "zzz"};
+    std::array<flexi_cursor_s, 5> dests{};
+    REQUIRE(FLEXI_ERR_NOTFOUND ==
+            flexi_cursor_seek_map_keys(&cursor, keys, 5, dests.data()));
+
+    REQUIRE(FLEXI_TYPE_INVALID == flexi_cursor_type(&dests[0]));
+    REQUIRE(FLEXI_TYPE_SINT == flexi_cursor_type(&dests[1]));
+    REQUIRE(FLEXI_TYPE_INVALID == flexi_cursor_type(&dests[2]));
+    REQUIRE(FLEXI_TYPE_SINT == flexi_cursor_type(&dests[3]));
+    REQUIRE(FLEXI_TYPE_INVALID == flexi_cursor_type(&dests[4]));
+}
+
+/******************************************************************************/
+
+TEST_CASE("flexi_cursor_seek_map_key_cached", "[cursor_map]")
+{
+    TestWriterStrdup first, second, other;
+    WriteMapOfInts(first, 40);
+    WriteMapOfInts(second, 40);
+    WriteMapOfInts(other, 41);
+
+    flexi_cursor_s cursors[3];
+    first.GetCursor(&cursors[0]);
+    second.GetCursor(&cursors[1]);
+    other.GetCursor(&cursors[2]);
+
+    flexi_seek_cache_s cache = flexi_make_seek_cache();
+    flexi_cursor_s value{};
+    int64_t v = -1;
+
+    REQUIRE(FLEXI_OK == flexi_cursor_seek_map_key_cached(&cursors[0],
+                            "key-33", &cache, &value));
+    REQUIRE(FLEXI_OK == flexi_cursor_sint(&value, &v));
+    REQUIRE(33 == v);
+    REQUIRE(0 == cache.hits);
+    REQUIRE(1 == cache.misses);
+
+    // Same shape, so the remembered slot is used.
+    REQUIRE(FLEXI_OK == flexi_cursor_seek_map_key_cached(&cursors[1],
+                            "key-33", &cache, &value));
+    REQUIRE(FLEXI_OK == flexi_cursor_sint(&value, &v));
+    REQUIRE(33 == v);
+    REQUIRE(1 == cache.hits);
+    REQUIRE(1 == cache.misses);
+
+    // Different shape falls back to a search.
+    REQUIRE(FLEXI_OK == flexi_cursor_seek_map_key_cached(&cursors[2],
+                            "key-33", &cache, &value));
+    REQUIRE(FLEXI_OK == flexi_cursor_sint(&value, &v));
+    REQUIRE(33 == v);
+    REQUIRE(1 == cache.hits);
+    REQUIRE(2 == cache.misses);
+
+    // Same shape, but a different key is at the remembered slot.
+    REQUIRE(FLEXI_OK == flexi_cursor_seek_map_key_cached(&cursors[2],
+                            "key-34", &cache, &value));
+    REQUIRE(FLEXI_OK == flexi_cursor_sint(&value, &v));
+    REQUIRE(34 == v);
+    REQUIRE(1 == cache.hits);
+    REQUIRE(3 == cache.misses);
+
+    REQUIRE(FLEXI_ERR_NOTFOUND == flexi_cursor_seek_map_key_cached(
+                                      &cursors[2], "nope", &cache, &value));
+    REQUIRE(FLEXI_TYPE_INVALID == flexi_cursor_type(&value));
+}
+
+/******************************************************************************/
+
+TEST_CASE("flexi_open_span (Map keys length mismatch)", "[cursor_map]")
+{
+    TestWriter writer;
+    flexi_writer_s *fwriter = writer.GetWriter();
+    REQUIRE(FLEXI_OK == flexi_write_uint(fwriter, "bbb", 1));
+    REQUIRE(FLEXI_OK == flexi_write_uint(fwriter, "ccc", 2));
+    REQUIRE(FLEXI_OK == flexi_write_map(fwriter, NULL, 2, FLEXI_WIDTH_1B));
+    REQUIRE(FLEXI_OK == flexi_write_finalize(fwriter));
+
+    flexi_ssize_t size = 0;
+    REQUIRE(writer.GetActual().Tell(&size));
+    std::vector<uint8_t> data(writer.GetActual().DataAt(0),
+        writer.GetActual().DataAt(0) + size);
+
+    flexi_span_s span = flexi_make_span(data.data(), data.size());
+    flexi_cursor_s cursor{};
+    REQUIRE(FLEXI_OK == flexi_open_span(&span, &cursor));
+
+    // Key vector claims to hold one more key than the map has values.
+    REQUIRE(2 == data[8]);
+    data[8] = 3;
+    REQUIRE(FLEXI_ERR_BADREAD == flexi_open_span(&span, &cursor));
+    REQUIRE(FLEXI_TYPE_INVALID == flexi_cursor_type(&cursor));
+}
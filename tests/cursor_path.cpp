@@ -0,0 +1,121 @@
+//
+// FlexiC - A standalone FlexBuffer reader/writer in C
+//
+// (C) 2025 Lexi Mayfield
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+
+#include "tests.hpp"
+
+/******************************************************************************/
+
+static void
+WriteNestedDoc(TestWriter &writer)
+{
+    flexi_writer_s *fwriter = writer.GetWriter();
+
+    REQUIRE(FLEXI_OK == flexi_write_sint(fwriter, "3", 33));
+    REQUIRE(FLEXI_OK == flexi_write_string(fwriter, "key-49", "v-50-49", 7));
+    REQUIRE(FLEXI_OK == flexi_write_sint(fwriter, NULL, 10));
+    REQUIRE(FLEXI_OK == flexi_write_sint(fwriter, NULL, 11));
+    REQUIRE(FLEXI_OK == flexi_write_sint(fwriter, NULL, 12));
+    REQUIRE(FLEXI_OK == flexi_write_sint(fwriter, NULL, 13));
+    REQUIRE(FLEXI_OK ==
+            flexi_write_vector(fwriter, "key-50", 4, FLEXI_WIDTH_1B));
+    REQUIRE(FLEXI_OK == flexi_write_map(fwriter, "map-50", 3, FLEXI_WIDTH_1B));
+    REQUIRE(FLEXI_OK == flexi_write_string(fwriter, "str", "hello", 5));
+    REQUIRE(FLEXI_OK == flexi_write_map(fwriter, NULL, 2, FLEXI_WIDTH_1B));
+    REQUIRE(FLEXI_OK == flexi_write_finalize(fwriter));
+}
+
+/******************************************************************************/
+
+TEST_CASE("flexi_compile_path", "[cursor_path]")
+{
+    std::array<flexi_path_step_s, 4> steps{};
+    flexi_path_s path{};
+
+    REQUIRE(FLEXI_OK ==
+            flexi_compile_path("/map-50/key-50/3", steps.data(), 4, &path));
+    REQUIRE(3 == path.count);
+
+    REQUIRE(FLEXI_OK == flexi_compile_path("", steps.data(), 4, &path));
+    REQUIRE(0 == path.count);
+
+    REQUIRE(FLEXI_ERR_PARAM ==
+            flexi_compile_path("map-50", steps.data(), 4, &path));
+    REQUIRE(FLEXI_ERR_PARAM ==
+            flexi_compile_path("/map-50//3", steps.data(), 4, &path));
+    REQUIRE(FLEXI_ERR_PARAM ==
+            flexi_compile_path("/map-50/", steps.data(), 4, &path));
+    REQUIRE(FLEXI_ERR_PARAM ==
+            flexi_compile_path("/a/b/c/d/e", steps.data(), 4, &path));
+}
+
+/******************************************************************************/
+
+TEST_CASE("flexi_cursor_seek_path", "[cursor_path]")
+{
+    TestWriterStrdup writer;
+    WriteNestedDoc(writer);
+
+    flexi_cursor_s cursor{};
+    writer.GetCursor(&cursor);
+
+    std::array<flexi_path_step_s, 4> steps{};
+    flexi_path_s path{};
+    flexi_cursor_s dest{};
+    int64_t v = -1;
+
+    REQUIRE(FLEXI_OK ==
+            flexi_compile_path("/map-50/key-50/3", steps.data(), 4, &path));
+    REQUIRE(FLEXI_OK == flexi_cursor_seek_path(&cursor, &path, &dest));
+    REQUIRE(FLEXI_OK == flexi_cursor_sint(&dest, &v));
+    REQUIRE(13 == v);
+
+    // A numeric segment is still a key when seeking into a map.
+    REQUIRE(FLEXI_OK ==
+            flexi_compile_path("/map-50/3", steps.data(), 4, &path));
+    REQUIRE(FLEXI_OK == flexi_cursor_seek_path(&cursor, &path, &dest));
+    REQUIRE(FLEXI_OK == flexi_cursor_sint(&dest, &v));
+    REQUIRE(33 == v);
+
+    // Keys must match exactly, not just by prefix.
+    REQUIRE(FLEXI_OK == flexi_compile_path("/map-50/key-4", steps.data(), 4,
+                            &path));
+    REQUIRE(FLEXI_ERR_NOTFOUND ==
+            flexi_cursor_seek_path(&cursor, &path, &dest));
+    REQUIRE(FLEXI_TYPE_INVALID == flexi_cursor_type(&dest));
+
+    REQUIRE(FLEXI_OK ==
+            flexi_compile_path("/map-50/key-50/4", steps.data(), 4, &path));
+    REQUIRE(FLEXI_ERR_FAILSAFE ==
+            flexi_cursor_seek_path(&cursor, &path, &dest));
+
+    REQUIRE(FLEXI_OK ==
+            flexi_compile_path("/map-50/key-50/x", steps.data(), 4, &path));
+    REQUIRE(FLEXI_ERR_BADTYPE == flexi_cursor_seek_path(&cursor, &path, &dest));
+
+    REQUIRE(FLEXI_OK == flexi_compile_path("/str/0", steps.data(), 4, &path));
+    REQUIRE(FLEXI_ERR_BADTYPE == flexi_cursor_seek_path(&cursor, &path, &dest));
+
+    REQUIRE(FLEXI_OK == flexi_compile_path("", steps.data(), 4, &path));
+    REQUIRE(FLEXI_OK == flexi_cursor_seek_path(&cursor, &path, &dest));
+    REQUIRE(FLEXI_TYPE_MAP == flexi_cursor_type(&dest));
+}
@@ -23,6 +23,9 @@
 #include "flexic.h"
 #include "tests.hpp"
 
+#include <cfloat>
+#include <cmath>
+
 /******************************************************************************/
 
 static void
@@ -413,3 +416,189 @@ TEST_CASE("flexi_cursor_seek_vector_index (Key)", "[cursor_typed_vector]")
         REQUIRE_THAT(s_expected[i], Equals(s));
     }
 }
+
+/******************************************************************************/
+
+TEST_CASE("flexi_cursor_typed_vector_to_i64", "[cursor_typed_vector]")
+{
+    flexi_cursor_s cursor{};
+    std::array<int64_t, 5> dst{};
+
+    GetCursorFiveSint(cursor);
+    REQUIRE(FLEXI_OK ==
+            flexi_cursor_typed_vector_to_i64(&cursor, dst.data(), dst.size()));
+    REQUIRE(dst == (std::array<int64_t, 5>{1, 2, 3, 4, 5}));
+
+    GetCursorFiveFloat32(cursor);
+    REQUIRE(FLEXI_OK ==
+            flexi_cursor_typed_vector_to_i64(&cursor, dst.data(), dst.size()));
+    REQUIRE(dst == (std::array<int64_t, 5>{1, 2, 3, 4, 5}));
+
+    GetCursorFiveBool(cursor);
+    REQUIRE(FLEXI_OK ==
+            flexi_cursor_typed_vector_to_i64(&cursor, dst.data(), dst.size()));
+    REQUIRE(dst == (std::array<int64_t, 5>{1, 1, 0, 0, 1}));
+}
+
+TEST_CASE("flexi_cursor_typed_vector_to_f64", "[cursor_typed_vector]")
+{
+    flexi_cursor_s cursor{};
+    std::array<double, 5> dst{};
+
+    GetCursorFiveUint(cursor);
+    REQUIRE(FLEXI_OK ==
+            flexi_cursor_typed_vector_to_f64(&cursor, dst.data(), dst.size()));
+    REQUIRE(dst == (std::array<double, 5>{1.0, 2.0, 3.0, 4.0, 5.0}));
+
+    std::array<double, 3> fixed_dst{};
+    GetCursorThreeFloat64(cursor);
+    REQUIRE(FLEXI_TYPE_VECTOR_FLOAT3 == flexi_cursor_type(&cursor));
+    REQUIRE(FLEXI_OK == flexi_cursor_typed_vector_to_f64(&cursor,
+                            fixed_dst.data(), fixed_dst.size()));
+    REQUIRE(fixed_dst == (std::array<double, 3>{1.0, 2.0, 3.0}));
+}
+
+TEST_CASE("flexi_cursor_typed_vector_to_f32 (Fixed)", "[cursor_typed_vector]")
+{
+    static std::array<uint8_t, 15> s_data = {
+        0x00, 0x00, 0x80, 0x3f, // Vector[0] (1.0f)
+        0x00, 0x00, 0x00, 0x40, // Vector[1] (2.0f)
+        0x00, 0x00, 0x40, 0x40, // Vector[2] (3.0f)
+        0x0c, 0x56, 0x01        // Root
+    };
+
+    auto span = flexi_make_span(s_data.data(), s_data.size());
+    flexi_cursor_s cursor{};
+    REQUIRE(FLEXI_OK == flexi_open_span(&span, &cursor));
+    REQUIRE(FLEXI_TYPE_VECTOR_FLOAT3 == flexi_cursor_type(&cursor));
+
+    std::array<float, 3> dst{};
+    REQUIRE(FLEXI_OK ==
+            flexi_cursor_typed_vector_to_f32(&cursor, dst.data(), dst.size()));
+    REQUIRE(dst == (std::array<float, 3>{1.0f, 2.0f, 3.0f}));
+
+    std::array<uint64_t, 3> udst{};
+    REQUIRE(FLEXI_OK == flexi_cursor_typed_vector_to_u64(&cursor, udst.data(),
+                            udst.size()));
+    REQUIRE(udst == (std::array<uint64_t, 3>{1, 2, 3}));
+}
+
+TEST_CASE(
+    "flexi_cursor_typed_vector_to_i64 (Saturate)", "[cursor_typed_vector]")
+{
+    static const uint64_t s_values[] = {1, UINT64_MAX, 3};
+
+    TestWriter writer;
+    flexi_writer_s *fwriter = writer.GetWriter();
+    REQUIRE(FLEXI_OK == flexi_write_typed_vector_uint(fwriter, NULL, s_values,
+                            FLEXI_WIDTH_8B, 3));
+    REQUIRE(FLEXI_OK == flexi_write_finalize(fwriter));
+
+    flexi_ssize_t size = 0;
+    REQUIRE(writer.GetActual().Tell(&size));
+    flexi_span_s span = flexi_make_span(writer.GetActual().DataAt(0), size);
+    flexi_cursor_s cursor{};
+    REQUIRE(FLEXI_OK == flexi_open_span(&span, &cursor));
+
+    std::array<int64_t, 3> dst{};
+    REQUIRE(FLEXI_ERR_RANGE ==
+            flexi_cursor_typed_vector_to_i64(&cursor, dst.data(), dst.size()));
+    REQUIRE(dst == (std::array<int64_t, 3>{1, INT64_MAX, 3}));
+}
+
+TEST_CASE(
+    "flexi_cursor_typed_vector_to_u64 (Saturate)", "[cursor_typed_vector]")
+{
+    static const int16_t s_values[] = {-1, 2, INT16_MIN};
+
+    TestWriter writer;
+    flexi_writer_s *fwriter = writer.GetWriter();
+    REQUIRE(FLEXI_OK == flexi_write_typed_vector_sint(fwriter, NULL, s_values,
+                            FLEXI_WIDTH_2B, 3));
+    REQUIRE(FLEXI_OK == flexi_write_finalize(fwriter));
+
+    flexi_ssize_t size = 0;
+    REQUIRE(writer.GetActual().Tell(&size));
+    flexi_span_s span = flexi_make_span(writer.GetActual().DataAt(0), size);
+    flexi_cursor_s cursor{};
+    REQUIRE(FLEXI_OK == flexi_open_span(&span, &cursor));
+
+    std::array<uint64_t, 3> dst{};
+    REQUIRE(FLEXI_ERR_RANGE ==
+            flexi_cursor_typed_vector_to_u64(&cursor, dst.data(), dst.size()));
+    REQUIRE(dst == (std::array<uint64_t, 3>{0, 2, 0}));
+}
+
+TEST_CASE(
+    "flexi_cursor_typed_vector_to_i64 (Saturate float)",
+    "[cursor_typed_vector]")
+{
+    static const double s_values[] = {1.5, 1e30, -1e30, NAN, -2.5};
+
+    TestWriter writer;
+    flexi_writer_s *fwriter = writer.GetWriter();
+    REQUIRE(FLEXI_OK == flexi_write_typed_vector_flt(fwriter, NULL, s_values,
+                            FLEXI_WIDTH_8B, 5));
+    REQUIRE(FLEXI_OK == flexi_write_finalize(fwriter));
+
+    flexi_cursor_s cursor{};
+    writer.GetCursor(&cursor);
+
+    std::array<int64_t, 5> dst{};
+    REQUIRE(FLEXI_ERR_RANGE ==
+            flexi_cursor_typed_vector_to_i64(&cursor, dst.data(), dst.size()));
+    REQUIRE(dst == (std::array<int64_t, 5>{1, INT64_MAX, INT64_MIN, 0, -2}));
+
+    std::array<uint64_t, 5> udst{};
+    REQUIRE(FLEXI_ERR_RANGE == flexi_cursor_typed_vector_to_u64(&cursor,
+                                   udst.data(), udst.size()));
+    REQUIRE(udst == (std::array<uint64_t, 5>{1, UINT64_MAX, 0, 0, 0}));
+}
+
+TEST_CASE(
+    "flexi_cursor_typed_vector_to_f32 (Saturate)", "[cursor_typed_vector]")
+{
+    static const double s_values[] = {1.0, 1e300, -1e300, INFINITY, 2.0};
+
+    TestWriter writer;
+    flexi_writer_s *fwriter = writer.GetWriter();
+    REQUIRE(FLEXI_OK == flexi_write_typed_vector_flt(fwriter, NULL, s_values,
+                            FLEXI_WIDTH_8B, 5));
+    REQUIRE(FLEXI_OK == flexi_write_finalize(fwriter));
+
+    flexi_cursor_s cursor{};
+    writer.GetCursor(&cursor);
+
+    std::array<float, 5> dst{};
+    REQUIRE(FLEXI_ERR_RANGE ==
+            flexi_cursor_typed_vector_to_f32(&cursor, dst.data(), dst.size()));
+    REQUIRE(dst ==
+            (std::array<float, 5>{1.0f, FLT_MAX, -FLT_MAX, INFINITY, 2.0f}));
+
+    // Infinity is representable, so it is not out of range.
+    std::array<float, 1> inf_dst{};
+    static const double s_inf[] = {-INFINITY};
+    TestWriter inf_writer;
+    fwriter = inf_writer.GetWriter();
+    REQUIRE(FLEXI_OK == flexi_write_typed_vector_flt(fwriter, NULL, s_inf,
+                            FLEXI_WIDTH_8B, 1));
+    REQUIRE(FLEXI_OK == flexi_write_finalize(fwriter));
+    inf_writer.GetCursor(&cursor);
+    REQUIRE(FLEXI_OK == flexi_cursor_typed_vector_to_f32(&cursor,
+                            inf_dst.data(), inf_dst.size()));
+    REQUIRE(inf_dst[0] == -INFINITY);
+}
+
+TEST_CASE("flexi_cursor_typed_vector_to_i64 (Errors)", "[cursor_typed_vector]")
+{
+    flexi_cursor_s cursor{};
+    std::array<int64_t, 5> dst{};
+
+    GetCursorFiveSint(cursor);
+    REQUIRE(FLEXI_ERR_PARAM ==
+            flexi_cursor_typed_vector_to_i64(&cursor, dst.data(), 4));
+
+    GetCursorKeys(cursor);
+    REQUIRE(FLEXI_ERR_BADTYPE ==
+            flexi_cursor_typed_vector_to_i64(&cursor, dst.data(), dst.size()));
+}
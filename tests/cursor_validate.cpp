@@ -0,0 +1,181 @@
+//
+// FlexiC - A standalone FlexBuffer reader/writer in C
+//
+// (C) 2025 Lexi Mayfield
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+
+#include "catch2/generators/catch_generators.hpp"
+#include "tests.hpp"
+
+using value_t = std::vector<uint8_t>;
+
+/******************************************************************************/
+
+static void
+WriteNestedDoc(TestWriter &writer)
+{
+    flexi_writer_s *fwriter = writer.GetWriter();
+
+    REQUIRE(FLEXI_OK == flexi_write_string(fwriter, "str", "hello", 5));
+    REQUIRE(FLEXI_OK == flexi_write_key(fwriter, "key"));
+    REQUIRE(FLEXI_OK == flexi_write_indirect_f64(fwriter, NULL, PI_VALUE_DBL));
+    REQUIRE(FLEXI_OK == flexi_write_bool(fwriter, NULL, true));
+    REQUIRE(FLEXI_OK == flexi_write_vector(fwriter, "vec", 3, FLEXI_WIDTH_1B));
+    REQUIRE(FLEXI_OK == flexi_write_uint(fwriter, "uint", 300));
+    REQUIRE(FLEXI_OK == flexi_write_map(fwriter, NULL, 3, FLEXI_WIDTH_1B));
+    REQUIRE(FLEXI_OK == flexi_write_finalize(fwriter));
+}
+
+/******************************************************************************/
+
+TEST_CASE("flexi_validate_span", "[cursor_validate]")
+{
+    TestWriterStrdup writer;
+    WriteNestedDoc(writer);
+
+    flexi_ssize_t size = 0;
+    REQUIRE(writer.GetActual().Tell(&size));
+    flexi_span_s span = flexi_make_span(writer.GetActual().DataAt(0), size);
+
+    flexi_cursor_s cursor{};
+    REQUIRE(FLEXI_OK == flexi_validate_span(&span, &cursor));
+    REQUIRE(FLEXI_TYPE_MAP == flexi_cursor_type(&cursor));
+
+    // Trusted cursors give the same answers as checked ones.
+    flexi_cursor_s value{}, elem{};
+    const char *str = nullptr;
+    flexi_ssize_t len = 0;
+    REQUIRE(FLEXI_OK == flexi_cursor_seek_map_key(&cursor, "str", &value));
+    REQUIRE(FLEXI_OK == flexi_cursor_string(&value, &str, &len));
+    REQUIRE_THAT(str, Equals("hello"));
+    REQUIRE(5 == len);
+
+    uint64_t vuint = 0;
+    REQUIRE(FLEXI_OK == flexi_cursor_seek_map_key(&cursor, "uint", &value));
+    REQUIRE(FLEXI_OK == flexi_cursor_uint(&value, &vuint));
+    REQUIRE(300 == vuint);
+
+    double vdbl = 0.0;
+    REQUIRE(FLEXI_OK == flexi_cursor_seek_map_key(&cursor, "vec", &value));
+    REQUIRE(3 == flexi_cursor_length(&value));
+    REQUIRE(FLEXI_OK == flexi_cursor_seek_vector_index(&value, 1, &elem));
+    REQUIRE(FLEXI_OK == flexi_cursor_f64(&elem, &vdbl));
+    REQUIRE(PI_VALUE_DBL == vdbl);
+    REQUIRE(FLEXI_OK == flexi_cursor_seek_vector_index(&value, 0, &elem));
+    REQUIRE(FLEXI_OK == flexi_cursor_key(&elem, &str));
+    REQUIRE_THAT(str, Equals("key"));
+
+    REQUIRE(FLEXI_ERR_NOTFOUND ==
+            flexi_cursor_seek_map_key(&cursor, "nope", &value));
+}
+
+/******************************************************************************/
+
+TEST_CASE("flexi_validate_span (Unterminated string)", "[cursor_validate]")
+{
+    TestWriter writer;
+    flexi_writer_s *fwriter = writer.GetWriter();
+    REQUIRE(FLEXI_OK == flexi_write_string(fwriter, NULL, "hello", 5));
+    REQUIRE(FLEXI_OK == flexi_write_finalize(fwriter));
+
+    flexi_ssize_t size = 0;
+    REQUIRE(writer.GetActual().Tell(&size));
+    value_t data(writer.GetActual().DataAt(0),
+        writer.GetActual().DataAt(0) + size);
+
+    flexi_span_s span = flexi_make_span(data.data(), data.size());
+    flexi_cursor_s cursor{};
+    REQUIRE(FLEXI_OK == flexi_validate_span(&span, &cursor));
+
+    // Overwrite the terminator.
+    data[6] = 'x';
+    REQUIRE(FLEXI_OK == flexi_open_span(&span, &cursor));
+    REQUIRE(FLEXI_ERR_BADREAD == flexi_validate_span(&span, &cursor));
+    REQUIRE(FLEXI_TYPE_INVALID == flexi_cursor_type(&cursor));
+}
+
+/******************************************************************************/
+
+TEST_CASE("flexi_validate_span (Unsorted keys)", "[cursor_validate]")
+{
+    TestWriter writer;
+    flexi_writer_s *fwriter = writer.GetWriter();
+    REQUIRE(FLEXI_OK == flexi_write_uint(fwriter, "bbb", 1));
+    REQUIRE(FLEXI_OK == flexi_write_uint(fwriter, "ccc", 2));
+    REQUIRE(FLEXI_OK == flexi_write_map(fwriter, NULL, 2, FLEXI_WIDTH_1B));
+    REQUIRE(FLEXI_OK == flexi_write_finalize(fwriter));
+
+    flexi_ssize_t size = 0;
+    REQUIRE(writer.GetActual().Tell(&size));
+    value_t data(writer.GetActual().DataAt(0),
+        writer.GetActual().DataAt(0) + size);
+
+    flexi_span_s span = flexi_make_span(data.data(), data.size());
+    flexi_cursor_s cursor{};
+    REQUIRE(FLEXI_OK == flexi_validate_span(&span, &cursor));
+
+    // Rename "bbb" to "ddd", which now sorts after "ccc".
+    REQUIRE('b' == data[0]);
+    data[0] = data[1] = data[2] = 'd';
+    REQUIRE(FLEXI_OK == flexi_open_span(&span, &cursor));
+    REQUIRE(FLEXI_ERR_BADREAD == flexi_validate_span(&span, &cursor));
+}
+
+/******************************************************************************/
+
+TEST_CASE("flexi_validate_span (Depth limit)", "[cursor_validate]")
+{
+    TestWriter writer;
+    flexi_writer_s *fwriter = writer.GetWriter();
+    REQUIRE(FLEXI_OK == flexi_write_null(fwriter, NULL));
+    for (int i = 0; i < 40; i++) {
+        REQUIRE(FLEXI_OK ==
+                flexi_write_vector(fwriter, NULL, 1, FLEXI_WIDTH_1B));
+    }
+    REQUIRE(FLEXI_OK == flexi_write_finalize(fwriter));
+
+    flexi_ssize_t size = 0;
+    REQUIRE(writer.GetActual().Tell(&size));
+    flexi_span_s span = flexi_make_span(writer.GetActual().DataAt(0), size);
+
+    flexi_cursor_s cursor{};
+    REQUIRE(FLEXI_ERR_PARSELIMIT == flexi_validate_span(&span, &cursor));
+}
+
+/******************************************************************************/
+
+TEST_CASE("flexi_validate_span (Bad data)", "[cursor_validate]")
+{
+    value_t test = GENERATE(                   //
+        value_t{0xF5, 0x01, 0x64, 0x01},       //
+        value_t{0x7A, 0x01, 0x2D, 0x01},       //
+        value_t{0x0A, 0x01, 0x00, 0x2B, 0x01}, //
+        value_t{0x3B, 0x0A, 0x01, 0x2A, 0x01}, //
+        value_t{0x2A, 0x1E, 0x01, 0x3B, 0x01}, //
+        value_t{0x3B, 0x01, 0x22, 0x01, 0x22, 0x03},
+        value_t{0x2C, 0x01, 0x24, 0x01, 0x2C, 0x01, 0x24, 0x01},
+        value_t{0xD5, 0x00, 0x00, 0xFF, 0xFF, 0x05, 0x01, 0x29, 0x01});
+
+    flexi_span_s span = flexi_make_span(test.data(), test.size());
+
+    flexi_cursor_s cursor{};
+    REQUIRE(FLEXI_ERROR(flexi_validate_span(&span, &cursor)));
+    REQUIRE(FLEXI_TYPE_INVALID == flexi_cursor_type(&cursor));
+}
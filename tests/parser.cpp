@@ -594,4 +594,845 @@ TEST_CASE("Parse typed vectors", "[parser]")
     }
 }
 
+/******************************************************************************/
+
+static void
+WriteDeepDoc(TestWriter &writer, int depth)
+{
+    flexi_writer_s *fwriter = writer.GetWriter();
+    REQUIRE(FLEXI_OK == flexi_write_null(fwriter, "a"));
+    REQUIRE(FLEXI_OK == flexi_write_map(fwriter, NULL, 1, FLEXI_WIDTH_1B));
+    for (int i = 0; i < depth; i++) {
+        REQUIRE(FLEXI_OK ==
+                flexi_write_vector(fwriter, NULL, 1, FLEXI_WIDTH_1B));
+    }
+    REQUIRE(FLEXI_OK == flexi_write_finalize(fwriter));
+}
+
+TEST_CASE("Parse deep nesting with caller frames", "[parser]")
+{
+    TestWriter writer;
+    WriteDeepDoc(writer, 100);
+
+    flexi_ssize_t size = 0;
+    REQUIRE(writer.GetActual().Tell(&size));
+    flexi_span_s span = flexi_make_span(writer.GetActual().DataAt(0), size);
+
+    flexi_cursor_s cursor{};
+    REQUIRE(FLEXI_OK == flexi_open_span(&span, &cursor));
+
+    std::vector<flexi_parse_frame_s> frames(101);
+    flexi_parse_options_s options =
+        flexi_make_parse_options(frames.data(), frames.size());
+
+    Results results;
+    REQUIRE(FLEXI_OK ==
+            flexi_parse_cursor_ex(&g_parser, &cursor, &results, &options));
+    REQUIRE(203 == results.size());
+
+    for (size_t i = 0; i < 100; i++) {
+        REQUIRE(std::get_if<vecbegin_s>(&results[i]));
+        REQUIRE(std::get_if<vecend_s>(&results[202 - i]));
+    }
+    REQUIRE(std::get_if<mapbegin_s>(&results[100]));
+    auto value = std::get_if<null_s>(&results[101]);
+    REQUIRE(value);
+    REQUIRE_THAT("a", Equals(value->key));
+    REQUIRE(std::get_if<mapend_s>(&results[102]));
+}
+
+TEST_CASE("Parse deep nesting out of frames", "[parser]")
+{
+    TestWriter writer;
+    WriteDeepDoc(writer, 100);
+
+    flexi_ssize_t size = 0;
+    REQUIRE(writer.GetActual().Tell(&size));
+    flexi_span_s span = flexi_make_span(writer.GetActual().DataAt(0), size);
+
+    flexi_cursor_s cursor{};
+    REQUIRE(FLEXI_OK == flexi_open_span(&span, &cursor));
+
+    std::vector<flexi_parse_frame_s> frames(100);
+    flexi_parse_options_s options =
+        flexi_make_parse_options(frames.data(), frames.size());
+
+    Results results;
+    REQUIRE(FLEXI_ERR_PARSELIMIT ==
+            flexi_parse_cursor_ex(&g_parser, &cursor, &results, &options));
+
+    results.clear();
+    REQUIRE(FLEXI_ERR_PARSELIMIT ==
+            flexi_parse_cursor(&g_parser, &cursor, &results));
+
+    options = flexi_make_parse_options(nullptr, -1);
+    REQUIRE(FLEXI_ERR_PARAM ==
+            flexi_parse_cursor_ex(&g_parser, &cursor, &results, &options));
+}
+
+/******************************************************************************/
+
+static void
+WriteFilterDoc(TestWriter &writer)
+{
+    flexi_writer_s *fwriter = writer.GetWriter();
+    REQUIRE(FLEXI_OK == flexi_write_sint(fwriter, "x", 1));
+    REQUIRE(FLEXI_OK == flexi_write_sint(fwriter, "y", 2));
+    REQUIRE(FLEXI_OK == flexi_write_map(fwriter, "a", 2, FLEXI_WIDTH_1B));
+    for (int64_t i = 1; i <= 4; i++) {
+        REQUIRE(FLEXI_OK == flexi_write_sint(fwriter, NULL, i * 10));
+    }
+    REQUIRE(FLEXI_OK == flexi_write_vector(fwriter, "b", 4, FLEXI_WIDTH_1B));
+    REQUIRE(FLEXI_OK == flexi_write_string(fwriter, "c", "skip", 4));
+    REQUIRE(FLEXI_OK == flexi_write_map(fwriter, NULL, 3, FLEXI_WIDTH_1B));
+    REQUIRE(FLEXI_OK == flexi_write_finalize(fwriter));
+}
+
+TEST_CASE("Parse with filters", "[parser]")
+{
+    TestWriter writer;
+    WriteFilterDoc(writer);
+
+    flexi_ssize_t size = 0;
+    REQUIRE(writer.GetActual().Tell(&size));
+    flexi_span_s span = flexi_make_span(writer.GetActual().DataAt(0), size);
+
+    flexi_cursor_s cursor{};
+    REQUIRE(FLEXI_OK == flexi_open_span(&span, &cursor));
+
+    std::array<flexi_path_step_s, 4> steps{};
+    std::array<flexi_path_s, 2> filters{};
+    REQUIRE(FLEXI_OK == flexi_compile_path("/a/y", &steps[0], 2, &filters[0]));
+    REQUIRE(FLEXI_OK ==
+            flexi_compile_path("/b/1..2", &steps[2], 2, &filters[1]));
+
+    std::array<flexi_parse_frame_s, 4> frames{};
+    flexi_parse_options_s options =
+        flexi_make_parse_options(frames.data(), frames.size());
+    options.filters = filters.data();
+    options.filters_len = int(filters.size());
+
+    Results results;
+    REQUIRE(FLEXI_OK ==
+            flexi_parse_cursor_ex(&g_parser, &cursor, &results, &options));
+    REQUIRE(9 == results.size());
+
+    size_t i = 0;
+    REQUIRE(std::get_if<mapbegin_s>(&results[i++]));
+    {
+        auto value = std::get_if<mapbegin_s>(&results[i++]);
+        REQUIRE(value);
+        REQUIRE_THAT("a", Equals(value->key));
+    }
+    {
+        auto value = std::get_if<sint_s>(&results[i++]);
+        REQUIRE(value);
+        REQUIRE_THAT("y", Equals(value->key));
+        REQUIRE(2 == value->value);
+    }
+    REQUIRE(std::get_if<mapend_s>(&results[i++]));
+    {
+        auto value = std::get_if<vecbegin_s>(&results[i++]);
+        REQUIRE(value);
+        REQUIRE_THAT("b", Equals(value->key));
+    }
+    {
+        auto value = std::get_if<sint_s>(&results[i++]);
+        REQUIRE(value);
+        REQUIRE(20 == value->value);
+    }
+    {
+        auto value = std::get_if<sint_s>(&results[i++]);
+        REQUIRE(value);
+        REQUIRE(30 == value->value);
+    }
+    REQUIRE(std::get_if<vecend_s>(&results[i++]));
+    REQUIRE(std::get_if<mapend_s>(&results[i++]));
+}
+
+TEST_CASE("Parse with wildcard filter", "[parser]")
+{
+    TestWriter writer;
+    WriteFilterDoc(writer);
+
+    flexi_ssize_t size = 0;
+    REQUIRE(writer.GetActual().Tell(&size));
+    flexi_span_s span = flexi_make_span(writer.GetActual().DataAt(0), size);
+
+    flexi_cursor_s cursor{};
+    REQUIRE(FLEXI_OK == flexi_open_span(&span, &cursor));
+
+    std::array<flexi_path_step_s, 2> steps{};
+    flexi_path_s filter{};
+    REQUIRE(FLEXI_OK ==
+            flexi_compile_path("/*/x", steps.data(), steps.size(), &filter));
+
+    std::array<flexi_parse_frame_s, 4> frames{};
+    flexi_parse_options_s options =
+        flexi_make_parse_options(frames.data(), frames.size());
+    options.filters = &filter;
+    options.filters_len = 1;
+
+    // Vector "b" leads nowhere but is still entered, string "c" is not.
+    Results results;
+    REQUIRE(FLEXI_OK ==
+            flexi_parse_cursor_ex(&g_parser, &cursor, &results, &options));
+    REQUIRE(7 == results.size());
+    REQUIRE(std::get_if<mapbegin_s>(&results[0]));
+    REQUIRE(std::get_if<mapbegin_s>(&results[1]));
+    auto value = std::get_if<sint_s>(&results[2]);
+    REQUIRE(value);
+    REQUIRE_THAT("x", Equals(value->key));
+    REQUIRE(std::get_if<mapend_s>(&results[3]));
+    REQUIRE(std::get_if<vecbegin_s>(&results[4]));
+    REQUIRE(std::get_if<vecend_s>(&results[5]));
+    REQUIRE(std::get_if<mapend_s>(&results[6]));
+}
+
+TEST_CASE("Parse skipping children from callback", "[parser]")
+{
+    TestWriter writer;
+    WriteFilterDoc(writer);
+
+    flexi_ssize_t size = 0;
+    REQUIRE(writer.GetActual().Tell(&size));
+    flexi_span_s span = flexi_make_span(writer.GetActual().DataAt(0), size);
+
+    flexi_cursor_s cursor{};
+    REQUIRE(FLEXI_OK == flexi_open_span(&span, &cursor));
+
+    std::array<flexi_parse_frame_s, 4> frames{};
+    flexi_parse_options_s options =
+        flexi_make_parse_options(frames.data(), frames.size());
+    options.map_begin = [](const char *key, flexi_ssize_t len, void *user) {
+        auto results = static_cast<Results *>(user);
+        results->push_back(mapbegin_s{key, len});
+        return key != nullptr && strcmp(key, "a") == 0 ? FLEXI_VISIT_SKIP
+                                                       : FLEXI_VISIT_CONTINUE;
+    };
+    options.vector_begin = [](const char *, flexi_ssize_t, void *) {
+        return FLEXI_VISIT_SKIP;
+    };
+
+    Results results;
+    REQUIRE(FLEXI_OK ==
+            flexi_parse_cursor_ex(&g_parser, &cursor, &results, &options));
+    REQUIRE(6 == results.size());
+    REQUIRE(std::get_if<mapbegin_s>(&results[0]));
+    REQUIRE(std::get_if<mapbegin_s>(&results[1]));
+    REQUIRE(std::get_if<mapend_s>(&results[2]));
+    REQUIRE(std::get_if<vecend_s>(&results[3]));
+    REQUIRE(std::get_if<str_s>(&results[4]));
+    REQUIRE(std::get_if<mapend_s>(&results[5]));
+
+    options.map_begin = [](const char *, flexi_ssize_t, void *) {
+        return FLEXI_VISIT_ABORT;
+    };
+    REQUIRE(FLEXI_ERR_CALLBACK ==
+            flexi_parse_cursor_ex(&g_parser, &cursor, &results, &options));
+}
+
+/******************************************************************************/
+
+struct batch_s {
+    char kind = '\0';
+    std::vector<double> values;
+};
+
+using BatchResults = std::vector<batch_s>;
+
+TEST_CASE("Parse with batched scalars", "[parser]")
+{
+    TestWriter writer;
+    flexi_writer_s *fwriter = writer.GetWriter();
+    REQUIRE(FLEXI_OK == flexi_write_sint(fwriter, NULL, 1));
+    REQUIRE(FLEXI_OK == flexi_write_sint(fwriter, NULL, -2));
+    REQUIRE(FLEXI_OK == flexi_write_sint(fwriter, NULL, 3));
+    REQUIRE(FLEXI_OK == flexi_write_string(fwriter, NULL, "x", 1));
+    REQUIRE(FLEXI_OK == flexi_write_f64(fwriter, NULL, 1.5));
+    REQUIRE(FLEXI_OK == flexi_write_f64(fwriter, NULL, 2.5));
+    REQUIRE(FLEXI_OK == flexi_write_uint(fwriter, NULL, 7));
+    REQUIRE(FLEXI_OK == flexi_write_vector(fwriter, NULL, 7, FLEXI_WIDTH_1B));
+    REQUIRE(FLEXI_OK == flexi_write_finalize(fwriter));
+
+    flexi_ssize_t size = 0;
+    REQUIRE(writer.GetActual().Tell(&size));
+    flexi_span_s span = flexi_make_span(writer.GetActual().DataAt(0), size);
+
+    flexi_cursor_s cursor{};
+    REQUIRE(FLEXI_OK == flexi_open_span(&span, &cursor));
+
+    // Scalars arrive through the batch callbacks, everything else through
+    // the parser.
+    struct user_s {
+        Results results;
+        BatchResults batches;
+    } user;
+
+    static constexpr flexi_parser_s s_parser{
+        [](const char *, void *) { return false; },
+        [](const char *, int64_t, void *) { return false; },
+        [](const char *, uint64_t, void *) { return false; },
+        [](const char *, float, void *) { return false; },
+        [](const char *, double, void *) { return false; },
+        [](const char *, const char *, void *) { return false; },
+        [](const char *key, const char *str, flexi_ssize_t len, void *user) {
+            static_cast<user_s *>(user)->results.push_back(
+                str_s{key, str, len});
+            return true;
+        },
+        [](const char *, flexi_ssize_t, void *) { return false; },
+        [](void *) { return false; },
+        [](const char *key, flexi_ssize_t len, void *user) {
+            static_cast<user_s *>(user)->results.push_back(
+                vecbegin_s{key, len});
+            return true;
+        },
+        [](void *user) {
+            static_cast<user_s *>(user)->results.push_back(vecend_s{});
+            return true;
+        },
+        [](const char *, const void *, flexi_type_e, int, flexi_ssize_t,
+            void *) { return false; },
+        [](const char *, const void *, flexi_ssize_t, void *) {
+            return false;
+        },
+        [](const char *, bool, void *) { return false; },
+    };
+
+    std::array<flexi_parse_frame_s, 1> frames{};
+    std::array<uint64_t, 2> batch{};
+    flexi_parse_options_s options =
+        flexi_make_parse_options(frames.data(), frames.size());
+    options.batch = batch.data();
+    options.batch_len = batch.size();
+    options.sint_batch = [](const int64_t *values, flexi_ssize_t count,
+                             void *user) {
+        static_cast<user_s *>(user)->batches.push_back(
+            batch_s{'i', std::vector<double>(values, values + count)});
+        return true;
+    };
+    options.uint_batch = [](const uint64_t *values, flexi_ssize_t count,
+                             void *user) {
+        static_cast<user_s *>(user)->batches.push_back(
+            batch_s{'u', std::vector<double>(values, values + count)});
+        return true;
+    };
+    options.f64_batch = [](const double *values, flexi_ssize_t count,
+                            void *user) {
+        static_cast<user_s *>(user)->batches.push_back(
+            batch_s{'f', std::vector<double>(values, values + count)});
+        return true;
+    };
+
+    REQUIRE(FLEXI_OK ==
+            flexi_parse_cursor_ex(&s_parser, &cursor, &user, &options));
+    REQUIRE(3 == user.results.size());
+    REQUIRE(std::get_if<vecbegin_s>(&user.results[0]));
+    REQUIRE(std::get_if<str_s>(&user.results[1]));
+    REQUIRE(std::get_if<vecend_s>(&user.results[2]));
+
+    // Runs are split when the batch buffer fills up.
+    REQUIRE(4 == user.batches.size());
+    REQUIRE('i' == user.batches[0].kind);
+    REQUIRE((user.batches[0].values == std::vector<double>{1.0, -2.0}));
+    REQUIRE('i' == user.batches[1].kind);
+    REQUIRE((user.batches[1].values == std::vector<double>{3.0}));
+    REQUIRE('f' == user.batches[2].kind);
+    REQUIRE((user.batches[2].values == std::vector<double>{1.5, 2.5}));
+    REQUIRE('u' == user.batches[3].kind);
+    REQUIRE((user.batches[3].values == std::vector<double>{7.0}));
+}
+
+TEST_CASE("Parse in steps", "[parser]")
+{
+    TestWriter writer;
+    WriteFilterDoc(writer);
+
+    flexi_cursor_s cursor{};
+    writer.GetCursor(&cursor);
+
+    Results expected;
+    REQUIRE(FLEXI_OK == flexi_parse_cursor(&g_parser, &cursor, &expected));
+
+    std::array<flexi_parse_frame_s, 2> frames{};
+    flexi_parse_options_s options =
+        flexi_make_parse_options(frames.data(), frames.size());
+
+    Results results;
+    flexi_parse_ctx_s ctx;
+    REQUIRE(FLEXI_OK ==
+            flexi_parse_begin(&ctx, &g_parser, &cursor, &results, &options));
+    REQUIRE(results.empty());
+    REQUIRE(FLEXI_ERR_PARAM == flexi_parse_step(&ctx, 0));
+
+    // One value per step, plus the end of every map and vector.
+    int steps = 0;
+    flexi_result_e res = FLEXI_INCOMPLETE;
+    while (res == FLEXI_INCOMPLETE) {
+        size_t before = results.size();
+        res = flexi_parse_step(&ctx, 1);
+        REQUIRE(results.size() - before <= 1);
+        steps += 1;
+    }
+    REQUIRE(FLEXI_OK == res);
+    REQUIRE(13 == steps);
+    REQUIRE(expected.size() == results.size());
+    for (size_t i = 0; i < expected.size(); i++) {
+        CAPTURE(i);
+        REQUIRE(expected[i].index() == results[i].index());
+    }
+
+    // Finished parses stay finished.
+    REQUIRE(FLEXI_OK == flexi_parse_step(&ctx, 1));
+    REQUIRE(expected.size() == results.size());
+
+    results.clear();
+    REQUIRE(FLEXI_OK ==
+            flexi_parse_begin(&ctx, &g_parser, &cursor, &results, &options));
+    REQUIRE(FLEXI_INCOMPLETE == flexi_parse_step(&ctx, 4));
+    REQUIRE(4 == results.size());
+    REQUIRE(FLEXI_OK == flexi_parse_step(&ctx, 100));
+    REQUIRE(expected.size() == results.size());
+}
+
+TEST_CASE("Parse with a per-message budget", "[parser]")
+{
+    TestWriter writer;
+    WriteFilterDoc(writer);
+
+    flexi_cursor_s cursor{};
+    writer.GetCursor(&cursor);
+
+    std::array<flexi_parse_frame_s, 2> frames{};
+    flexi_parse_options_s options =
+        flexi_make_parse_options(frames.data(), frames.size());
+
+    Results results;
+    flexi_parse_ctx_s ctx;
+
+    options.max_values = -1;
+    REQUIRE(FLEXI_ERR_PARAM ==
+            flexi_parse_begin(&ctx, &g_parser, &cursor, &results, &options));
+    options.max_values = 0;
+    options.max_iterables = 0;
+    REQUIRE(FLEXI_ERR_PARAM ==
+            flexi_parse_begin(&ctx, &g_parser, &cursor, &results, &options));
+    options.max_iterables = FLEXI_CONFIG_MAX_ITERABLES;
+
+    // The whole message takes 13 values, so a budget of 13 is enough.
+    options.max_values = 13;
+    REQUIRE(FLEXI_OK ==
+            flexi_parse_begin(&ctx, &g_parser, &cursor, &results, &options));
+    REQUIRE(FLEXI_OK == flexi_parse_step(&ctx, 100));
+
+    // The budget is shared by every step of the parse.
+    options.max_values = 10;
+    results.clear();
+    REQUIRE(FLEXI_OK ==
+            flexi_parse_begin(&ctx, &g_parser, &cursor, &results, &options));
+    REQUIRE(FLEXI_INCOMPLETE == flexi_parse_step(&ctx, 4));
+    REQUIRE(FLEXI_INCOMPLETE == flexi_parse_step(&ctx, 4));
+    REQUIRE(FLEXI_ERR_PARSELIMIT == flexi_parse_step(&ctx, 4));
+    REQUIRE(10 == results.size());
+}
+
+TEST_CASE("Parse with a per-message iterable limit", "[parser]")
+{
+    // More vectors than FLEXI_CONFIG_MAX_ITERABLES allows by default.
+    constexpr int COUNT = FLEXI_CONFIG_MAX_ITERABLES + 16;
+
+    TestWriter writer;
+    flexi_writer_s *fwriter = writer.GetWriter();
+    for (int i = 0; i < COUNT; i++) {
+        REQUIRE(FLEXI_OK ==
+                flexi_write_vector(fwriter, NULL, 0, FLEXI_WIDTH_1B));
+    }
+    REQUIRE(FLEXI_OK ==
+            flexi_write_vector(fwriter, NULL, COUNT, FLEXI_WIDTH_1B));
+    REQUIRE(FLEXI_OK == flexi_write_finalize(fwriter));
+
+    flexi_cursor_s cursor{};
+    writer.GetCursor(&cursor);
+
+    Results results;
+    REQUIRE(FLEXI_ERR_PARSELIMIT ==
+            flexi_parse_cursor(&g_parser, &cursor, &results));
+
+    std::array<flexi_parse_frame_s, 2> frames{};
+    flexi_parse_options_s options =
+        flexi_make_parse_options(frames.data(), frames.size());
+    options.max_iterables = COUNT + 2;
+
+    results.clear();
+    REQUIRE(FLEXI_OK ==
+            flexi_parse_cursor_ex(&g_parser, &cursor, &results, &options));
+    REQUIRE((COUNT + 1) * 2 == results.size());
+
+    options.max_iterables = 8;
+    results.clear();
+    REQUIRE(FLEXI_ERR_PARSELIMIT ==
+            flexi_parse_cursor_ex(&g_parser, &cursor, &results, &options));
+}
+
+TEST_CASE("Parse shared vectors once", "[parser]")
+{
+    // [[7], [7]], where both inner vectors are the same vector.
+    std::vector<uint8_t> data{0x01, 0x07, 0x04, 0x02, 0x03, 0x04, 0x28, 0x28,
+        0x04, 0x28, 0x01};
+    flexi_span_s span = flexi_make_span(data.data(), data.size());
+
+    flexi_cursor_s cursor{};
+    REQUIRE(FLEXI_OK == flexi_open_span(&span, &cursor));
+
+    struct user_s {
+        Results results;
+        std::vector<flexi_ssize_t> shared;
+    } user;
+
+    static constexpr flexi_parser_s s_parser{
+        [](const char *, void *) { return false; },
+        [](const char *key, int64_t value, void *user) {
+            static_cast<user_s *>(user)->results.push_back(
+                sint_s{key, value});
+            return true;
+        },
+        [](const char *, uint64_t, void *) { return false; },
+        [](const char *, float, void *) { return false; },
+        [](const char *, double, void *) { return false; },
+        [](const char *, const char *, void *) { return false; },
+        [](const char *, const char *, flexi_ssize_t, void *) {
+            return false;
+        },
+        [](const char *, flexi_ssize_t, void *) { return false; },
+        [](void *) { return false; },
+        [](const char *key, flexi_ssize_t len, void *user) {
+            static_cast<user_s *>(user)->results.push_back(
+                vecbegin_s{key, len});
+            return true;
+        },
+        [](void *user) {
+            static_cast<user_s *>(user)->results.push_back(vecend_s{});
+            return true;
+        },
+        [](const char *, const void *, flexi_type_e, int, flexi_ssize_t,
+            void *) { return false; },
+        [](const char *, const void *, flexi_ssize_t, void *) {
+            return false;
+        },
+        [](const char *, bool, void *) { return false; },
+    };
+
+    std::array<flexi_parse_frame_s, 2> frames{};
+    std::array<uint32_t, 12> visited{};
+    flexi_parse_options_s options =
+        flexi_make_parse_options(frames.data(), frames.size());
+
+    REQUIRE(FLEXI_OK ==
+            flexi_parse_cursor_ex(&s_parser, &cursor, &user, &options));
+    REQUIRE(8 == user.results.size());
+
+    user.results.clear();
+    options.visited = visited.data();
+    options.visited_size = sizeof(visited);
+    REQUIRE(FLEXI_ERR_PARAM ==
+            flexi_parse_cursor_ex(&s_parser, &cursor, &user, &options));
+
+    options.shared = [](const char *, flexi_type_e type, flexi_ssize_t id,
+                         void *user) {
+        REQUIRE(FLEXI_TYPE_VECTOR == type);
+        static_cast<user_s *>(user)->shared.push_back(id);
+        return true;
+    };
+    REQUIRE(FLEXI_OK ==
+            flexi_parse_cursor_ex(&s_parser, &cursor, &user, &options));
+    REQUIRE(5 == user.results.size());
+    REQUIRE(std::get_if<vecbegin_s>(&user.results[0]));
+    REQUIRE(std::get_if<vecbegin_s>(&user.results[1]));
+    REQUIRE(std::get_if<sint_s>(&user.results[2]));
+    REQUIRE(std::get_if<vecend_s>(&user.results[3]));
+    REQUIRE(std::get_if<vecend_s>(&user.results[4]));
+
+    // The shared vector was the second one begun.
+    REQUIRE((user.shared == std::vector<flexi_ssize_t>{1}));
+}
+
+TEST_CASE("Parse vectors of different widths at one address", "[parser]")
+{
+    // [[], [7]], where both inner vectors are at the same address, but the
+    // first is read with a width of 1 and the second with a width of 2.
+    std::vector<uint8_t> data{0x01, 0x00, 0x07, 0x00, 0x04, 0x02, 0x04, 0x05,
+        0x28, 0x29, 0x04, 0x28, 0x01};
+    flexi_span_s span = flexi_make_span(data.data(), data.size());
+
+    flexi_cursor_s cursor{};
+    REQUIRE(FLEXI_OK == flexi_open_span(&span, &cursor));
+
+    static constexpr flexi_parser_s s_parser{
+        [](const char *, void *) { return false; },
+        [](const char *key, int64_t value, void *user) {
+            static_cast<Results *>(user)->push_back(sint_s{key, value});
+            return true;
+        },
+        [](const char *, uint64_t, void *) { return false; },
+        [](const char *, float, void *) { return false; },
+        [](const char *, double, void *) { return false; },
+        [](const char *, const char *, void *) { return false; },
+        [](const char *, const char *, flexi_ssize_t, void *) {
+            return false;
+        },
+        [](const char *, flexi_ssize_t, void *) { return false; },
+        [](void *) { return false; },
+        [](const char *key, flexi_ssize_t len, void *user) {
+            static_cast<Results *>(user)->push_back(vecbegin_s{key, len});
+            return true;
+        },
+        [](void *user) {
+            static_cast<Results *>(user)->push_back(vecend_s{});
+            return true;
+        },
+        [](const char *, const void *, flexi_type_e, int, flexi_ssize_t,
+            void *) { return false; },
+        [](const char *, const void *, flexi_ssize_t, void *) {
+            return false;
+        },
+        [](const char *, bool, void *) { return false; },
+    };
+
+    std::array<flexi_parse_frame_s, 2> frames{};
+    std::array<uint32_t, 12> visited{};
+    flexi_parse_options_s options =
+        flexi_make_parse_options(frames.data(), frames.size());
+    options.visited = visited.data();
+    options.visited_size = sizeof(visited);
+    options.shared = [](const char *, flexi_type_e, flexi_ssize_t, void *) {
+        FAIL("Vectors of different widths are not shared");
+        return false;
+    };
+
+    Results results;
+    REQUIRE(FLEXI_OK ==
+            flexi_parse_cursor_ex(&s_parser, &cursor, &results, &options));
+    REQUIRE(7 == results.size());
+    REQUIRE(std::get<vecbegin_s>(results[0]).len == 2);
+    REQUIRE(std::get<vecbegin_s>(results[1]).len == 0);
+    REQUIRE(std::get_if<vecend_s>(&results[2]));
+    REQUIRE(std::get<vecbegin_s>(results[3]).len == 1);
+    REQUIRE(std::get<sint_s>(results[4]).value == 7);
+    REQUIRE(std::get_if<vecend_s>(&results[5]));
+    REQUIRE(std::get_if<vecend_s>(&results[6]));
+}
+
+/******************************************************************************/
+
+static void
+WriteAllTypesDoc(TestWriter &writer)
+{
+    const int16_t ints[] = {1, -2, 3};
+    flexi_writer_s *fwriter = writer.GetWriter();
+    REQUIRE(FLEXI_OK == flexi_write_sint(fwriter, "b", -1));
+    REQUIRE(FLEXI_OK == flexi_write_uint(fwriter, "c", 2));
+    REQUIRE(FLEXI_OK == flexi_write_f32(fwriter, "d", PI_VALUE_FLT));
+    REQUIRE(FLEXI_OK == flexi_write_f64(fwriter, "e", PI_VALUE_DBL));
+    REQUIRE(FLEXI_OK == flexi_write_keyed_key(fwriter, "f", "Key"));
+    REQUIRE(FLEXI_OK == flexi_write_string(fwriter, "g", "Str", 3));
+    REQUIRE(FLEXI_OK == flexi_write_blob(fwriter, "h", "blob", 4, 1));
+    REQUIRE(FLEXI_OK == flexi_write_bool(fwriter, "i", true));
+    REQUIRE(FLEXI_OK == flexi_write_typed_vector_sint(fwriter, "j", ints,
+                            FLEXI_WIDTH_2B, 3));
+    REQUIRE(FLEXI_OK == flexi_write_indirect_sint(fwriter, NULL, 4));
+    REQUIRE(FLEXI_OK == flexi_write_indirect_f64(fwriter, NULL, 0.5));
+    REQUIRE(FLEXI_OK == flexi_write_vector(fwriter, "k", 2, FLEXI_WIDTH_1B));
+    REQUIRE(FLEXI_OK == flexi_write_map(fwriter, NULL, 10, FLEXI_WIDTH_1B));
+    REQUIRE(FLEXI_OK == flexi_write_finalize(fwriter));
+}
+
+/**
+ * @brief Handler for flexi::parse which records the same results as
+ *        g_parser.
+ */
+struct ResultsHandler {
+    Results results;
+
+    bool null(const char *key)
+    {
+        results.push_back(null_s{key});
+        return true;
+    }
+    bool sint(const char *key, int64_t value)
+    {
+        results.push_back(sint_s{key, value});
+        return true;
+    }
+    bool uint(const char *key, uint64_t value)
+    {
+        results.push_back(uint_s{key, value});
+        return true;
+    }
+    bool f32(const char *key, float value)
+    {
+        results.push_back(f32_s{key, value});
+        return true;
+    }
+    bool f64(const char *key, double value)
+    {
+        results.push_back(f64_s{key, value});
+        return true;
+    }
+    bool key(const char *key, const char *str)
+    {
+        results.push_back(key_s{key, str});
+        return true;
+    }
+    bool string(const char *key, const char *str, flexi_ssize_t len)
+    {
+        results.push_back(str_s{key, str, len});
+        return true;
+    }
+    bool map_begin(const char *key, flexi_ssize_t len)
+    {
+        results.push_back(mapbegin_s{key, len});
+        return true;
+    }
+    bool map_end()
+    {
+        results.push_back(mapend_s{});
+        return true;
+    }
+    bool vector_begin(const char *key, flexi_ssize_t len)
+    {
+        results.push_back(vecbegin_s{key, len});
+        return true;
+    }
+    bool vector_end()
+    {
+        results.push_back(vecend_s{});
+        return true;
+    }
+    bool typed_vector(const char *key, const void *ptr, flexi_type_e type,
+        int width, flexi_ssize_t count)
+    {
+        results.push_back(typedvec_s{key, ptr, type, width, count});
+        return true;
+    }
+    bool blob(const char *key, const void *ptr, flexi_ssize_t len)
+    {
+        results.push_back(blob_s{key, ptr, len});
+        return true;
+    }
+    bool boolean(const char *key, bool value)
+    {
+        results.push_back(bool_s{key, value});
+        return true;
+    }
+};
+
+TEST_CASE("C++ parse matches C parse", "[parser]")
+{
+    TestWriter writer;
+    WriteAllTypesDoc(writer);
+
+    flexi_cursor_s cursor{};
+    writer.GetCursor(&cursor);
+
+    Results expected;
+    REQUIRE(FLEXI_OK == flexi_parse_cursor(&g_parser, &cursor, &expected));
+
+    ResultsHandler handler;
+    REQUIRE(FLEXI_OK == flexi::parse(&cursor, handler));
+    REQUIRE(15 == handler.results.size());
+    REQUIRE(expected.size() == handler.results.size());
+
+    for (size_t i = 0; i < expected.size(); i++) {
+        CAPTURE(i);
+        REQUIRE(expected[i].index() == handler.results[i].index());
+    }
+
+    auto value = std::get_if<typedvec_s>(&handler.results[9]);
+    REQUIRE(value);
+    REQUIRE_THAT("j", Equals(value->key));
+    REQUIRE(FLEXI_TYPE_VECTOR_SINT3 == value->type);
+    REQUIRE(2 == value->width);
+    REQUIRE(3 == value->count);
+}
+
+TEST_CASE("C++ parse skips values without handler members", "[parser]")
+{
+    TestWriter writer;
+    WriteAllTypesDoc(writer);
+
+    flexi_cursor_s cursor{};
+    writer.GetCursor(&cursor);
+
+    struct SintHandler {
+        std::vector<int64_t> values;
+
+        bool sint(const char *, int64_t value)
+        {
+            values.push_back(value);
+            return true;
+        }
+    } handler;
+
+    REQUIRE(FLEXI_OK == flexi::parse(&cursor, handler));
+    REQUIRE((handler.values == std::vector<int64_t>{-1, 4}));
+}
+
+/**
+ * @brief Handler for flexi::parse with overloaded and template members.
+ */
+struct OverloadHandler {
+    std::vector<int64_t> sints;
+    std::vector<uint64_t> uints;
+
+    bool sint(const char *, int64_t value)
+    {
+        sints.push_back(value);
+        return true;
+    }
+    bool sint(const char *, const std::string &) { return false; }
+
+    template<typename T> bool uint(const char *, T value)
+    {
+        uints.push_back(value);
+        return true;
+    }
+};
+
+TEST_CASE("C++ parse finds overloaded handler members", "[parser]")
+{
+    TestWriter writer;
+    WriteAllTypesDoc(writer);
+
+    flexi_cursor_s cursor{};
+    writer.GetCursor(&cursor);
+
+    OverloadHandler handler;
+
+    REQUIRE(FLEXI_OK == flexi::parse(&cursor, handler));
+    REQUIRE((handler.sints == std::vector<int64_t>{-1, 4}));
+    REQUIRE((handler.uints == std::vector<uint64_t>{2}));
+}
+
+TEST_CASE("C++ parse errors", "[parser]")
+{
+    TestWriter writer;
+    WriteDeepDoc(writer, 100);
+
+    flexi_cursor_s cursor{};
+    writer.GetCursor(&cursor);
+
+    ResultsHandler handler;
+    REQUIRE(FLEXI_ERR_PARSELIMIT == flexi::parse(&cursor, handler));
+
+    struct FailHandler {
+        bool null(const char *) { return false; }
+    } fail;
+
+    TestWriter shallow;
+    WriteDeepDoc(shallow, 1);
+    shallow.GetCursor(&cursor);
+    REQUIRE(FLEXI_ERR_CALLBACK == flexi::parse(&cursor, fail));
+}
+
 #endif // #if FLEXI_FEATURE_PARSER
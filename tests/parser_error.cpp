@@ -169,6 +169,20 @@ TEST_CASE("Parse Limits Tests", "[parser_error]")
 
     act_result = flexi_parse_cursor(&g_parser, &cursor, NULL);
     REQUIRE(FLEXI_ERR_PARSELIMIT == act_result);
+
+    // Shared vectors are only parsed once when they're tracked.
+    std::array<flexi_parse_frame_s, FLEXI_CONFIG_MAX_DEPTH> frames{};
+    std::vector<uint32_t> visited(
+        flexi_parse_visited_size(64) / sizeof(uint32_t));
+    flexi_parse_options_s options =
+        flexi_make_parse_options(frames.data(), frames.size());
+    options.visited = visited.data();
+    options.visited_size = flexi_parse_visited_size(64);
+    options.shared = [](const char *, flexi_type_e, flexi_ssize_t,
+                         void *) -> bool { return true; };
+
+    act_result = flexi_parse_cursor_ex(&g_parser, &cursor, NULL, &options);
+    REQUIRE(FLEXI_OK == act_result);
 }
 
 #endif // #if FLEXI_FEATURE_PARSER
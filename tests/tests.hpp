@@ -185,6 +185,17 @@ public:
         REQUIRE(FLEXI_OK == flexi_open_span(&span, cursor));
     }
 
+    std::vector<uint8_t> GetData() const
+    {
+        flexi_ssize_t size = 0;
+        REQUIRE(m_actual.Tell(&size));
+        if (size == 0) {
+            return {};
+        }
+        const uint8_t *data = m_actual.DataAt(0);
+        return std::vector<uint8_t>(data, data + size);
+    }
+
     TestStream &GetActual() { return m_actual; }
     flexi_writer_s *GetWriter() { return &m_writer; }
 };
@@ -205,6 +216,76 @@ public:
     }
 };
 
+/**
+ * @brief A fixture for measuring a message with a dry run, then writing it
+ *        into a fixed buffer.
+ */
+class TestFixedWriter {
+    std::array<flexi_value_s, 512> m_values{};
+    flexi_array_stack_s m_array{};
+    flexi_fixed_ostream_s m_fixed{};
+    std::vector<uint8_t> m_buffer;
+    flexi_writer_s m_writer{};
+
+public:
+    TestFixedWriter()
+    {
+        m_array = flexi_make_fixed_stack(m_values.data(), m_values.size());
+        m_fixed = flexi_make_fixed_ostream(NULL, 0);
+        flexi_stack_s stack = flexi_array_stack(&m_array);
+        flexi_ostream_s ostream = flexi_fixed_ostream(&m_fixed);
+        m_writer = flexi_make_writer(&stack, &ostream, NULL, NULL);
+    }
+
+    TestFixedWriter(const TestFixedWriter &) = delete;
+    TestFixedWriter &operator=(const TestFixedWriter &) = delete;
+
+    ~TestFixedWriter() { flexi_destroy_writer(&m_writer); }
+
+    /**
+     * @brief Measure the message written by a function with a dry run.
+     */
+    template<typename Fn> flexi_ssize_t DryRun(Fn &&write)
+    {
+        flexi_ssize_t size = 0;
+        REQUIRE(FLEXI_OK == flexi_writer_begin_dry_run(&m_writer));
+        write(&m_writer);
+        REQUIRE(0 == m_fixed.len);
+        REQUIRE(FLEXI_OK == flexi_writer_end_dry_run(&m_writer, &size));
+        return size;
+    }
+
+    /**
+     * @brief Write into a new buffer of the passed size from now on.
+     */
+    void SetBuffer(flexi_ssize_t len)
+    {
+        m_buffer.assign(size_t(len), 0);
+        m_fixed = flexi_make_fixed_ostream(m_buffer.data(), len);
+    }
+
+    std::vector<uint8_t> GetData() const
+    {
+        return std::vector<uint8_t>(
+            m_buffer.begin(), m_buffer.begin() + m_fixed.len);
+    }
+
+    flexi_ssize_t GetLen() const { return m_fixed.len; }
+    flexi_writer_s *GetWriter() { return &m_writer; }
+};
+
+/**
+ * @brief Write a document with a plain writer and return the written data,
+ *        to compare the output of other writer setups against.
+ */
+template<typename Fn> inline std::vector<uint8_t>
+WritePlainData(Fn &&write)
+{
+    TestWriter plain;
+    write(plain.GetWriter());
+    return plain.GetData();
+}
+
 /**
  * @brief Read a file into a string as binary.
  *
@@ -41,13 +41,13 @@ TEST_CASE("Immediate", "[write_map]")
     REQUIRE(0 == flexi_writer_debug_stack_count(fwriter));
 
     std::vector<uint8_t> expected = {
-        'u', 'i', 'n', 't', '\0', // Key values
+        'b', 'o', 'o', 'l', '\0', // Key values
         's', 'i', 'n', 't', '\0', //
-        'b', 'o', 'o', 'l', '\0', //
+        'u', 'i', 'n', 't', '\0', //
         0x03,                     // Map keys vector length
-        0x06,                     // Keys[0] "bool"
+        0x10,                     // Keys[0] "bool"
         0x0c,                     // Keys[1] "sint"
-        0x12,                     // Keys[2] "uint"
+        0x08,                     // Keys[2] "uint"
         0x00,                     // Padding
         0x04, 0x00,               // Keys vector offset
         0x01, 0x00,               // Keys vector stride
@@ -343,3 +343,503 @@ TEST_CASE("Create Large Document #2", "[write_map]")
         }
     }
 }
+
+static void
+WriteRepeatedKeys(flexi_writer_s *fwriter)
+{
+    for (int i = 0; i < 3; i++) {
+        REQUIRE(FLEXI_OK == flexi_write_uint(fwriter, "alpha", i));
+        REQUIRE(FLEXI_OK == flexi_write_uint(fwriter, "beta", i * 2));
+        REQUIRE(FLEXI_OK == flexi_write_map(fwriter, NULL, 2, FLEXI_WIDTH_1B));
+    }
+    REQUIRE(FLEXI_OK ==
+            flexi_write_vector(fwriter, NULL, 3, FLEXI_WIDTH_1B));
+    REQUIRE(FLEXI_OK == flexi_write_finalize(fwriter));
+}
+
+TEST_CASE("Pooled keys", "[write_map]")
+{
+    TestWriter plain;
+    WriteRepeatedKeys(plain.GetWriter());
+
+    TestWriter writer;
+    flexi_writer_s *fwriter = writer.GetWriter();
+
+    std::vector<uint8_t> pool(flexi_writer_pool_size(2));
+    REQUIRE(FLEXI_OK ==
+            flexi_writer_set_key_pool(fwriter, pool.data(), pool.size()));
+    WriteRepeatedKeys(fwriter);
+
+    // Each key should only be written once.
+    flexi_ssize_t plain_size = 0, size = 0;
+    REQUIRE(plain.GetActual().Tell(&plain_size));
+    REQUIRE(writer.GetActual().Tell(&size));
+    REQUIRE(size + 2 * (6 + 5) == plain_size);
+
+    flexi_cursor_s cursor{};
+    writer.GetCursor(&cursor);
+
+    for (int i = 0; i < 3; i++) {
+        CAPTURE(i);
+        flexi_cursor_s map{}, value{};
+        REQUIRE(FLEXI_OK == flexi_cursor_seek_vector_index(&cursor, i, &map));
+
+        uint64_t v = 0;
+        REQUIRE(FLEXI_OK == flexi_cursor_seek_map_key(&map, "alpha", &value));
+        REQUIRE(FLEXI_OK == flexi_cursor_uint(&value, &v));
+        REQUIRE(i == v);
+        REQUIRE(FLEXI_OK == flexi_cursor_seek_map_key(&map, "beta", &value));
+        REQUIRE(FLEXI_OK == flexi_cursor_uint(&value, &v));
+        REQUIRE(i * 2 == v);
+    }
+}
+
+TEST_CASE("Pooled keys (Too small buffer)", "[write_map]")
+{
+    TestWriter writer;
+    flexi_writer_s *fwriter = writer.GetWriter();
+
+    std::vector<uint8_t> pool(flexi_writer_pool_size(1) - 1);
+    REQUIRE(FLEXI_ERR_PARAM ==
+            flexi_writer_set_key_pool(fwriter, pool.data(), pool.size()));
+    REQUIRE(FLEXI_OK == flexi_writer_set_key_pool(fwriter, NULL, 0));
+}
+
+static void
+WriteRecords(flexi_writer_s *fwriter)
+{
+    for (int i = 0; i < 100; i++) {
+        // Key order should not matter.
+        if (i % 2) {
+            REQUIRE(FLEXI_OK == flexi_write_uint(fwriter, "id", i));
+            REQUIRE(FLEXI_OK == flexi_write_uint(fwriter, "score", i * 2));
+            REQUIRE(FLEXI_OK == flexi_write_bool(fwriter, "active", true));
+        } else {
+            REQUIRE(FLEXI_OK == flexi_write_bool(fwriter, "active", false));
+            REQUIRE(FLEXI_OK == flexi_write_uint(fwriter, "score", i * 2));
+            REQUIRE(FLEXI_OK == flexi_write_uint(fwriter, "id", i));
+        }
+        REQUIRE(FLEXI_OK == flexi_write_map(fwriter, NULL, 3, FLEXI_WIDTH_1B));
+    }
+    REQUIRE(FLEXI_OK ==
+            flexi_write_vector(fwriter, NULL, 100, FLEXI_WIDTH_1B));
+    REQUIRE(FLEXI_OK == flexi_write_finalize(fwriter));
+}
+
+TEST_CASE("Pooled keysets", "[write_map]")
+{
+    TestWriter plain;
+    WriteRecords(plain.GetWriter());
+
+    TestWriter writer;
+    flexi_writer_s *fwriter = writer.GetWriter();
+
+    std::vector<uint8_t> pool(flexi_writer_pool_size(1));
+    REQUIRE(FLEXI_OK ==
+            flexi_writer_set_keyset_pool(fwriter, pool.data(), pool.size()));
+    WriteRecords(fwriter);
+
+    flexi_ssize_t plain_size = 0, size = 0;
+    REQUIRE(plain.GetActual().Tell(&plain_size));
+    REQUIRE(writer.GetActual().Tell(&size));
+    REQUIRE(size < plain_size * 2 / 3);
+
+    flexi_cursor_s cursor{};
+    writer.GetCursor(&cursor);
+    REQUIRE(100 == flexi_cursor_length(&cursor));
+
+    // Later maps are far enough from the shared keys that the map needs
+    // a wider stride to reach them.
+    for (int i = 0; i < 100; i++) {
+        CAPTURE(i);
+        flexi_cursor_s map{}, value{};
+        REQUIRE(FLEXI_OK == flexi_cursor_seek_vector_index(&cursor, i, &map));
+        REQUIRE(3 == flexi_cursor_length(&map));
+
+        uint64_t v = 0;
+        REQUIRE(FLEXI_OK == flexi_cursor_seek_map_key(&map, "id", &value));
+        REQUIRE(FLEXI_OK == flexi_cursor_uint(&value, &v));
+        REQUIRE(i == v);
+        REQUIRE(FLEXI_OK == flexi_cursor_seek_map_key(&map, "score", &value));
+        REQUIRE(FLEXI_OK == flexi_cursor_uint(&value, &v));
+        REQUIRE(i * 2 == v);
+
+        bool b = false;
+        REQUIRE(FLEXI_OK == flexi_cursor_seek_map_key(&map, "active", &value));
+        REQUIRE(FLEXI_OK == flexi_cursor_bool(&value, &b));
+        REQUIRE((i % 2 == 1) == b);
+    }
+}
+
+TEST_CASE("Pooled keys far behind a keys vector", "[write_map]")
+{
+    TestWriterStrdup writer;
+    flexi_writer_s *fwriter = writer.GetWriter();
+
+    std::vector<uint8_t> pool(flexi_writer_pool_size(64));
+    REQUIRE(FLEXI_OK ==
+            flexi_writer_set_key_pool(fwriter, pool.data(), pool.size()));
+
+    REQUIRE(FLEXI_OK == flexi_write_uint(fwriter, "zz", 1));
+    REQUIRE(FLEXI_OK == flexi_write_map(fwriter, NULL, 1, FLEXI_WIDTH_1B));
+
+    // The new keys are written after "zz", so the offset from the end of
+    // the keys vector back to "zz" needs a wider stride than the current
+    // position suggests.
+    for (int i = 0; i < 56; i++) {
+        char key[4] = {'a', char('0' + i / 10), char('0' + i % 10), '\0'};
+        REQUIRE(FLEXI_OK == flexi_write_uint(fwriter, key, i));
+    }
+    REQUIRE(FLEXI_OK == flexi_write_uint(fwriter, "zz", 56));
+    REQUIRE(FLEXI_OK == flexi_write_map(fwriter, NULL, 57, FLEXI_WIDTH_1B));
+    REQUIRE(FLEXI_OK == flexi_write_vector(fwriter, NULL, 2, FLEXI_WIDTH_1B));
+    REQUIRE(FLEXI_OK == flexi_write_finalize(fwriter));
+
+    flexi_cursor_s cursor{}, map{}, value{};
+    writer.GetCursor(&cursor);
+    REQUIRE(FLEXI_OK == flexi_cursor_seek_vector_index(&cursor, 1, &map));
+    REQUIRE(57 == flexi_cursor_length(&map));
+
+    uint64_t v = 0;
+    REQUIRE(FLEXI_OK == flexi_cursor_seek_map_key(&map, "zz", &value));
+    REQUIRE(FLEXI_OK == flexi_cursor_uint(&value, &v));
+    REQUIRE(56 == v);
+    REQUIRE(FLEXI_OK == flexi_cursor_seek_map_key(&map, "a55", &value));
+    REQUIRE(FLEXI_OK == flexi_cursor_uint(&value, &v));
+    REQUIRE(55 == v);
+}
+
+TEST_CASE("Pools with more entries than they were sized for", "[write_map]")
+{
+    TestWriterStrdup writer;
+    flexi_writer_s *fwriter = writer.GetWriter();
+
+    std::vector<uint8_t> key_pool(flexi_writer_pool_size(1));
+    std::vector<uint8_t> keyset_pool(flexi_writer_pool_size(1));
+    std::vector<uint8_t> string_pool(flexi_writer_pool_size(1));
+    REQUIRE(FLEXI_OK == flexi_writer_set_key_pool(
+                            fwriter, key_pool.data(), key_pool.size()));
+    REQUIRE(FLEXI_OK == flexi_writer_set_keyset_pool(
+                            fwriter, keyset_pool.data(), keyset_pool.size()));
+    REQUIRE(FLEXI_OK == flexi_writer_set_string_pool(fwriter,
+                            string_pool.data(), string_pool.size(), 8));
+
+    // Every key, keyset and string is different, so the pools fill up.
+    for (int i = 0; i < 10; i++) {
+        std::string key = "k" + std::to_string(i);
+        std::string str = "s" + std::to_string(i);
+        REQUIRE(FLEXI_OK == flexi_write_key(fwriter, key.c_str()));
+        REQUIRE(FLEXI_OK == flexi_write_strlen(fwriter, key.c_str(),
+                                str.c_str()));
+        REQUIRE(FLEXI_OK == flexi_write_map(fwriter, NULL, 1, FLEXI_WIDTH_1B));
+    }
+    REQUIRE(FLEXI_OK == flexi_write_vector(fwriter, NULL, 20, FLEXI_WIDTH_1B));
+    REQUIRE(FLEXI_OK == flexi_write_finalize(fwriter));
+
+    flexi_cursor_s cursor{};
+    writer.GetCursor(&cursor);
+    REQUIRE(20 == flexi_cursor_length(&cursor));
+
+    for (int i = 0; i < 10; i++) {
+        CAPTURE(i);
+        std::string key = "k" + std::to_string(i);
+        std::string str = "s" + std::to_string(i);
+        flexi_cursor_s value{}, map{};
+        const char *actual = NULL;
+        REQUIRE(FLEXI_OK ==
+                flexi_cursor_seek_vector_index(&cursor, i * 2, &value));
+        REQUIRE(FLEXI_OK == flexi_cursor_key(&value, &actual));
+        REQUIRE_THAT(actual, Equals(key));
+
+        REQUIRE(FLEXI_OK ==
+                flexi_cursor_seek_vector_index(&cursor, i * 2 + 1, &map));
+        REQUIRE(FLEXI_OK == flexi_cursor_seek_map_key(&map, key.c_str(),
+                                &value));
+        flexi_ssize_t len = 0;
+        REQUIRE(FLEXI_OK == flexi_cursor_string(&value, &actual, &len));
+        REQUIRE_THAT(actual, Equals(str));
+    }
+}
+
+TEST_CASE("Pooled keysets (Map keys)", "[write_map]")
+{
+    TestWriter writer;
+    flexi_writer_s *fwriter = writer.GetWriter();
+
+    std::vector<uint8_t> pool(flexi_writer_pool_size(2));
+    REQUIRE(FLEXI_OK ==
+            flexi_writer_set_keyset_pool(fwriter, pool.data(), pool.size()));
+
+    flexi_stack_idx_t first = 0, second = 0, third = 0;
+    REQUIRE(FLEXI_OK == flexi_write_key(fwriter, "x"));
+    REQUIRE(FLEXI_OK == flexi_write_key(fwriter, "y"));
+    REQUIRE(FLEXI_OK ==
+            flexi_write_map_keys(fwriter, 2, FLEXI_WIDTH_1B, &first));
+
+    flexi_ssize_t size = 0;
+    REQUIRE(writer.GetActual().Tell(&size));
+
+    REQUIRE(FLEXI_OK == flexi_write_key(fwriter, "y"));
+    REQUIRE(FLEXI_OK == flexi_write_key(fwriter, "x"));
+    REQUIRE(FLEXI_OK ==
+            flexi_write_map_keys(fwriter, 2, FLEXI_WIDTH_1B, &second));
+
+    REQUIRE(FLEXI_OK == flexi_write_key(fwriter, "x"));
+    REQUIRE(FLEXI_OK == flexi_write_key(fwriter, "z"));
+    REQUIRE(FLEXI_OK ==
+            flexi_write_map_keys(fwriter, 2, FLEXI_WIDTH_1B, &third));
+
+    flexi_value_s *first_value = nullptr, *second_value = nullptr,
+                  *third_value = nullptr;
+    REQUIRE(FLEXI_OK ==
+            flexi_writer_debug_stack_at(fwriter, first, &first_value));
+    REQUIRE(FLEXI_OK ==
+            flexi_writer_debug_stack_at(fwriter, second, &second_value));
+    REQUIRE(FLEXI_OK ==
+            flexi_writer_debug_stack_at(fwriter, third, &third_value));
+    REQUIRE(first_value->u.offset == second_value->u.offset);
+    REQUIRE(first_value->u.offset != third_value->u.offset);
+    REQUIRE(third_value->u.offset > size);
+}
+
+TEST_CASE("Map with many unsorted keys", "[write_map]")
+{
+    TestWriterStrdup writer;
+    flexi_writer_s *fwriter = writer.GetWriter();
+
+    // Visit keys in a scrambled order, with a run of sorted keys at the end
+    // and a reversed run in the middle.
+    constexpr int COUNT = 2000;
+    std::vector<int> order;
+    for (int i = 0; i < 1000; i++) {
+        order.push_back((i * 7919) % 1000);
+    }
+    for (int i = 1499; i >= 1000; i--) {
+        order.push_back(i);
+    }
+    for (int i = 1500; i < COUNT; i++) {
+        order.push_back(i);
+    }
+
+    char keybuf[16];
+    for (int i : order) {
+        snprintf(keybuf, 16, "key-%d", i);
+        REQUIRE(FLEXI_OK == flexi_write_sint(fwriter, keybuf, i));
+    }
+    REQUIRE(FLEXI_OK ==
+            flexi_write_map(fwriter, NULL, COUNT, FLEXI_WIDTH_1B));
+    REQUIRE(FLEXI_OK == flexi_write_finalize(fwriter));
+
+    flexi_cursor_s cursor{};
+    writer.GetCursor(&cursor);
+    REQUIRE(COUNT == flexi_cursor_length(&cursor));
+
+    const char *prev = "";
+    for (int i = 0; i < COUNT; i++) {
+        CAPTURE(i);
+        const char *key = nullptr;
+        flexi_cursor_s value{};
+        REQUIRE(FLEXI_OK == flexi_cursor_map_key_at_index(&cursor, i, &key));
+        REQUIRE(strcmp(prev, key) < 0);
+        prev = key;
+
+        int64_t v = 0;
+        REQUIRE(FLEXI_OK == flexi_cursor_seek_map_key(&cursor, key, &value));
+        REQUIRE(FLEXI_OK == flexi_cursor_sint(&value, &v));
+        snprintf(keybuf, 16, "key-%d", int(v));
+        REQUIRE(0 == strcmp(keybuf, key));
+    }
+}
+
+TEST_CASE("Dry run", "[write_map]")
+{
+    TestFixedWriter writer;
+    flexi_writer_s *fwriter = writer.GetWriter();
+
+    // Nothing reaches the stream during the dry run.
+    flexi_ssize_t size = writer.DryRun(WriteRecords);
+
+    std::vector<uint8_t> plain = WritePlainData(WriteRecords);
+    REQUIRE(flexi_ssize_t(plain.size()) == size);
+
+    // The output matches a writer that never did a dry run.
+    writer.SetBuffer(size);
+    WriteRecords(fwriter);
+    REQUIRE(size == writer.GetLen());
+    REQUIRE(plain == writer.GetData());
+
+    // One byte short fails to write.
+    REQUIRE(FLEXI_OK == flexi_writer_reset(fwriter));
+    writer.SetBuffer(size - 1);
+    for (int i = 0; i < 100; i++) {
+        REQUIRE(FLEXI_OK == flexi_write_uint(fwriter, "id", i));
+        REQUIRE(FLEXI_OK == flexi_write_uint(fwriter, "score", i * 2));
+        REQUIRE(FLEXI_OK == flexi_write_bool(fwriter, "active", i % 2));
+        REQUIRE(FLEXI_OK == flexi_write_map(fwriter, NULL, 3, FLEXI_WIDTH_1B));
+    }
+    REQUIRE(FLEXI_OK == flexi_write_vector(fwriter, NULL, 100, FLEXI_WIDTH_1B));
+    REQUIRE(FLEXI_ERR_BADWRITE == flexi_write_finalize(fwriter));
+}
+
+TEST_CASE("Dry run with pools", "[write_map]")
+{
+    std::vector<uint8_t> key_pool(flexi_writer_pool_size(8));
+    std::vector<uint8_t> keyset_pool(flexi_writer_pool_size(8));
+    auto setPools = [&](flexi_writer_s *fwriter) {
+        REQUIRE(FLEXI_OK == flexi_writer_set_key_pool(
+                                fwriter, key_pool.data(), key_pool.size()));
+        REQUIRE(FLEXI_OK ==
+                flexi_writer_set_keyset_pool(
+                    fwriter, keyset_pool.data(), keyset_pool.size()));
+    };
+
+    TestFixedWriter writer;
+    flexi_writer_s *fwriter = writer.GetWriter();
+    setPools(fwriter);
+
+    std::vector<flexi_ssize_t> scratch(256);
+    REQUIRE(FLEXI_OK ==
+            flexi_writer_set_dry_run_scratch(fwriter, scratch.data(),
+                flexi_ssize_t(scratch.size() * sizeof(flexi_ssize_t))));
+    flexi_ssize_t size = writer.DryRun(WriteRecords);
+
+    // Pooled keys and keys vectors are only measured once.
+    REQUIRE(size < flexi_ssize_t(WritePlainData(WriteRecords).size()));
+
+    // The size is exact, and the output matches a pooled writer that never
+    // did a dry run.
+    writer.SetBuffer(size);
+    WriteRecords(fwriter);
+    REQUIRE(size == writer.GetLen());
+
+    std::vector<uint8_t> pooled = WritePlainData([&](flexi_writer_s *plain) {
+        setPools(plain);
+        WriteRecords(plain);
+    });
+    REQUIRE(pooled == writer.GetData());
+}
+
+TEST_CASE("Dry run with pools (No scratch)", "[write_map]")
+{
+    TestFixedWriter writer;
+    flexi_writer_s *fwriter = writer.GetWriter();
+
+    std::vector<uint8_t> key_pool(flexi_writer_pool_size(8));
+    REQUIRE(FLEXI_OK == flexi_writer_set_key_pool(
+                            fwriter, key_pool.data(), key_pool.size()));
+
+    // The first key is fine, but the second cannot be compared against it.
+    REQUIRE(FLEXI_OK == flexi_writer_begin_dry_run(fwriter));
+    REQUIRE(FLEXI_OK == flexi_write_key(fwriter, "key"));
+    REQUIRE(FLEXI_ERR_BADWRITE == flexi_write_key(fwriter, "key"));
+
+    // A scratch too small to hold the key fails the same way.
+    std::array<flexi_ssize_t, 3> scratch{};
+    REQUIRE(FLEXI_OK == flexi_writer_set_dry_run_scratch(
+                            fwriter, scratch.data(), sizeof(scratch)));
+    REQUIRE(FLEXI_OK == flexi_writer_reset(fwriter));
+    REQUIRE(FLEXI_OK == flexi_write_key(fwriter, "key"));
+    REQUIRE(FLEXI_ERR_BADWRITE == flexi_write_key(fwriter, "key"));
+
+    REQUIRE(FLEXI_ERR_PARAM ==
+            flexi_writer_set_dry_run_scratch(fwriter, scratch.data(), 0));
+}
+
+static void
+WriteCollisions(flexi_writer_s *fwriter)
+{
+    // Both strings have the same length and the same 32-bit FNV-1a hash, so
+    // they collide in every pool.
+    REQUIRE(FLEXI_OK == flexi_write_strlen(fwriter, "gckxr", "gckxr"));
+    REQUIRE(FLEXI_OK == flexi_write_map(fwriter, NULL, 1, FLEXI_WIDTH_1B));
+    REQUIRE(FLEXI_OK == flexi_write_strlen(fwriter, "ydtrd", "ydtrd"));
+    REQUIRE(FLEXI_OK == flexi_write_map(fwriter, NULL, 1, FLEXI_WIDTH_1B));
+    REQUIRE(FLEXI_OK == flexi_write_vector(fwriter, NULL, 2, FLEXI_WIDTH_1B));
+    REQUIRE(FLEXI_OK == flexi_write_finalize(fwriter));
+}
+
+TEST_CASE("Dry run with pool collisions", "[write_map]")
+{
+    TestFixedWriter writer;
+    flexi_writer_s *fwriter = writer.GetWriter();
+
+    std::vector<uint8_t> key_pool(flexi_writer_pool_size(4));
+    std::vector<uint8_t> keyset_pool(flexi_writer_pool_size(4));
+    std::vector<uint8_t> string_pool(flexi_writer_pool_size(4));
+    REQUIRE(FLEXI_OK == flexi_writer_set_key_pool(
+                            fwriter, key_pool.data(), key_pool.size()));
+    REQUIRE(FLEXI_OK == flexi_writer_set_keyset_pool(
+                            fwriter, keyset_pool.data(), keyset_pool.size()));
+    REQUIRE(FLEXI_OK == flexi_writer_set_string_pool(fwriter,
+                            string_pool.data(), string_pool.size(), 8));
+
+    std::vector<flexi_ssize_t> scratch(64);
+    REQUIRE(FLEXI_OK ==
+            flexi_writer_set_dry_run_scratch(fwriter, scratch.data(),
+                flexi_ssize_t(scratch.size() * sizeof(flexi_ssize_t))));
+
+    // Nothing is really pooled, and the dry run can tell.
+    flexi_ssize_t size = writer.DryRun(WriteCollisions);
+    writer.SetBuffer(size);
+    WriteCollisions(fwriter);
+    REQUIRE(size == writer.GetLen());
+
+    std::vector<uint8_t> buffer = writer.GetData();
+    flexi_cursor_s cursor{};
+    flexi_span_s span = flexi_make_span(buffer.data(), buffer.size());
+    REQUIRE(FLEXI_OK == flexi_open_span(&span, &cursor));
+
+    flexi_cursor_s map{};
+    flexi_cursor_s value{};
+    const char *str = NULL;
+    flexi_ssize_t len = 0;
+    REQUIRE(FLEXI_OK == flexi_cursor_seek_vector_index(&cursor, 1, &map));
+    REQUIRE(FLEXI_OK == flexi_cursor_seek_map_key(&map, "ydtrd", &value));
+    REQUIRE(FLEXI_OK == flexi_cursor_string(&value, &str, &len));
+    REQUIRE(5 == len);
+    REQUIRE_THAT(str, Equals("ydtrd"));
+}
+
+static void
+WriteUnsortedKeys(flexi_writer_s *fwriter)
+{
+    // Sorting moves "z" to the end of the keys vector, which is just far
+    // enough from it to need a wider stride.
+    std::string longKey(251, 'a');
+    REQUIRE(FLEXI_OK == flexi_write_key(fwriter, "z"));
+    REQUIRE(FLEXI_OK == flexi_write_key(fwriter, longKey.c_str()));
+    flexi_stack_idx_t keyset = -1;
+    REQUIRE(FLEXI_OK ==
+            flexi_write_map_keys(fwriter, 2, FLEXI_WIDTH_1B, &keyset));
+
+    REQUIRE(FLEXI_OK == flexi_write_uint(fwriter, longKey.c_str(), 1));
+    REQUIRE(FLEXI_OK == flexi_write_uint(fwriter, "z", 2));
+    REQUIRE(FLEXI_OK ==
+            flexi_write_map_values(fwriter, NULL, keyset, 2, FLEXI_WIDTH_1B));
+    REQUIRE(FLEXI_OK == flexi_write_finalize(fwriter));
+}
+
+TEST_CASE("Dry run sorts map keys", "[write_map]")
+{
+    TestFixedWriter writer;
+    flexi_writer_s *fwriter = writer.GetWriter();
+
+    std::vector<flexi_ssize_t> scratch(64);
+    REQUIRE(FLEXI_OK ==
+            flexi_writer_set_dry_run_scratch(fwriter, scratch.data(),
+                flexi_ssize_t(scratch.size() * sizeof(flexi_ssize_t))));
+
+    flexi_ssize_t size = writer.DryRun(WriteUnsortedKeys);
+    writer.SetBuffer(size);
+    WriteUnsortedKeys(fwriter);
+    REQUIRE(size == writer.GetLen());
+    REQUIRE(WritePlainData(WriteUnsortedKeys) == writer.GetData());
+
+    // Without the keys, the dry run cannot sort them.
+    REQUIRE(FLEXI_OK == flexi_writer_set_dry_run_scratch(fwriter, NULL, 0));
+    REQUIRE(FLEXI_OK == flexi_writer_begin_dry_run(fwriter));
+    REQUIRE(FLEXI_OK == flexi_write_key(fwriter, "z"));
+    REQUIRE(FLEXI_OK == flexi_write_key(fwriter, "a"));
+    REQUIRE(FLEXI_ERR_BADWRITE ==
+            flexi_write_map_keys(fwriter, 2, FLEXI_WIDTH_1B, NULL));
+}
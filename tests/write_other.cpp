@@ -106,6 +106,236 @@ TEST_CASE("StringView", "[write_other]")
     REQUIRE(1 == flexi_cursor_width(&cursor));
 }
 
+TEST_CASE("Pooled strings", "[write_other]")
+{
+    TestWriter writer;
+    flexi_writer_s *fwriter = writer.GetWriter();
+
+    std::vector<uint8_t> pool(flexi_writer_pool_size(2));
+    REQUIRE(FLEXI_OK == flexi_writer_set_string_pool(
+                            fwriter, pool.data(), pool.size(), 4));
+
+    REQUIRE(FLEXI_OK == flexi_write_string(fwriter, NULL, "OK", 2));
+    REQUIRE(FLEXI_OK == flexi_write_string(fwriter, NULL, "OK", 2));
+    REQUIRE(FLEXI_OK == flexi_write_string(fwriter, NULL, "toolong", 7));
+    REQUIRE(FLEXI_OK == flexi_write_string(fwriter, NULL, "toolong", 7));
+    REQUIRE(FLEXI_OK == flexi_write_string(fwriter, NULL, "OK", 2));
+    REQUIRE(FLEXI_OK == flexi_write_vector(fwriter, NULL, 5, FLEXI_WIDTH_1B));
+    REQUIRE(FLEXI_OK == flexi_write_finalize(fwriter));
+
+    std::vector<uint8_t> expected = {
+        0x02,                                    // String length.
+        'O', 'K', '\0',                          // String.
+        0x07,                                    // String length.
+        't', 'o', 'o', 'l', 'o', 'n', 'g', '\0', // String.
+        0x07,                                    // String length.
+        't', 'o', 'o', 'l', 'o', 'n', 'g', '\0', // String.
+        0x05,                                    // Vector length.
+        0x16, 0x17, 0x14, 0x0c, 0x1a,            // Offsets.
+        0x14, 0x14, 0x14, 0x14, 0x14,            // Types.
+        0x0a, 0x28, 0x01                         // Root
+    };
+    writer.AssertData(expected);
+
+    REQUIRE(FLEXI_ERR_PARAM == flexi_writer_set_string_pool(
+                                   fwriter, pool.data(), pool.size(), -1));
+}
+
+TEST_CASE("Pooled strings far behind a vector", "[write_other]")
+{
+    TestWriter writer;
+    flexi_writer_s *fwriter = writer.GetWriter();
+
+    std::vector<uint8_t> pool(flexi_writer_pool_size(4));
+    REQUIRE(FLEXI_OK == flexi_writer_set_string_pool(
+                            fwriter, pool.data(), pool.size(), 4));
+
+    // The blob moves the current position just under 256 bytes, but the
+    // last elements of the vector are further than that from the pooled
+    // string at the start.
+    std::vector<uint8_t> blob(240, 0xab);
+    REQUIRE(FLEXI_OK == flexi_write_string(fwriter, NULL, "OK", 2));
+    REQUIRE(FLEXI_OK ==
+            flexi_write_blob(fwriter, NULL, blob.data(), blob.size(), 1));
+    for (int i = 0; i < 20; i++) {
+        REQUIRE(FLEXI_OK == flexi_write_string(fwriter, NULL, "OK", 2));
+    }
+    REQUIRE(FLEXI_OK == flexi_write_vector(fwriter, NULL, 22, FLEXI_WIDTH_1B));
+    REQUIRE(FLEXI_OK == flexi_write_finalize(fwriter));
+
+    flexi_cursor_s cursor{};
+    writer.GetCursor(&cursor);
+    REQUIRE(22 == flexi_cursor_length(&cursor));
+    REQUIRE(2 == flexi_cursor_width(&cursor));
+
+    for (int i : {0, 2, 21}) {
+        CAPTURE(i);
+        flexi_cursor_s value{};
+        const char *str = NULL;
+        flexi_ssize_t len = 0;
+        REQUIRE(FLEXI_OK == flexi_cursor_seek_vector_index(&cursor, i, &value));
+        REQUIRE(FLEXI_OK == flexi_cursor_string(&value, &str, &len));
+        REQUIRE_THAT(str, Equals("OK"));
+    }
+}
+
+static void
+WriteBufferedDoc(flexi_writer_s *fwriter)
+{
+    const char *long_str = "a string longer than the write buffer";
+    REQUIRE(FLEXI_OK == flexi_write_strlen(fwriter, "zeta", long_str));
+    REQUIRE(FLEXI_OK == flexi_write_uint(fwriter, "gamma", 1));
+    REQUIRE(FLEXI_OK == flexi_write_sint(fwriter, "alpha", -100000));
+    REQUIRE(FLEXI_OK == flexi_write_f64(fwriter, "beta", 2.5));
+    REQUIRE(FLEXI_OK == flexi_write_strlen(fwriter, "delta", "short"));
+    REQUIRE(FLEXI_OK == flexi_write_map(fwriter, NULL, 5, FLEXI_WIDTH_1B));
+    REQUIRE(FLEXI_OK == flexi_write_finalize(fwriter));
+}
+
+TEST_CASE("Buffered writes", "[write_other]")
+{
+    std::vector<uint8_t> expected = WritePlainData(WriteBufferedDoc);
+
+    TestWriter writer;
+    flexi_writer_s *fwriter = writer.GetWriter();
+
+    std::array<char, 16> buffer{};
+    REQUIRE(FLEXI_ERR_PARAM ==
+            flexi_writer_set_buffer(fwriter, buffer.data(), 0));
+    REQUIRE(FLEXI_OK ==
+            flexi_writer_set_buffer(fwriter, buffer.data(), buffer.size()));
+
+    // Small writes stay in the buffer until it is flushed.
+    flexi_ssize_t size = 0;
+    REQUIRE(FLEXI_OK == flexi_write_strlen(fwriter, NULL, "abc"));
+    REQUIRE(writer.GetActual().Tell(&size));
+    REQUIRE(0 == size);
+    REQUIRE(FLEXI_OK == flexi_writer_flush(fwriter));
+    REQUIRE(writer.GetActual().Tell(&size));
+    REQUIRE(5 == size);
+    REQUIRE(FLEXI_OK == flexi_destroy_writer(fwriter));
+
+    TestWriter buffered;
+    fwriter = buffered.GetWriter();
+    REQUIRE(FLEXI_OK ==
+            flexi_writer_set_buffer(fwriter, buffer.data(), buffer.size()));
+    WriteBufferedDoc(fwriter);
+    buffered.AssertData(expected);
+}
+
+TEST_CASE("Built-in stack and ostream", "[write_other]")
+{
+    std::vector<uint8_t> expected = WritePlainData(WriteBufferedDoc);
+
+    {
+        // Small chunks spread the message across several chunks.
+        flexi_array_stack_s array = flexi_make_growable_stack(realloc, free);
+        flexi_mem_ostream_s mem = flexi_make_mem_ostream(16, realloc, free);
+        flexi_stack_s stack = flexi_array_stack(&array);
+        flexi_ostream_s ostream = flexi_mem_ostream(&mem);
+        flexi_writer_s writer = flexi_make_writer(&stack, &ostream, NULL, NULL);
+        WriteBufferedDoc(&writer);
+
+        flexi_ssize_t len = 0;
+        REQUIRE(nullptr == flexi_mem_ostream_data(&mem, &len));
+        REQUIRE(expected.size() == len);
+
+        std::vector<uint8_t> actual(len);
+        REQUIRE(FLEXI_ERR_PARAM ==
+                flexi_mem_ostream_copy(&mem, actual.data(), len - 1));
+        REQUIRE(FLEXI_OK == flexi_mem_ostream_copy(&mem, actual.data(), len));
+        REQUIRE(expected == actual);
+
+        flexi_destroy_writer(&writer);
+        flexi_destroy_mem_ostream(&mem);
+        flexi_destroy_array_stack(&array);
+    }
+
+    {
+        std::array<flexi_value_s, 16> values{};
+        flexi_array_stack_s array =
+            flexi_make_fixed_stack(values.data(), values.size());
+        flexi_mem_ostream_s mem = flexi_make_mem_ostream(4096, realloc, free);
+        flexi_stack_s stack = flexi_array_stack(&array);
+        flexi_ostream_s ostream = flexi_mem_ostream(&mem);
+        flexi_writer_s writer = flexi_make_writer(&stack, &ostream, NULL, NULL);
+        WriteBufferedDoc(&writer);
+
+        flexi_ssize_t len = 0;
+        auto data = static_cast<const uint8_t *>(
+            flexi_mem_ostream_data(&mem, &len));
+        REQUIRE(nullptr != data);
+        REQUIRE(expected == std::vector<uint8_t>(data, data + len));
+
+        // The fixed stack cannot grow.
+        for (size_t i = 0; i < values.size(); i++) {
+            REQUIRE(FLEXI_OK == flexi_write_null(&writer, NULL));
+        }
+        REQUIRE(FLEXI_ERR_BADSTACK == flexi_write_null(&writer, NULL));
+
+        flexi_destroy_writer(&writer);
+        flexi_destroy_mem_ostream(&mem);
+    }
+}
+
+static int s_reallocs = 0;
+
+static void *
+CountingRealloc(void *ptr, size_t size)
+{
+    s_reallocs += 1;
+    return realloc(ptr, size);
+}
+
+TEST_CASE("Writer reset", "[write_other]")
+{
+    std::vector<uint8_t> expected = WritePlainData(WriteBufferedDoc);
+
+    flexi_array_stack_s array =
+        flexi_make_growable_stack(CountingRealloc, free);
+    flexi_mem_ostream_s mem = flexi_make_mem_ostream(16, CountingRealloc, free);
+    flexi_stack_s stack = flexi_array_stack(&array);
+    flexi_ostream_s ostream = flexi_mem_ostream(&mem);
+    flexi_writer_s writer = flexi_make_writer(&stack, &ostream, NULL, NULL);
+
+    std::vector<uint8_t> pool(flexi_writer_pool_size(8));
+    REQUIRE(FLEXI_OK ==
+            flexi_writer_set_key_pool(&writer, pool.data(), pool.size()));
+
+    // Leave an unfinished message and an error behind.
+    REQUIRE(FLEXI_OK == flexi_write_strlen(&writer, "zeta", "stale"));
+    REQUIRE(FLEXI_OK == flexi_write_uint(&writer, "gamma", 1));
+    REQUIRE(FLEXI_ERR_BADSTACK ==
+            flexi_write_map(&writer, NULL, 3, FLEXI_WIDTH_1B));
+
+    for (int i = 0; i < 3; i++) {
+        CAPTURE(i);
+        REQUIRE(FLEXI_OK == flexi_writer_reset(&writer));
+        REQUIRE(0 == flexi_writer_debug_stack_count(&writer));
+
+        s_reallocs = 0;
+        WriteBufferedDoc(&writer);
+
+        flexi_ssize_t len = 0;
+        flexi_mem_ostream_data(&mem, &len);
+        std::vector<uint8_t> actual(len);
+        REQUIRE(FLEXI_OK == flexi_mem_ostream_copy(&mem, actual.data(), len));
+        REQUIRE(expected == actual);
+        if (i > 0) {
+            // Resetting merged the chunks of the first message.
+            REQUIRE(nullptr != flexi_mem_ostream_data(&mem, &len));
+        }
+        if (i > 1) {
+            // Once warmed up, nothing else is allocated.
+            REQUIRE(0 == s_reallocs);
+        }
+    }
+
+    flexi_destroy_writer(&writer);
+    flexi_destroy_mem_ostream(&mem);
+    flexi_destroy_array_stack(&array);
+}
+
 TEST_CASE("Blob", "[write_other]")
 {
     TestWriter writer;
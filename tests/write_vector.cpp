@@ -204,6 +204,143 @@ TEST_CASE("Vector of strings and blobs", "[write_vector]")
     }
 }
 
+TEST_CASE("Vector of many strings", "[write_vector]")
+{
+    TestWriter writer;
+    flexi_writer_s *fwriter = writer.GetWriter();
+
+    // Enough offsets and types to span several staged writes.
+    constexpr int COUNT = 300;
+    char buf[16];
+    for (int i = 0; i < COUNT; i++) {
+        snprintf(buf, sizeof(buf), "str%d", i);
+        REQUIRE(FLEXI_OK == flexi_write_strlen(fwriter, NULL, buf));
+    }
+    REQUIRE(FLEXI_OK ==
+            flexi_write_vector(fwriter, NULL, COUNT, FLEXI_WIDTH_1B));
+    REQUIRE(FLEXI_OK == flexi_write_finalize(fwriter));
+
+    flexi_cursor_s cursor{};
+    writer.GetCursor(&cursor);
+
+    REQUIRE(FLEXI_TYPE_VECTOR == flexi_cursor_type(&cursor));
+    REQUIRE(2 == flexi_cursor_width(&cursor));
+    REQUIRE(COUNT == flexi_cursor_length(&cursor));
+
+    for (int i = 0; i < COUNT; i++) {
+        flexi_cursor_s vcursor{};
+        REQUIRE(FLEXI_OK ==
+                flexi_cursor_seek_vector_index(&cursor, i, &vcursor));
+
+        const char *str = nullptr;
+        flexi_ssize_t len = -1;
+        REQUIRE(FLEXI_OK == flexi_cursor_string(&vcursor, &str, &len));
+        snprintf(buf, sizeof(buf), "str%d", i);
+        REQUIRE_THAT(str, Equals(buf));
+    }
+}
+
+TEST_CASE("Typed vectors", "[write_vector]")
+{
+    TestWriter writer;
+    flexi_writer_s *fwriter = writer.GetWriter();
+    flexi_writer_set_typed_vectors(fwriter, true);
+
+    SECTION("Sint")
+    {
+        for (int i = 1; i <= 5; i++) {
+            REQUIRE(FLEXI_OK == flexi_write_sint(fwriter, NULL, i));
+        }
+        REQUIRE(FLEXI_OK ==
+                flexi_write_vector(fwriter, NULL, 5, FLEXI_WIDTH_1B));
+        REQUIRE(FLEXI_OK == flexi_write_finalize(fwriter));
+
+        std::vector<uint8_t> expected = {
+            0x05,                         // Vector length (stride 1)
+            0x01, 0x02, 0x03, 0x04, 0x05, // Values, no types
+            0x05, 0x2c, 0x01              // Root offset
+        };
+
+        writer.AssertData(expected);
+
+        flexi_cursor_s cursor{};
+        writer.GetCursor(&cursor);
+
+        const void *data = nullptr;
+        flexi_type_e type = FLEXI_TYPE_NULL;
+        int stride = -1;
+        flexi_ssize_t count = -1;
+        REQUIRE(FLEXI_OK == flexi_cursor_typed_vector_data(&cursor, &data,
+                                &type, &stride, &count));
+        REQUIRE(FLEXI_TYPE_VECTOR_SINT == type);
+        REQUIRE(1 == stride);
+        REQUIRE(5 == count);
+    }
+
+    SECTION("Float (Fixed)")
+    {
+        REQUIRE(FLEXI_OK == flexi_write_f32(fwriter, NULL, 1.0f));
+        REQUIRE(FLEXI_OK == flexi_write_f32(fwriter, NULL, 2.0f));
+        REQUIRE(FLEXI_OK == flexi_write_f32(fwriter, NULL, 3.0f));
+        REQUIRE(FLEXI_OK ==
+                flexi_write_vector(fwriter, NULL, 3, FLEXI_WIDTH_1B));
+        REQUIRE(FLEXI_OK == flexi_write_finalize(fwriter));
+
+        flexi_cursor_s cursor{};
+        writer.GetCursor(&cursor);
+
+        REQUIRE(FLEXI_TYPE_VECTOR_FLOAT3 == flexi_cursor_type(&cursor));
+        REQUIRE(4 == flexi_cursor_width(&cursor));
+        REQUIRE(3 == flexi_cursor_length(&cursor));
+
+        const void *data = nullptr;
+        REQUIRE(FLEXI_OK == flexi_cursor_typed_vector_data(
+                                &cursor, &data, NULL, NULL, NULL));
+
+        const float *vec = static_cast<const float *>(data);
+        REQUIRE_THAT(vec[0], WithinRel(1.0f));
+        REQUIRE_THAT(vec[1], WithinRel(2.0f));
+        REQUIRE_THAT(vec[2], WithinRel(3.0f));
+    }
+
+    SECTION("Key")
+    {
+        REQUIRE(FLEXI_OK == flexi_write_key(fwriter, "foo"));
+        REQUIRE(FLEXI_OK == flexi_write_key(fwriter, "bar"));
+        REQUIRE(FLEXI_OK ==
+                flexi_write_vector(fwriter, NULL, 2, FLEXI_WIDTH_1B));
+        REQUIRE(FLEXI_OK == flexi_write_finalize(fwriter));
+
+        flexi_cursor_s cursor{};
+        writer.GetCursor(&cursor);
+
+        REQUIRE(FLEXI_TYPE_VECTOR_KEY == flexi_cursor_type(&cursor));
+        REQUIRE(2 == flexi_cursor_length(&cursor));
+
+        flexi_cursor_s vcursor{};
+        const char *str = nullptr;
+        REQUIRE(FLEXI_OK ==
+                flexi_cursor_seek_vector_index(&cursor, 1, &vcursor));
+        REQUIRE(FLEXI_OK == flexi_cursor_key(&vcursor, &str));
+        REQUIRE_THAT(str, Equals("bar"));
+    }
+
+    SECTION("Mixed")
+    {
+        REQUIRE(FLEXI_OK == flexi_write_sint(fwriter, NULL, 1));
+        REQUIRE(FLEXI_OK == flexi_write_uint(fwriter, NULL, 2));
+        REQUIRE(FLEXI_OK ==
+                flexi_write_vector(fwriter, NULL, 2, FLEXI_WIDTH_1B));
+        REQUIRE(FLEXI_OK == flexi_write_finalize(fwriter));
+
+        flexi_cursor_s cursor{};
+        writer.GetCursor(&cursor);
+
+        REQUIRE(FLEXI_TYPE_VECTOR == flexi_cursor_type(&cursor));
+        REQUIRE(2 == flexi_cursor_length(&cursor));
+    }
+}
+
 TEST_CASE("Aligned Vector (4 bytes)", "[write_vector]")
 {
     TestWriter writer;